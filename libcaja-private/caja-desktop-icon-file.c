@@ -173,6 +173,7 @@ static void
 update_info_from_link (CajaDesktopIconFile *icon_file)
 {
     CajaFile *file;
+    CajaFileExtras *extras;
     CajaDesktopLink *link;
     char *display_name;
     GMount *mount;
@@ -221,8 +222,9 @@ update_info_from_link (CajaDesktopIconFile *icon_file)
         g_object_unref (file->details->icon);
     }
     file->details->icon = caja_desktop_link_get_icon (link);
-    g_free (file->details->activation_uri);
-    file->details->activation_uri = caja_desktop_link_get_activation_uri (link);
+    extras = caja_file_get_extras (file);
+    g_free (extras->activation_uri);
+    extras->activation_uri = caja_desktop_link_get_activation_uri (link);
     file->details->got_link_info = TRUE;
     file->details->link_info_is_up_to_date = TRUE;
 
@@ -27,7 +27,9 @@
 #include <libxml/parser.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <eel/eel-debug.h>
 #include <eel/eel-glib-extensions.h>
 
 #include "caja-directory-notify.h"
@@ -56,11 +58,23 @@
 #define DEBUG_START_STOP
 #endif
 
+/* Enumerator batches start at this size and are grown for fast backends
+ * (fewer main loop round trips) and shrunk again for slow ones (first files
+ * show up sooner), aiming at DIRECTORY_LOAD_BATCH_TARGET per batch. */
 #define DIRECTORY_LOAD_ITEMS_PER_CALLBACK 100
+#define DIRECTORY_LOAD_MAX_ITEMS_PER_CALLBACK 4096
+#define DIRECTORY_LOAD_BATCH_TARGET (20 * G_TIME_SPAN_MILLISECOND)
 
-/* Keep async. jobs down to this number for all directories. */
+/* Keep async. jobs down to this number for local directories. */
 #define MAX_ASYNC_JOBS 10
 
+/* Remote backends get their own job limit, which is raised while the
+ * round trip time stays close to the best one seen and lowered when
+ * requests start queuing up in the backend. */
+#define MIN_REMOTE_ASYNC_JOBS 2
+#define INITIAL_REMOTE_ASYNC_JOBS 4
+#define MAX_REMOTE_ASYNC_JOBS 24
+
 struct TopLeftTextReadState
 {
     CajaDirectory *directory;
@@ -107,6 +121,47 @@ struct DirectoryLoadState
     GHashTable *load_mime_list_hash;
     CajaFile *load_directory_file;
     int load_file_count;
+    int batch_size;
+    gint64 batch_start_time;
+
+    /* Batches of infos being prepared in the file info threads, in
+     * the order they were enumerated */
+    GQueue batches;
+    /* Batches still in a thread, they finish in any order */
+    int unprepared_batches;
+    gboolean next_files_pending;
+    gboolean enumeration_done;
+    GError *enumeration_error;
+};
+
+/* Infos the enumerator gave in one go, prepared off the main loop */
+typedef struct
+{
+    DirectoryLoadState *state;
+    GList *infos;
+    gboolean prepared;
+} FileInfoBatch;
+
+/* Jobs are throttled and enumerations sized per backend, local files
+ * being one backend and every remote URI scheme another one. */
+struct AsyncJobClass
+{
+    char *name;
+    gboolean is_local;
+    int job_count;
+    int max_jobs;
+    int batch_size;
+
+    /* Per item, batches come in different sizes */
+    gint64 min_latency;
+    gint64 avg_latency;
+
+    /* Statistics, see caja_directory_get_async_statistics() */
+    guint64 jobs_started;
+    guint64 jobs_throttled;
+    guint64 batches;
+    guint64 items;
+    gint64 batch_time;
 };
 
 struct MimeListState
@@ -140,17 +195,33 @@ struct DirectoryCountState
     int file_count;
 };
 
+/* Several directories of a deep count are enumerated at the same time.
+ * Subdirectories go to a queue that every enumeration takes its next
+ * directory from when it is done with one.
+ */
+#define DEEP_COUNT_MAX_ENUMERATIONS 8
+
+/* Minimum time between two updated_deep_count_in_progress signals */
+#define DEEP_COUNT_PROGRESS_INTERVAL (G_USEC_PER_SEC / 10)
+
 struct DeepCountState
 {
     CajaDirectory *directory;
     GCancellable *cancellable;
-    GFileEnumerator *enumerator;
-    GFile *deep_count_location;
-    GList *deep_count_subdirectories;
-    GArray *seen_deep_count_inodes;
+    GQueue deep_count_subdirectories;
+    guint n_enumerations;
+    GHashTable *seen_deep_count_inodes;
     char *fs_id;
+    gint64 last_progress_time;
 };
 
+typedef struct
+{
+    DeepCountState *state;
+    GFile *location;
+    GFileEnumerator *enumerator;
+} DeepCountEnumeration;
+
 typedef struct
 {
     CajaFile *file; /* Which file, NULL means all. */
@@ -187,16 +258,16 @@ typedef struct
 typedef gboolean (* RequestCheck) (Request);
 typedef gboolean (* FileCheck) (CajaFile *);
 
-/* Current number of async. jobs. */
+/* Current number of async. jobs, over all job classes. */
 static int async_job_count;
 static GHashTable *waiting_directories;
+static GHashTable *async_job_classes;
 #ifdef DEBUG_ASYNC_JOBS
 static GHashTable *async_jobs;
 #endif
 
 /* Forward declarations for functions that need them. */
-static void     deep_count_load                               (DeepCountState         *state,
-        GFile                  *location);
+static void     deep_count_load                               (DeepCountState         *state);
 static gboolean request_is_satisfied                          (CajaDirectory      *directory,
         CajaFile           *file,
         Request                 request);
@@ -303,10 +374,45 @@ request_counter_remove_request (RequestCounter counter,
     }
 }
 
+/* Requests are kept in hash tables that map the file they are for,
+ * NULL for the ones covering all files, to a list of requests.
+ */
+static void
+request_table_add (GHashTable *table,
+                   CajaFile *file,
+                   gpointer request)
+{
+    GList *list;
+
+    list = g_hash_table_lookup (table, file);
+    g_hash_table_insert (table, file, g_list_prepend (list, request));
+}
+
+static void
+request_table_remove_link (GHashTable *table,
+                           CajaFile *file,
+                           GList *link)
+{
+    GList *list;
+
+    list = g_hash_table_lookup (table, file);
+    list = g_list_remove_link (list, link);
+    if (list == NULL)
+    {
+        g_hash_table_remove (table, file);
+    }
+    else
+    {
+        g_hash_table_insert (table, file, list);
+    }
+}
+
 #if 0
 static void
 caja_directory_verify_request_counts (CajaDirectory *directory)
 {
+    GHashTableIter iter;
+    gpointer value;
     GList *l;
     RequestCounter counters;
     int i;
@@ -317,10 +423,14 @@ caja_directory_verify_request_counts (CajaDirectory *directory)
     {
         counters[i] = 0;
     }
-    for (l = directory->details->monitor_list; l != NULL; l = l->next)
+    g_hash_table_iter_init (&iter, directory->details->monitor_table);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
     {
-        Monitor *monitor = l->data;
-        request_counter_add_request (counters, monitor->request);
+        for (l = value; l != NULL; l = l->next)
+        {
+            Monitor *monitor = l->data;
+            request_counter_add_request (counters, monitor->request);
+        }
     }
     for (i = 0; i < REQUEST_TYPE_LAST; i ++)
     {
@@ -335,10 +445,19 @@ caja_directory_verify_request_counts (CajaDirectory *directory)
     {
         counters[i] = 0;
     }
-    for (l = directory->details->call_when_ready_list; l != NULL; l = l->next)
+    for (i = 0; i < 2; i++)
     {
-        ReadyCallback *callback = l->data;
-        request_counter_add_request (counters, callback->request);
+        g_hash_table_iter_init (&iter, i == 0 ?
+                                directory->details->call_when_ready_active :
+                                directory->details->call_when_ready_triggered);
+        while (g_hash_table_iter_next (&iter, NULL, &value))
+        {
+            for (l = value; l != NULL; l = l->next)
+            {
+                ReadyCallback *callback = l->data;
+                request_counter_add_request (counters, callback->request);
+            }
+        }
     }
     for (i = 0; i < REQUEST_TYPE_LAST; i ++)
     {
@@ -353,6 +472,160 @@ caja_directory_verify_request_counts (CajaDirectory *directory)
 }
 #endif
 
+static void
+async_job_class_free (AsyncJobClass *job_class)
+{
+    g_free (job_class->name);
+    g_free (job_class);
+}
+
+static AsyncJobClass *
+get_async_job_class (CajaDirectory *directory)
+{
+    AsyncJobClass *job_class;
+    char *name;
+    gboolean is_local;
+
+    if (directory->details->async_job_class != NULL)
+    {
+        return directory->details->async_job_class;
+    }
+
+    is_local = g_file_is_native (directory->details->location);
+    name = is_local ? g_strdup ("local") :
+           g_file_get_uri_scheme (directory->details->location);
+
+    if (async_job_classes == NULL)
+    {
+        async_job_classes = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                                   (GDestroyNotify) async_job_class_free);
+        eel_debug_call_at_shutdown_with_data ((GFreeFunc) g_hash_table_destroy,
+                                              async_job_classes);
+    }
+
+    job_class = g_hash_table_lookup (async_job_classes, name);
+    if (job_class == NULL)
+    {
+        job_class = g_new0 (AsyncJobClass, 1);
+        job_class->name = name;
+        job_class->is_local = is_local;
+        job_class->max_jobs = is_local ? MAX_ASYNC_JOBS : INITIAL_REMOTE_ASYNC_JOBS;
+        job_class->batch_size = DIRECTORY_LOAD_ITEMS_PER_CALLBACK;
+        g_hash_table_insert (async_job_classes, job_class->name, job_class);
+    }
+    else
+    {
+        g_free (name);
+    }
+
+    directory->details->async_job_class = job_class;
+
+    return job_class;
+}
+
+static int
+get_enumerator_batch_size (CajaDirectory *directory)
+{
+    return get_async_job_class (directory)->batch_size;
+}
+
+/* Feed the time it took to get a batch of files from an enumerator back
+ * into the batch size and, for remote backends, the job limit. */
+static void
+async_job_class_batch_done (AsyncJobClass *job_class,
+                            int n_requested,
+                            int n_received,
+                            gint64 elapsed)
+{
+    gint64 latency;
+
+    job_class->batches += 1;
+    job_class->items += n_received;
+    job_class->batch_time += elapsed;
+
+    /* Short batches are the end of the directory, their time says little */
+    if (n_received < n_requested)
+    {
+        return;
+    }
+
+    if (elapsed < DIRECTORY_LOAD_BATCH_TARGET / 2 &&
+        job_class->batch_size < DIRECTORY_LOAD_MAX_ITEMS_PER_CALLBACK)
+    {
+        job_class->batch_size *= 2;
+    }
+    else if (elapsed > DIRECTORY_LOAD_BATCH_TARGET * 2 &&
+             job_class->batch_size > DIRECTORY_LOAD_ITEMS_PER_CALLBACK)
+    {
+        job_class->batch_size /= 2;
+    }
+
+    if (job_class->is_local)
+    {
+        return;
+    }
+
+    latency = MAX (elapsed / n_received, 1);
+    job_class->avg_latency = job_class->avg_latency == 0 ? latency :
+                             (job_class->avg_latency * 7 + latency) / 8;
+    if (job_class->min_latency == 0 || latency < job_class->min_latency)
+    {
+        job_class->min_latency = latency;
+    }
+
+    if (job_class->avg_latency > 4 * job_class->min_latency)
+    {
+        job_class->max_jobs = MAX (job_class->max_jobs - 1, MIN_REMOTE_ASYNC_JOBS);
+        /* Forget about the best time slowly, the link may have changed */
+        job_class->min_latency += job_class->min_latency / 4;
+    }
+    else if (job_class->avg_latency < 2 * job_class->min_latency &&
+             job_class->job_count >= job_class->max_jobs)
+    {
+        job_class->max_jobs = MIN (job_class->max_jobs + 1, MAX_REMOTE_ASYNC_JOBS);
+    }
+}
+
+static void
+append_async_job_class_statistics (gpointer key,
+                                   gpointer value,
+                                   gpointer user_data)
+{
+    AsyncJobClass *job_class = value;
+    GString *statistics = user_data;
+
+    g_string_append_printf (statistics,
+                            "%s: %d/%d jobs, %" G_GUINT64_FORMAT " started, %"
+                            G_GUINT64_FORMAT " throttled, %" G_GUINT64_FORMAT
+                            " items in %" G_GUINT64_FORMAT " batches (%.1f ms each,"
+                            " %.1f us per item, now %d items per batch)\n",
+                            job_class->name,
+                            job_class->job_count, job_class->max_jobs,
+                            job_class->jobs_started, job_class->jobs_throttled,
+                            job_class->items, job_class->batches,
+                            job_class->batches == 0 ? 0.0 :
+                            (double) job_class->batch_time / job_class->batches / 1000.0,
+                            job_class->items == 0 ? 0.0 :
+                            (double) job_class->batch_time / job_class->items,
+                            job_class->batch_size);
+}
+
+char *
+caja_directory_get_async_statistics (void)
+{
+    GString *statistics;
+
+    statistics = g_string_new (NULL);
+    if (async_job_classes != NULL)
+    {
+        g_hash_table_foreach (async_job_classes,
+                              append_async_job_class_statistics,
+                              statistics);
+    }
+
+    return g_string_free (statistics, FALSE);
+}
+
 /* Start a job. This is really just a way of limiting the number of
  * async. requests that we issue at any given time. Without this, the
  * number of requests is unbounded.
@@ -361,6 +634,7 @@ static gboolean
 async_job_start (CajaDirectory *directory,
                  const char *job)
 {
+    AsyncJobClass *job_class;
 #ifdef DEBUG_ASYNC_JOBS
     char *key;
 #endif
@@ -369,10 +643,11 @@ async_job_start (CajaDirectory *directory,
     g_message ("starting %s in %p", job, directory->details->location);
 #endif
 
-    g_assert (async_job_count >= 0);
-    g_assert (async_job_count <= MAX_ASYNC_JOBS);
+    job_class = get_async_job_class (directory);
+
+    g_assert (job_class->job_count >= 0);
 
-    if (async_job_count >= MAX_ASYNC_JOBS)
+    if (job_class->job_count >= job_class->max_jobs)
     {
         if (waiting_directories == NULL)
         {
@@ -385,6 +660,7 @@ async_job_start (CajaDirectory *directory,
                              directory,
                              directory);
 
+        job_class->jobs_throttled += 1;
         return FALSE;
     }
 
@@ -410,6 +686,8 @@ async_job_start (CajaDirectory *directory,
 #endif
 
     async_job_count += 1;
+    job_class->job_count += 1;
+    job_class->jobs_started += 1;
     return TRUE;
 }
 
@@ -418,6 +696,7 @@ static void
 async_job_end (CajaDirectory *directory,
                const char *job)
 {
+    AsyncJobClass *job_class;
 #ifdef DEBUG_ASYNC_JOBS
     char *key;
     gpointer table_key, value;
@@ -427,7 +706,10 @@ async_job_end (CajaDirectory *directory,
     g_message ("stopping %s in %p", job, directory->details->location);
 #endif
 
+    job_class = get_async_job_class (directory);
+
     g_assert (async_job_count > 0);
+    g_assert (job_class->job_count > 0);
 
 #ifdef DEBUG_ASYNC_JOBS
     {
@@ -451,61 +733,52 @@ async_job_end (CajaDirectory *directory,
 #endif
 
     async_job_count -= 1;
-}
-
-/* Helper to get one value from a hash table. */
-static void
-get_one_value_callback (gpointer key, gpointer value, gpointer callback_data)
-{
-    gpointer *returned_value;
-
-    returned_value = callback_data;
-    *returned_value = value;
-}
-
-/* return a single value from a hash table. */
-static gpointer
-get_one_value (GHashTable *table)
-{
-    gpointer value;
-
-    value = NULL;
-    if (table != NULL)
-    {
-        g_hash_table_foreach (table, get_one_value_callback, &value);
-    }
-    return value;
+    job_class->job_count -= 1;
 }
 
 /* Wake up directories that are "blocked" as long as there are job
- * slots available.
+ * slots available for them.
  */
 static void
 async_job_wake_up (void)
 {
     static gboolean already_waking_up = FALSE;
-    gpointer value;
+    GList *waiting, *node;
 
     g_assert (async_job_count >= 0);
-    g_assert (async_job_count <= MAX_ASYNC_JOBS);
 
-    if (already_waking_up)
+    if (already_waking_up || waiting_directories == NULL)
     {
         return;
     }
 
     already_waking_up = TRUE;
-    while (async_job_count < MAX_ASYNC_JOBS)
+
+    /* Each directory is looked at once; one that still can't start a job
+     * just puts itself back in the table. */
+    waiting = g_hash_table_get_keys (waiting_directories);
+    for (node = waiting; node != NULL; node = node->next)
     {
-        value = get_one_value (waiting_directories);
-        if (value == NULL)
+        CajaDirectory *directory;
+        AsyncJobClass *job_class;
+
+        directory = node->data;
+        if (!g_hash_table_contains (waiting_directories, directory))
         {
-            break;
+            continue;
         }
-        g_hash_table_remove (waiting_directories, value);
-        caja_directory_async_state_changed
-        (CAJA_DIRECTORY (value));
+
+        job_class = get_async_job_class (directory);
+        if (job_class->job_count >= job_class->max_jobs)
+        {
+            continue;
+        }
+
+        g_hash_table_remove (waiting_directories, directory);
+        caja_directory_async_state_changed (directory);
     }
+    g_list_free (waiting);
+
     already_waking_up = FALSE;
 }
 
@@ -670,7 +943,8 @@ find_monitor (CajaDirectory *directory,
     monitor.client = client;
     monitor.file = file;
 
-    return g_list_find_custom (directory->details->monitor_list,
+    return g_list_find_custom (g_hash_table_lookup (directory->details->monitor_table,
+                                                    file),
                                &monitor,
                                monitor_key_compare);
 }
@@ -686,8 +960,8 @@ remove_monitor_link (CajaDirectory *directory,
         monitor = link->data;
         request_counter_remove_request (directory->details->monitor_counters,
                                         monitor->request);
-        directory->details->monitor_list =
-            g_list_remove_link (directory->details->monitor_list, link);
+        request_table_remove_link (directory->details->monitor_table,
+                                   monitor->file, link);
         g_free (monitor);
         g_list_free_1 (link);
     }
@@ -812,8 +1086,7 @@ caja_directory_monitor_add_internal (CajaDirectory *directory,
     {
         REQUEST_SET_TYPE (monitor->request, REQUEST_FILE_LIST);
     }
-    directory->details->monitor_list =
-        g_list_prepend (directory->details->monitor_list, monitor);
+    request_table_add (directory->details->monitor_table, file, monitor);
     request_counter_add_request (directory->details->monitor_counters,
                                  monitor->request);
 
@@ -1055,9 +1328,9 @@ dequeue_pending_idle_callback (gpointer callback_data)
 
             file->details->got_mime_list = TRUE;
             file->details->mime_list_is_up_to_date = TRUE;
-            g_list_free_full (file->details->mime_list, g_free);
-            file->details->mime_list = istr_set_get_as_list
-                                       (dir_load_state->load_mime_list_hash);
+            g_list_free_full (caja_file_get_extras (file)->mime_list, g_free);
+            file->details->extras->mime_list = istr_set_get_as_list
+                                               (dir_load_state->load_mime_list_hash);
 
             caja_file_changed (file);
         }
@@ -1087,13 +1360,13 @@ caja_directory_schedule_dequeue_pending (CajaDirectory *directory)
     }
 }
 
-static void
-directory_load_one (CajaDirectory *directory,
-                    GFileInfo *info)
+static gboolean
+directory_load_should_load (CajaDirectory *directory,
+                            GFileInfo *info)
 {
     if (info == NULL)
     {
-        return;
+        return FALSE;
     }
 
     if (g_file_info_get_name (info) == NULL)
@@ -1104,9 +1377,16 @@ directory_load_one (CajaDirectory *directory,
         g_warning ("Got GFileInfo with NULL name in %s, ignoring. This shouldn't happen unless the gvfs backend is broken.\n", uri);
         g_free (uri);
 
-        return;
+        return FALSE;
     }
 
+    return TRUE;
+}
+
+static void
+directory_load_one (CajaDirectory *directory,
+                    GFileInfo *info)
+{
     /* Arrange for the "loading" part of the work. */
     g_object_ref (info);
     directory->details->pending_file_info
@@ -1204,7 +1484,7 @@ caja_directory_monitor_remove_internal (CajaDirectory *directory,
     remove_monitor (directory, file, client);
 
     if (directory->details->monitor != NULL
-            && directory->details->monitor_list == NULL)
+            && g_hash_table_size (directory->details->monitor_table) == 0)
     {
         caja_monitor_cancel (directory->details->monitor);
         directory->details->monitor = NULL;
@@ -1219,28 +1499,21 @@ FileMonitors *
 caja_directory_remove_file_monitors (CajaDirectory *directory,
                                      CajaFile *file)
 {
-    GList *result, **list, *node, *next;
+    GList *result, *node;
     Monitor *monitor = NULL;
 
     g_assert (CAJA_IS_DIRECTORY (directory));
     g_assert (CAJA_IS_FILE (file));
     g_assert (file->details->directory == directory);
 
-    result = NULL;
+    result = g_hash_table_lookup (directory->details->monitor_table, file);
+    g_hash_table_remove (directory->details->monitor_table, file);
 
-    list = &directory->details->monitor_list;
-    for (node = directory->details->monitor_list; node != NULL; node = next)
+    for (node = result; node != NULL; node = node->next)
     {
-        next = node->next;
         monitor = node->data;
-
-        if (monitor->file == file)
-        {
-            *list = g_list_remove_link (*list, node);
-            result = g_list_concat (node, result);
-            request_counter_remove_request (directory->details->monitor_counters,
-                                            monitor->request);
-        }
+        request_counter_remove_request (directory->details->monitor_counters,
+                                        monitor->request);
     }
 
     /* XXX - do we need to remove anything from the work queue? */
@@ -1255,7 +1528,7 @@ caja_directory_add_file_monitors (CajaDirectory *directory,
                                   CajaFile *file,
                                   FileMonitors *monitors)
 {
-    GList **list;
+    GList *list;
     GList *l;
     Monitor *monitor = NULL;
 
@@ -1275,8 +1548,9 @@ caja_directory_add_file_monitors (CajaDirectory *directory,
                                      monitor->request);
     }
 
-    list = &directory->details->monitor_list;
-    *list = g_list_concat (*list, (GList *) monitors);
+    list = g_hash_table_lookup (directory->details->monitor_table, file);
+    g_hash_table_insert (directory->details->monitor_table, file,
+                         g_list_concat (list, (GList *) monitors));
 
     caja_directory_add_file_to_work_queue (directory, file);
 
@@ -1338,22 +1612,6 @@ ready_callback_key_compare (gconstpointer a, gconstpointer b)
     return 0;
 }
 
-static int
-ready_callback_key_compare_only_active (gconstpointer a, gconstpointer b)
-{
-    const ReadyCallback *callback_a;
-
-    callback_a = a;
-
-    /* Non active callbacks never match */
-    if (!callback_a->active)
-    {
-        return -1;
-    }
-
-    return ready_callback_key_compare (a, b);
-}
-
 static void
 ready_callback_call (CajaDirectory *directory,
                      const ReadyCallback *callback)
@@ -1430,10 +1688,12 @@ caja_directory_call_when_ready_internal (CajaDirectory *directory,
         return;
     }
 
-    /* Check if the callback is already there. */
-    if (g_list_find_custom (directory->details->call_when_ready_list,
+    /* Check if the callback is already there. Only active ones
+     * count, triggered callbacks are about to go away. */
+    if (g_list_find_custom (g_hash_table_lookup (directory->details->call_when_ready_active,
+                                                 file),
                             &callback,
-                            ready_callback_key_compare_only_active) != NULL)
+                            ready_callback_key_compare) != NULL)
     {
         if (file_callback != NULL && directory_callback != NULL)
         {
@@ -1444,9 +1704,8 @@ caja_directory_call_when_ready_internal (CajaDirectory *directory,
     }
 
     /* Add the new callback to the list. */
-    directory->details->call_when_ready_list = g_list_prepend
-            (directory->details->call_when_ready_list,
-             g_memdup (&callback, sizeof (callback)));
+    request_table_add (directory->details->call_when_ready_active, file,
+                       g_memdup (&callback, sizeof (callback)));
     request_counter_add_request (directory->details->call_when_ready_counters,
                                  callback.request);
 
@@ -1484,8 +1743,10 @@ remove_callback_link_keep_data (CajaDirectory *directory,
 
     callback = link->data;
 
-    directory->details->call_when_ready_list = g_list_remove_link
-            (directory->details->call_when_ready_list, link);
+    request_table_remove_link (callback->active ?
+                               directory->details->call_when_ready_active :
+                               directory->details->call_when_ready_triggered,
+                               callback->file, link);
 
     request_counter_remove_request (directory->details->call_when_ready_counters,
                                     callback->request);
@@ -1538,9 +1799,17 @@ caja_directory_cancel_callback_internal (CajaDirectory *directory,
     /* Remove all queued callback from the list (including non-active). */
     do
     {
-        node = g_list_find_custom (directory->details->call_when_ready_list,
+        node = g_list_find_custom (g_hash_table_lookup (directory->details->call_when_ready_active,
+                                                        file),
                                    &callback,
                                    ready_callback_key_compare);
+        if (node == NULL)
+        {
+            node = g_list_find_custom (g_hash_table_lookup (directory->details->call_when_ready_triggered,
+                                                            file),
+                                       &callback,
+                                       ready_callback_key_compare);
+        }
         if (node != NULL)
         {
             remove_callback_link (directory, node);
@@ -1592,9 +1861,12 @@ new_files_callback (GObject *source_object,
 
     /* Queue up the new file. */
     info = g_file_query_info_finish (G_FILE (source_object), res, NULL);
-    if (info != NULL)
+    if (directory_load_should_load (directory, info))
     {
         directory_load_one (directory, info);
+    }
+    if (info != NULL)
+    {
         g_object_unref (info);
     }
 
@@ -1646,43 +1918,39 @@ caja_async_destroying_file (CajaFile *file)
     CajaDirectory *directory;
     gboolean changed;
     GList *node, *next;
-    ReadyCallback *callback = NULL;
-    Monitor *monitor = NULL;
 
     directory = file->details->directory;
     changed = FALSE;
 
     /* Check for callbacks. */
-    for (node = directory->details->call_when_ready_list; node != NULL; node = next)
+    for (node = g_hash_table_lookup (directory->details->call_when_ready_active, file);
+            node != NULL; node = next)
     {
         next = node->next;
-        callback = node->data;
 
-        if (callback->file == file)
-        {
-            /* Client should have cancelled callback. */
-            if (callback->active)
-            {
-                g_warning ("destroyed file has call_when_ready pending");
-            }
-            remove_callback_link (directory, node);
-            changed = TRUE;
-        }
+        /* Client should have cancelled callback. */
+        g_warning ("destroyed file has call_when_ready pending");
+        remove_callback_link (directory, node);
+        changed = TRUE;
+    }
+    for (node = g_hash_table_lookup (directory->details->call_when_ready_triggered, file);
+            node != NULL; node = next)
+    {
+        next = node->next;
+        remove_callback_link (directory, node);
+        changed = TRUE;
     }
 
     /* Check for monitors. */
-    for (node = directory->details->monitor_list; node != NULL; node = next)
+    for (node = g_hash_table_lookup (directory->details->monitor_table, file);
+            node != NULL; node = next)
     {
         next = node->next;
-        monitor = node->data;
 
-        if (monitor->file == file)
-        {
-            /* Client should have removed monitor earlier. */
-            g_warning ("destroyed file still being monitored");
-            remove_monitor_link (directory, node);
-            changed = TRUE;
-        }
+        /* Client should have removed monitor earlier. */
+        g_warning ("destroyed file still being monitored");
+        remove_monitor_link (directory, node);
+        changed = TRUE;
     }
 
     /* Check if it's a file that's currently being worked on.
@@ -1843,7 +2111,7 @@ lacks_link_info (CajaFile *file)
 static gboolean
 lacks_extension_info (CajaFile *file)
 {
-    return file->details->pending_info_providers != NULL;
+    return caja_file_peek_extension_info (file)->pending_info_providers != NULL;
 }
 
 static gboolean
@@ -1993,7 +2261,9 @@ static gboolean
 call_ready_callbacks_at_idle (gpointer callback_data)
 {
     CajaDirectory *directory;
-    GList *node, *next;
+    GHashTableIter iter;
+    gpointer value;
+    GList *node;
     ReadyCallback *callback;
 
     directory = CAJA_DIRECTORY (callback_data);
@@ -2001,25 +2271,17 @@ call_ready_callbacks_at_idle (gpointer callback_data)
 
     caja_directory_ref (directory);
 
-    callback = NULL;
     while (1)
     {
-        /* Check if any callbacks are non-active and call them if they are. */
-        for (node = directory->details->call_when_ready_list;
-                node != NULL; node = next)
-        {
-            next = node->next;
-            callback = node->data;
-            if (!callback->active)
-            {
-                /* Non-active, remove and call */
-                break;
-            }
-        }
-        if (node == NULL)
+        /* Take one triggered callback at a time, since calling it
+         * can add or cancel other callbacks. */
+        g_hash_table_iter_init (&iter, directory->details->call_when_ready_triggered);
+        if (!g_hash_table_iter_next (&iter, NULL, &value))
         {
             break;
         }
+        node = value;
+        callback = node->data;
 
         /* Callbacks are one-shots, so remove it now. */
         remove_callback_link_keep_data (directory, node);
@@ -2049,127 +2311,348 @@ schedule_call_ready_callbacks (CajaDirectory *directory)
 /* Marks all callbacks that are ready as non-active and
  * calls them at idle time, unless they are removed
  * before then */
+typedef struct
+{
+    Request request;
+    gboolean satisfied;
+} RequestResult;
+
+/* Checking a request for all files walks the whole file list, and
+ * callbacks for all files mostly share a few requests, so the result
+ * is computed once per request.
+ */
+static gboolean
+request_is_satisfied_for_all_files (CajaDirectory *directory,
+                                    Request request,
+                                    GArray *results)
+{
+    RequestResult result;
+    guint i;
+
+    for (i = 0; i < results->len; i++)
+    {
+        if (g_array_index (results, RequestResult, i).request == request)
+        {
+            return g_array_index (results, RequestResult, i).satisfied;
+        }
+    }
+
+    result.request = request;
+    result.satisfied = request_is_satisfied (directory, NULL, request);
+    g_array_append_val (results, result);
+
+    return result.satisfied;
+}
+
 static gboolean
 call_ready_callbacks (CajaDirectory *directory)
 {
-    gboolean found_any;
-    GList *node, *next;
+    GHashTableIter iter;
+    gpointer value;
+    GList *list, *node, *next, *triggered;
+    GArray *results;
     ReadyCallback *callback = NULL;
+    gboolean satisfied;
 
-    found_any = FALSE;
+    triggered = NULL;
+    results = g_array_new (FALSE, FALSE, sizeof (RequestResult));
 
     /* Check if any callbacks are satisifed and mark them for call them if they are. */
-    for (node = directory->details->call_when_ready_list;
-            node != NULL; node = next)
+    g_hash_table_iter_init (&iter, directory->details->call_when_ready_active);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
     {
-        next = node->next;
-        callback = node->data;
-        if (callback->active &&
-                request_is_satisfied (directory, callback->file, callback->request))
+        list = value;
+        for (node = list; node != NULL; node = next)
         {
-            callback->active = FALSE;
-            found_any = TRUE;
+            next = node->next;
+            callback = node->data;
+
+            if (callback->file == NULL)
+            {
+                satisfied = request_is_satisfied_for_all_files
+                            (directory, callback->request, results);
+            }
+            else
+            {
+                satisfied = request_is_satisfied
+                            (directory, callback->file, callback->request);
+            }
+
+            if (satisfied)
+            {
+                list = g_list_remove_link (list, node);
+                triggered = g_list_concat (node, triggered);
+            }
+        }
+
+        if (list == NULL)
+        {
+            g_hash_table_iter_remove (&iter);
+        }
+        else
+        {
+            g_hash_table_iter_replace (&iter, list);
         }
     }
 
-    if (found_any)
+    g_array_free (results, TRUE);
+
+    if (triggered == NULL)
     {
-        schedule_call_ready_callbacks (directory);
+        return FALSE;
+    }
+
+    for (node = triggered; node != NULL; node = node->next)
+    {
+        callback = node->data;
+        callback->active = FALSE;
+        request_table_add (directory->details->call_when_ready_triggered,
+                           callback->file, callback);
     }
+    g_list_free (triggered);
 
-    return found_any;
+    schedule_call_ready_callbacks (directory);
+
+    return TRUE;
 }
 
 gboolean
 caja_directory_has_active_request_for_file (CajaDirectory *directory,
         CajaFile *file)
 {
-    GList *node;
-    ReadyCallback *callback = NULL;
-    Monitor *monitor = NULL;
+    GHashTable *tables[3];
+    guint i;
+
+    tables[0] = directory->details->call_when_ready_active;
+    tables[1] = directory->details->call_when_ready_triggered;
+    tables[2] = directory->details->monitor_table;
+
+    for (i = 0; i < G_N_ELEMENTS (tables); i++)
+    {
+        if (g_hash_table_contains (tables[i], file) ||
+                g_hash_table_contains (tables[i], NULL))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* This checks if there's a request for monitoring the file list. */
+gboolean
+caja_directory_is_anyone_monitoring_file_list (CajaDirectory *directory)
+{
+    if (directory->details->call_when_ready_counters[REQUEST_FILE_LIST] > 0)
+    {
+        return TRUE;
+    }
+
+    if (directory->details->monitor_counters[REQUEST_FILE_LIST] > 0)
+    {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* This checks if the file list being monitored. */
+gboolean
+caja_directory_is_file_list_monitored (CajaDirectory *directory)
+{
+    return directory->details->file_list_monitored;
+}
+
+static void
+mark_all_files_unconfirmed (CajaDirectory *directory)
+{
+    GList *node;
+    CajaFile *file = NULL;
+
+    for (node = directory->details->file_list; node != NULL; node = node->next)
+    {
+        file = node->data;
+        set_file_unconfirmed (file, TRUE);
+    }
+}
+
+static void
+file_info_batch_free (FileInfoBatch *batch)
+{
+    g_list_free_full (batch->infos, g_object_unref);
+    g_free (batch);
+}
+
+static void
+directory_load_state_free (DirectoryLoadState *state)
+{
+    FileInfoBatch *batch;
+
+    if (state->enumerator)
+    {
+        if (!g_file_enumerator_is_closed (state->enumerator))
+        {
+            g_file_enumerator_close_async (state->enumerator,
+                                           0, NULL, NULL, NULL);
+        }
+        g_object_unref (state->enumerator);
+    }
+
+    while ((batch = g_queue_pop_head (&state->batches)) != NULL)
+    {
+        g_assert (batch->prepared);
+        file_info_batch_free (batch);
+    }
+    if (state->enumeration_error != NULL)
+    {
+        g_error_free (state->enumeration_error);
+    }
+
+    if (state->load_mime_list_hash != NULL)
+    {
+        istr_set_destroy (state->load_mime_list_hash);
+    }
+    caja_file_unref (state->load_directory_file);
+    g_object_unref (state->cancellable);
+    g_free (state);
+}
+
+/* The state goes once the load is over or cancelled and neither the
+ * enumerator nor a file info thread will come back to it */
+static void
+directory_load_state_free_if_unused (DirectoryLoadState *state)
+{
+    if (state->directory != NULL ||
+            state->next_files_pending ||
+            state->unprepared_batches > 0)
+    {
+        return;
+    }
+
+    directory_load_state_free (state);
+}
+
+/* Hands the prepared batches to the directory in the order they were
+ * enumerated, and finishes the load after the last one. */
+static void
+directory_load_flush_batches (DirectoryLoadState *state)
+{
+    FileInfoBatch *batch;
+    CajaDirectory *directory;
+    GList *l;
 
-    for (node = directory->details->call_when_ready_list;
-            node != NULL; node = node->next)
+    while ((batch = g_queue_peek_head (&state->batches)) != NULL &&
+            batch->prepared)
     {
-        callback = node->data;
-        if (callback->file == file ||
-                callback->file == NULL)
+        g_queue_pop_head (&state->batches);
+
+        if (state->directory != NULL)
         {
-            return TRUE;
+            for (l = batch->infos; l != NULL; l = l->next)
+            {
+                directory_load_one (state->directory, l->data);
+            }
         }
+        file_info_batch_free (batch);
     }
 
-    for (node = directory->details->monitor_list;
-            node != NULL; node = node->next)
+    if (state->directory != NULL &&
+            state->enumeration_done &&
+            g_queue_is_empty (&state->batches))
     {
-        monitor = node->data;
-        if (monitor->file == file ||
-                monitor->file == NULL)
-        {
-            return TRUE;
-        }
+        directory = caja_directory_ref (state->directory);
+        directory_load_done (directory, state->enumeration_error);
+        caja_directory_unref (directory);
     }
 
-    return FALSE;
+    directory_load_state_free_if_unused (state);
 }
 
-/* This checks if there's a request for monitoring the file list. */
-gboolean
-caja_directory_is_anyone_monitoring_file_list (CajaDirectory *directory)
+static gboolean
+file_info_batch_prepared_callback (gpointer data)
 {
-    if (directory->details->call_when_ready_counters[REQUEST_FILE_LIST] > 0)
-    {
-        return TRUE;
-    }
+    FileInfoBatch *batch;
 
-    if (directory->details->monitor_counters[REQUEST_FILE_LIST] > 0)
-    {
-        return TRUE;
-    }
+    batch = data;
+    batch->prepared = TRUE;
+    batch->state->unprepared_batches--;
+    directory_load_flush_batches (batch->state);
 
     return FALSE;
 }
 
-/* This checks if the file list being monitored. */
-gboolean
-caja_directory_is_file_list_monitored (CajaDirectory *directory)
+/* Runs in a file info thread. Only the batch's infos are touched, and
+ * nothing else refers to them until the batch is handed back. */
+static void
+prepare_file_info_batch (gpointer data,
+                         gpointer user_data)
 {
-    return directory->details->file_list_monitored;
+    FileInfoBatch *batch;
+    GFileInfo *info;
+    const char *display_name;
+    char *collation_key;
+    GList *l;
+
+    batch = data;
+
+    for (l = batch->infos; l != NULL; l = l->next)
+    {
+        info = l->data;
+
+        display_name = g_file_info_get_display_name (info);
+        if (display_name != NULL && *display_name != 0)
+        {
+            collation_key = g_utf8_collate_key_for_filename (display_name, -1);
+            g_file_info_set_attribute_byte_string (info,
+                                                   CAJA_FILE_INFO_ATTRIBUTE_COLLATION_KEY,
+                                                   collation_key);
+            g_free (collation_key);
+        }
+    }
+
+    g_idle_add (file_info_batch_prepared_callback, batch);
 }
 
 static void
-mark_all_files_unconfirmed (CajaDirectory *directory)
+directory_load_prepare_batch (DirectoryLoadState *state,
+                              GList *infos)
 {
-    GList *node;
-    CajaFile *file = NULL;
+    static GThreadPool *file_info_thread_pool = NULL;
+    FileInfoBatch *batch;
 
-    for (node = directory->details->file_list; node != NULL; node = node->next)
+    if (file_info_thread_pool == NULL)
     {
-        file = node->data;
-        set_file_unconfirmed (file, TRUE);
+        file_info_thread_pool = g_thread_pool_new (prepare_file_info_batch, NULL,
+                                                   CLAMP (g_get_num_processors (), 1, 4),
+                                                   FALSE, NULL);
     }
+
+    batch = g_new0 (FileInfoBatch, 1);
+    batch->state = state;
+    batch->infos = infos;
+    g_queue_push_tail (&state->batches, batch);
+    state->unprepared_batches++;
+
+    g_thread_pool_push (file_info_thread_pool, batch, NULL);
 }
 
+static void more_files_callback (GObject      *source_object,
+                                 GAsyncResult *res,
+                                 gpointer      user_data);
+
 static void
-directory_load_state_free (DirectoryLoadState *state)
+directory_load_next_files (DirectoryLoadState *state)
 {
-    if (state->enumerator)
-    {
-        if (!g_file_enumerator_is_closed (state->enumerator))
-        {
-            g_file_enumerator_close_async (state->enumerator,
-                                           0, NULL, NULL, NULL);
-        }
-        g_object_unref (state->enumerator);
-    }
+    state->batch_size = get_enumerator_batch_size (state->directory);
+    state->batch_start_time = g_get_monotonic_time ();
+    state->next_files_pending = TRUE;
 
-    if (state->load_mime_list_hash != NULL)
-    {
-        istr_set_destroy (state->load_mime_list_hash);
-    }
-    caja_file_unref (state->load_directory_file);
-    g_object_unref (state->cancellable);
-    g_free (state);
+    g_file_enumerator_next_files_async (state->enumerator,
+                                        state->batch_size,
+                                        G_PRIORITY_DEFAULT,
+                                        state->cancellable,
+                                        more_files_callback,
+                                        state);
 }
 
 static void
@@ -2180,15 +2663,16 @@ more_files_callback (GObject *source_object,
     DirectoryLoadState *state;
     CajaDirectory *directory;
     GError *error;
-    GList *files, *l;
+    GList *files, *l, *infos;
     GFileInfo *info = NULL;
 
     state = user_data;
+    state->next_files_pending = FALSE;
 
     if (state->directory == NULL)
     {
         /* Operation was cancelled. Bail out */
-        directory_load_state_free (state);
+        directory_load_state_free_if_unused (state);
         return;
     }
 
@@ -2201,36 +2685,50 @@ more_files_callback (GObject *source_object,
     files = g_file_enumerator_next_files_finish (state->enumerator,
             res, &error);
 
+    async_job_class_batch_done (get_async_job_class (directory),
+                                state->batch_size,
+                                g_list_length (files),
+                                g_get_monotonic_time () - state->batch_start_time);
+
+    /* Keep the infos that can be loaded and prepare them in a thread
+     * while the next ones are read */
+    infos = NULL;
     for (l = files; l != NULL; l = l->next)
     {
         info = l->data;
-        directory_load_one (directory, info);
-        g_object_unref (info);
+        if (directory_load_should_load (directory, info))
+        {
+            infos = g_list_prepend (infos, info);
+        }
+        else
+        {
+            g_object_unref (info);
+        }
+    }
+    g_list_free (files);
+
+    if (infos != NULL)
+    {
+        directory_load_prepare_batch (state, g_list_reverse (infos));
     }
 
     if (files == NULL)
     {
-        directory_load_done (directory, error);
-        directory_load_state_free (state);
+        state->enumeration_done = TRUE;
+        state->enumeration_error = error;
+        directory_load_flush_batches (state);
     }
     else
     {
-        g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-                                            G_PRIORITY_DEFAULT,
-                                            state->cancellable,
-                                            more_files_callback,
-                                            state);
-    }
+        directory_load_next_files (state);
 
-    caja_directory_unref (directory);
-
-    if (error)
-    {
-        g_error_free (error);
+        if (error)
+        {
+            g_error_free (error);
+        }
     }
 
-    g_list_free (files);
+    caja_directory_unref (directory);
 }
 
 static void
@@ -2265,12 +2763,7 @@ enumerate_children_callback (GObject *source_object,
     else
     {
         state->enumerator = enumerator;
-        g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-                                            G_PRIORITY_DEFAULT,
-                                            state->cancellable,
-                                            more_files_callback,
-                                            state);
+        directory_load_next_files (state);
     }
 }
 
@@ -2465,19 +2958,23 @@ is_needy (CajaFile *file,
     {
         ReadyCallback *callback = NULL;
 
-        for (node = directory->details->call_when_ready_list;
+        for (node = g_hash_table_lookup (directory->details->call_when_ready_active, file);
                 node != NULL; node = node->next)
         {
             callback = node->data;
-            if (callback->active &&
-                    REQUEST_WANTS_TYPE (callback->request, request_type_wanted))
+            if (REQUEST_WANTS_TYPE (callback->request, request_type_wanted))
             {
-                if (callback->file == file)
-                {
-                    return TRUE;
-                }
-                if (callback->file == NULL
-                        && file != directory->details->as_file)
+                return TRUE;
+            }
+        }
+
+        if (file != directory->details->as_file)
+        {
+            for (node = g_hash_table_lookup (directory->details->call_when_ready_active, NULL);
+                    node != NULL; node = node->next)
+            {
+                callback = node->data;
+                if (REQUEST_WANTS_TYPE (callback->request, request_type_wanted))
                 {
                     return TRUE;
                 }
@@ -2489,16 +2986,24 @@ is_needy (CajaFile *file,
     {
         Monitor *monitor = NULL;
 
-        for (node = directory->details->monitor_list;
+        for (node = g_hash_table_lookup (directory->details->monitor_table, file);
                 node != NULL; node = node->next)
         {
             monitor = node->data;
             if (REQUEST_WANTS_TYPE (monitor->request, request_type_wanted))
             {
-                if (monitor_includes_file (monitor, file))
-                {
-                    return TRUE;
-                }
+                return TRUE;
+            }
+        }
+
+        for (node = g_hash_table_lookup (directory->details->monitor_table, NULL);
+                node != NULL; node = node->next)
+        {
+            monitor = node->data;
+            if (REQUEST_WANTS_TYPE (monitor->request, request_type_wanted) &&
+                    monitor_includes_file (monitor, file))
+            {
+                return TRUE;
             }
         }
     }
@@ -2645,7 +3150,7 @@ count_more_files_callback (GObject *source_object,
     else
     {
         g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+                                            get_enumerator_batch_size (state->directory),
                                             G_PRIORITY_DEFAULT,
                                             state->cancellable,
                                             count_more_files_callback,
@@ -2704,7 +3209,7 @@ count_children_callback (GObject *source_object,
     {
         state->enumerator = enumerator;
         g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+                                            get_enumerator_batch_size (state->directory),
                                             G_PRIORITY_DEFAULT,
                                             state->cancellable,
                                             count_more_files_callback,
@@ -2779,64 +3284,61 @@ directory_count_start (CajaDirectory *directory,
     g_object_unref (location);
 }
 
-static inline gboolean
+/* Files with more than one link may be seen again further down, and
+ * their sizes are only counted the first time. */
+static gboolean
 seen_inode (DeepCountState *state,
             GFileInfo *info)
 {
-    guint64 inode, inode2;
-    guint i;
-
-    inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+    guint64 inode;
+    guint64 *key;
 
-    if (inode != 0)
+    if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY ||
+            (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_NLINK) &&
+             g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_NLINK) <= 1))
     {
-        for (i = 0; i < state->seen_deep_count_inodes->len; i++)
-        {
-            inode2 = g_array_index (state->seen_deep_count_inodes, guint64, i);
-            if (inode == inode2)
-            {
-                return TRUE;
-            }
-        }
+        return FALSE;
     }
 
-    return FALSE;
-}
-
-static inline void
-mark_inode_as_seen (DeepCountState *state,
-                    GFileInfo *info)
-{
-    guint64 inode;
-
     inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
-    if (inode != 0)
+    if (inode == 0)
+    {
+        return FALSE;
+    }
+
+    if (g_hash_table_contains (state->seen_deep_count_inodes, &inode))
     {
-        g_array_append_val (state->seen_deep_count_inodes, inode);
+        return TRUE;
     }
+
+    key = g_new (guint64, 1);
+    *key = inode;
+    g_hash_table_add (state->seen_deep_count_inodes, key);
+
+    return FALSE;
 }
 
 static void
-deep_count_one (DeepCountState *state,
+deep_count_one (DeepCountEnumeration *enumeration,
                 GFileInfo *info)
 {
+    DeepCountState *state;
     CajaFile *file;
+    CajaFileDeepCounts *deep_counts;
     gboolean is_seen_inode;
 
+    state = enumeration->state;
     is_seen_inode = seen_inode (state, info);
-    if (!is_seen_inode)
-    {
-        mark_inode_as_seen (state, info);
-    }
 
     file = state->directory->details->deep_count_file;
+    deep_counts = caja_file_get_deep_counts (file);
 
     if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
     {
         const char *fs_id;
 
         /* Count the directory. */
-        file->details->deep_directory_count += 1;
+        deep_counts->deep_directory_count += 1;
 
         /* Record the fact that we have to descend into this directory. */
 
@@ -2845,26 +3347,27 @@ deep_count_one (DeepCountState *state,
         {
             GFile *subdir;
 
-            /* only if it is on the same filesystem */
-            subdir = g_file_get_child (state->deep_count_location, g_file_info_get_name (info));
-            state->deep_count_subdirectories = g_list_prepend (state->deep_count_subdirectories, subdir);
+            /* only if it is on the same filesystem. Going deep
+             * first keeps the queue short. */
+            subdir = g_file_get_child (enumeration->location, g_file_info_get_name (info));
+            g_queue_push_head (&state->deep_count_subdirectories, subdir);
         }
     }
     else
     {
         /* Even non-regular files count as files. */
-        file->details->deep_file_count += 1;
+        deep_counts->deep_file_count += 1;
     }
 
     /* Count the size. */
     if (!is_seen_inode && g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_SIZE))
     {
-        file->details->deep_size += g_file_info_get_size (info);
+        deep_counts->deep_size += g_file_info_get_size (info);
     }
     /* Count the disk size. */
     if (!is_seen_inode && g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE))
     {
-        file->details->deep_size_on_disk +=
+        deep_counts->deep_size_on_disk +=
             g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE);
     }
 }
@@ -2872,24 +3375,56 @@ deep_count_one (DeepCountState *state,
 static void
 deep_count_state_free (DeepCountState *state)
 {
-    if (state->enumerator)
+    g_assert (state->n_enumerations == 0);
+
+    g_object_unref (state->cancellable);
+    while (!g_queue_is_empty (&state->deep_count_subdirectories))
     {
-        if (!g_file_enumerator_is_closed (state->enumerator))
+        g_object_unref (g_queue_pop_head (&state->deep_count_subdirectories));
+    }
+    g_hash_table_destroy (state->seen_deep_count_inodes);
+    g_free (state->fs_id);
+    g_free (state);
+}
+
+static void
+deep_count_enumeration_free (DeepCountEnumeration *enumeration)
+{
+    if (enumeration->enumerator)
+    {
+        if (!g_file_enumerator_is_closed (enumeration->enumerator))
         {
-            g_file_enumerator_close_async (state->enumerator,
+            g_file_enumerator_close_async (enumeration->enumerator,
                                            0, NULL, NULL, NULL);
         }
-        g_object_unref (state->enumerator);
+        g_object_unref (enumeration->enumerator);
     }
-    g_object_unref (state->cancellable);
-    if (state->deep_count_location)
+    g_object_unref (enumeration->location);
+    g_free (enumeration);
+}
+
+/* Ends an enumeration that is done or was cancelled, and returns
+ * whether the deep count can go on. The state is gone otherwise. */
+static gboolean
+deep_count_enumeration_done (DeepCountEnumeration *enumeration)
+{
+    DeepCountState *state;
+
+    state = enumeration->state;
+    deep_count_enumeration_free (enumeration);
+    state->n_enumerations--;
+
+    if (state->directory == NULL)
     {
-        g_object_unref (state->deep_count_location);
+        /* Operation was cancelled. The last one out frees the state. */
+        if (state->n_enumerations == 0)
+        {
+            deep_count_state_free (state);
+        }
+        return FALSE;
     }
-    g_list_free_full (state->deep_count_subdirectories, g_object_unref);
-    g_array_free (state->seen_deep_count_inodes, TRUE);
-    g_free (state->fs_id);
-    g_free (state);
+
+    return TRUE;
 }
 
 static void
@@ -2897,44 +3432,34 @@ deep_count_next_dir (DeepCountState *state)
 {
     CajaFile *file;
     CajaDirectory *directory;
-    gboolean done;
+    gint64 now;
 
     directory = state->directory;
-
-    g_object_unref (state->deep_count_location);
-    state->deep_count_location = NULL;
-
-    done = FALSE;
     file = directory->details->deep_count_file;
 
-    if (state->deep_count_subdirectories != NULL)
-    {
-        GFile *location;
+    /* Work on new directories. */
+    deep_count_load (state);
 
-        /* Work on a new directory. */
-        location = state->deep_count_subdirectories->data;
-        state->deep_count_subdirectories = g_list_remove
-                                           (state->deep_count_subdirectories, location);
-        deep_count_load (state, location);
-        g_object_unref (location);
-    }
-    else
+    if (state->n_enumerations > 0)
     {
-        file->details->deep_counts_status = CAJA_REQUEST_DONE;
-        directory->details->deep_count_file = NULL;
-        directory->details->deep_count_in_progress = NULL;
-        deep_count_state_free (state);
-        done = TRUE;
+        now = g_get_monotonic_time ();
+        if (now - state->last_progress_time >= DEEP_COUNT_PROGRESS_INTERVAL)
+        {
+            state->last_progress_time = now;
+            caja_file_updated_deep_count_in_progress (file);
+        }
+        return;
     }
 
-    caja_file_updated_deep_count_in_progress (file);
+    file->details->deep_counts_status = CAJA_REQUEST_DONE;
+    directory->details->deep_count_file = NULL;
+    directory->details->deep_count_in_progress = NULL;
+    deep_count_state_free (state);
 
-    if (done)
-    {
-        caja_file_changed (file);
-        async_job_end (directory, "deep count");
-        caja_directory_async_state_changed (directory);
-    }
+    caja_file_updated_deep_count_in_progress (file);
+    caja_file_changed (file);
+    async_job_end (directory, "deep count");
+    caja_directory_async_state_changed (directory);
 }
 
 static void
@@ -2942,17 +3467,22 @@ deep_count_more_files_callback (GObject *source_object,
                                 GAsyncResult *res,
                                 gpointer user_data)
 {
+    DeepCountEnumeration *enumeration;
     DeepCountState *state;
     CajaDirectory *directory;
     GList *files, *l;
     GFileInfo *info = NULL;
 
-    state = user_data;
+    enumeration = user_data;
+    state = enumeration->state;
+
+    files = g_file_enumerator_next_files_finish (enumeration->enumerator,
+            res, NULL);
 
     if (state->directory == NULL)
     {
-        /* Operation was cancelled. Bail out */
-        deep_count_state_free (state);
+        g_list_free_full (files, g_object_unref);
+        deep_count_enumeration_done (enumeration);
         return;
     }
 
@@ -2961,32 +3491,29 @@ deep_count_more_files_callback (GObject *source_object,
     g_assert (directory->details->deep_count_in_progress != NULL);
     g_assert (directory->details->deep_count_in_progress == state);
 
-    files = g_file_enumerator_next_files_finish (state->enumerator,
-            res, NULL);
-
     for (l = files; l != NULL; l = l->next)
     {
         info = l->data;
-        deep_count_one (state, info);
+        deep_count_one (enumeration, info);
         g_object_unref (info);
     }
 
     if (files == NULL)
     {
-        g_file_enumerator_close_async (state->enumerator, 0, NULL, NULL, NULL);
-        g_object_unref (state->enumerator);
-        state->enumerator = NULL;
-
+        deep_count_enumeration_done (enumeration);
         deep_count_next_dir (state);
     }
     else
     {
-        g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+        g_file_enumerator_next_files_async (enumeration->enumerator,
+                                            get_enumerator_batch_size (state->directory),
                                             G_PRIORITY_LOW,
                                             state->cancellable,
                                             deep_count_more_files_callback,
-                                            state);
+                                            enumeration);
+
+        /* Let idle enumerations have the subdirectories just found */
+        deep_count_load (state);
     }
 
     g_list_free (files);
@@ -2999,63 +3526,76 @@ deep_count_callback (GObject *source_object,
                      GAsyncResult *res,
                      gpointer user_data)
 {
+    DeepCountEnumeration *enumeration;
     DeepCountState *state;
     GFileEnumerator *enumerator;
     CajaFile *file;
 
-    state = user_data;
+    enumeration = user_data;
+    state = enumeration->state;
+
+    enumerator = g_file_enumerate_children_finish  (G_FILE (source_object),	res, NULL);
+    enumeration->enumerator = enumerator;
 
     if (state->directory == NULL)
     {
-        /* Operation was cancelled. Bail out */
-        deep_count_state_free (state);
+        deep_count_enumeration_done (enumeration);
         return;
     }
 
     file = state->directory->details->deep_count_file;
 
-    enumerator = g_file_enumerate_children_finish  (G_FILE (source_object),	res, NULL);
-
     if (enumerator == NULL)
     {
-        file->details->deep_unreadable_count += 1;
+        caja_file_get_deep_counts (file)->deep_unreadable_count += 1;
 
+        deep_count_enumeration_done (enumeration);
         deep_count_next_dir (state);
     }
     else
     {
-        state->enumerator = enumerator;
-        g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+        g_file_enumerator_next_files_async (enumerator,
+                                            get_enumerator_batch_size (state->directory),
                                             G_PRIORITY_LOW,
                                             state->cancellable,
                                             deep_count_more_files_callback,
-                                            state);
+                                            enumeration);
     }
 }
 
+/* Starts enumerating queued directories, as many as there is room for */
 static void
-deep_count_load (DeepCountState *state, GFile *location)
+deep_count_load (DeepCountState *state)
 {
-    state->deep_count_location = g_object_ref (location);
+    DeepCountEnumeration *enumeration;
+
+    while (state->n_enumerations < DEEP_COUNT_MAX_ENUMERATIONS &&
+            !g_queue_is_empty (&state->deep_count_subdirectories))
+    {
+        enumeration = g_new0 (DeepCountEnumeration, 1);
+        enumeration->state = state;
+        enumeration->location = g_queue_pop_head (&state->deep_count_subdirectories);
+        state->n_enumerations++;
 
 #ifdef DEBUG_LOAD_DIRECTORY
-    g_message ("load_directory called to get deep file count for %p", location);
+        g_message ("load_directory called to get deep file count for %p", enumeration->location);
 #endif
-    g_file_enumerate_children_async (state->deep_count_location,
-                                     G_FILE_ATTRIBUTE_STANDARD_NAME ","
-                                     G_FILE_ATTRIBUTE_STANDARD_TYPE ","
-                                     G_FILE_ATTRIBUTE_STANDARD_SIZE ","
-                                     G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE ","
-                                     G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN ","
-                                     G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP ","
-                                     G_FILE_ATTRIBUTE_ID_FILESYSTEM ","
-                                     G_FILE_ATTRIBUTE_UNIX_INODE,
-                                     G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, /* flags */
-                                     G_PRIORITY_LOW, /* prio */
-                                     state->cancellable,
-                                     deep_count_callback,
-                                     state);
+        g_file_enumerate_children_async (enumeration->location,
+                                         G_FILE_ATTRIBUTE_STANDARD_NAME ","
+                                         G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+                                         G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                                         G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE ","
+                                         G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN ","
+                                         G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP ","
+                                         G_FILE_ATTRIBUTE_ID_FILESYSTEM ","
+                                         G_FILE_ATTRIBUTE_UNIX_INODE ","
+                                         G_FILE_ATTRIBUTE_UNIX_NLINK,
+                                         G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, /* flags */
+                                         G_PRIORITY_LOW, /* prio */
+                                         state->cancellable,
+                                         deep_count_callback,
+                                         enumeration);
+    }
 }
 
 static void
@@ -3101,7 +3641,16 @@ deep_count_got_info (GObject *source_object,
          state->fs_id = g_strdup (id);
          g_object_unref (info);
      }
-     deep_count_load (state, file);
+
+     if (state->directory == NULL)
+     {
+         /* Operation was cancelled. Bail out */
+         deep_count_state_free (state);
+         return;
+     }
+
+     g_queue_push_head (&state->deep_count_subdirectories, g_object_ref (file));
+     deep_count_load (state);
 }
 
 static void
@@ -3141,17 +3690,14 @@ deep_count_start (CajaDirectory *directory,
 
     /* Start counting. */
     file->details->deep_counts_status = CAJA_REQUEST_IN_PROGRESS;
-    file->details->deep_directory_count = 0;
-    file->details->deep_file_count = 0;
-    file->details->deep_unreadable_count = 0;
-    file->details->deep_size = 0;
-    file->details->deep_size_on_disk = 0;
+    memset (caja_file_get_deep_counts (file), 0, sizeof (CajaFileDeepCounts));
     directory->details->deep_count_file = file;
 
     state = g_new0 (DeepCountState, 1);
     state->directory = directory;
     state->cancellable = g_cancellable_new ();
-    state->seen_deep_count_inodes = g_array_new (FALSE, TRUE, sizeof (guint64));
+    state->seen_deep_count_inodes = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+                                                           g_free, NULL);
     state->fs_id = NULL;
 
     directory->details->deep_count_in_progress = state;
@@ -3222,16 +3768,20 @@ mime_list_done (MimeListState *state, gboolean success)
     file = state->mime_list_file;
 
     file->details->mime_list_is_up_to_date = TRUE;
-    g_list_free_full (file->details->mime_list, g_free);
     if (success)
     {
         file->details->mime_list_failed = TRUE;
-        file->details->mime_list = NULL;
+        if (file->details->extras != NULL)
+        {
+            g_list_free_full (file->details->extras->mime_list, g_free);
+            file->details->extras->mime_list = NULL;
+        }
     }
     else
     {
         file->details->got_mime_list = TRUE;
-        file->details->mime_list = istr_set_get_as_list	(state->mime_list_hash);
+        g_list_free_full (caja_file_get_extras (file)->mime_list, g_free);
+        file->details->extras->mime_list = istr_set_get_as_list	(state->mime_list_hash);
     }
     directory->details->mime_list_in_progress = NULL;
 
@@ -3313,7 +3863,7 @@ mime_list_callback (GObject *source_object,
     else
     {
         g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+                                            get_enumerator_batch_size (state->directory),
                                             G_PRIORITY_DEFAULT,
                                             state->cancellable,
                                             mime_list_callback,
@@ -3370,7 +3920,7 @@ list_mime_enum_callback (GObject *source_object,
     {
         state->enumerator = enumerator;
         g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+                                            get_enumerator_batch_size (state->directory),
                                             G_PRIORITY_DEFAULT,
                                             state->cancellable,
                                             mime_list_callback,
@@ -3405,7 +3955,11 @@ mime_list_start (CajaDirectory *directory,
 
     if (!caja_file_is_directory (file))
     {
-        g_list_free (file->details->mime_list);
+        if (file->details->extras != NULL)
+        {
+            g_list_free_full (file->details->extras->mime_list, g_free);
+            file->details->extras->mime_list = NULL;
+        }
         file->details->mime_list_failed = FALSE;
         file->details->got_mime_list = FALSE;
         file->details->mime_list_is_up_to_date = TRUE;
@@ -3507,21 +4061,25 @@ top_left_read_callback (GObject *source_object,
     file_details = state->file->details;
 
     file_details->top_left_text_is_up_to_date = TRUE;
-    g_free (file_details->top_left_text);
+    if (file_details->extras != NULL)
+    {
+        g_free (file_details->extras->top_left_text);
+        file_details->extras->top_left_text = NULL;
+    }
 
     if (g_file_load_partial_contents_finish (G_FILE (source_object),
             res,
             &file_contents, &file_size,
             NULL, NULL))
     {
-        file_details->top_left_text = caja_extract_top_left_text (file_contents, state->large, file_size);
+        caja_file_get_extras (state->file)->top_left_text =
+            caja_extract_top_left_text (file_contents, state->large, file_size);
         file_details->got_top_left_text = TRUE;
         file_details->got_large_top_left_text = (state->large != FALSE);
         g_free (file_contents);
     }
     else
     {
-        file_details->top_left_text = NULL;
         file_details->got_top_left_text = FALSE;
         file_details->got_large_top_left_text = FALSE;
     }
@@ -3609,8 +4167,11 @@ top_left_start (CajaDirectory *directory,
 
     if (!caja_file_contains_text (file))
     {
-        g_free (file->details->top_left_text);
-        file->details->top_left_text = NULL;
+        if (file->details->extras != NULL)
+        {
+            g_free (file->details->extras->top_left_text);
+            file->details->extras->top_left_text = NULL;
+        }
         file->details->got_top_left_text = FALSE;
         file->details->got_large_top_left_text = FALSE;
         file->details->top_left_text_is_up_to_date = TRUE;
@@ -3868,6 +4429,7 @@ link_info_done (CajaDirectory *directory,
                 gboolean is_launcher,
                 gboolean is_foreign)
 {
+    CajaFileExtras *extras;
     gboolean is_trusted;
 
     file->details->link_info_is_up_to_date = TRUE;
@@ -3884,18 +4446,21 @@ link_info_done (CajaDirectory *directory,
     }
 
     file->details->got_link_info = TRUE;
-    g_free (file->details->custom_icon);
-    file->details->custom_icon = NULL;
+    if (file->details->extras != NULL)
+    {
+        g_free (file->details->extras->custom_icon);
+        file->details->extras->custom_icon = NULL;
+    }
     if (uri)
     {
-        g_free (file->details->activation_uri);
-        file->details->activation_uri = NULL;
+        extras = caja_file_get_extras (file);
+        g_free (extras->activation_uri);
         file->details->got_custom_activation_uri = TRUE;
-        file->details->activation_uri = g_strdup (uri);
+        extras->activation_uri = g_strdup (uri);
     }
-    if (is_trusted)
+    if (is_trusted && icon != NULL)
     {
-        file->details->custom_icon = g_strdup (icon);
+        caja_file_get_extras (file)->custom_icon = g_strdup (icon);
     }
     file->details->is_launcher = (is_launcher != FALSE);
     file->details->is_foreign_link = (is_foreign != FALSE);
@@ -4800,14 +5365,17 @@ finish_info_provider (CajaDirectory *directory,
                       CajaFile *file,
                       CajaInfoProvider *provider)
 {
-    file->details->pending_info_providers =
-        g_list_remove  (file->details->pending_info_providers,
+    CajaFileExtensionInfo *extension_info;
+
+    extension_info = caja_file_get_extension_info (file);
+    extension_info->pending_info_providers =
+        g_list_remove  (extension_info->pending_info_providers,
                         provider);
     g_object_unref (provider);
 
     caja_directory_async_state_changed (directory);
 
-    if (file->details->pending_info_providers == NULL)
+    if (extension_info->pending_info_providers == NULL)
     {
         caja_file_info_providers_done (file);
     }
@@ -4892,7 +5460,7 @@ extension_info_start (CajaDirectory *directory,
         return;
     }
 
-    provider = file->details->pending_info_providers->data;
+    provider = file->details->extension_info->pending_info_providers->data;
 
     update_complete = g_cclosure_new (G_CALLBACK (info_provider_callback),
                                       directory,
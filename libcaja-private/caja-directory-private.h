@@ -49,6 +49,7 @@ typedef struct MimeListState MimeListState;
 typedef struct ThumbnailState ThumbnailState;
 typedef struct MountState MountState;
 typedef struct FilesystemInfoState FilesystemInfoState;
+typedef struct AsyncJobClass AsyncJobClass;
 
 typedef enum
 {
@@ -89,18 +90,22 @@ struct _CajaDirectoryPrivate
     CajaFileQueue *low_priority_queue;
     CajaFileQueue *extension_queue;
 
-    /* These lists are going to be pretty short.  If we think they
-     * are going to get big, we can use hash tables instead.
+    /* Pending requests, keyed by the file they are for (NULL
+     * meaning all files), each value being a list of requests.
+     * Call when ready callbacks move from the active table to the
+     * triggered one once satisfied, until they are called at idle.
      */
-    GList *call_when_ready_list;
+    GHashTable *call_when_ready_active;
+    GHashTable *call_when_ready_triggered;
     RequestCounter call_when_ready_counters;
-    GList *monitor_list;
+    GHashTable *monitor_table;
     RequestCounter monitor_counters;
     guint call_ready_idle_id;
 
     CajaMonitor *monitor;
     gulong 		 mime_db_monitor;
 
+    AsyncJobClass *async_job_class;
     gboolean in_async_service_loop;
     gboolean state_changed;
 
@@ -241,6 +246,7 @@ void               caja_directory_remove_file_from_work_queue     (CajaDirectory
 
 /* debugging functions */
 int                caja_directory_number_outstanding              (void);
+char *             caja_directory_get_async_statistics            (void);
 
 #endif	/* __CAJA_DIRECTORY_PRIVATE_H__ */
 
@@ -116,6 +116,9 @@ caja_directory_init (CajaDirectory *directory)
 {
     directory->details = caja_directory_get_instance_private (directory);
     directory->details->file_hash = g_hash_table_new (g_str_hash, g_str_equal);
+    directory->details->call_when_ready_active = g_hash_table_new (NULL, NULL);
+    directory->details->call_when_ready_triggered = g_hash_table_new (NULL, NULL);
+    directory->details->monitor_table = g_hash_table_new (NULL, NULL);
     directory->details->high_priority_queue = caja_file_queue_new ();
     directory->details->low_priority_queue = caja_file_queue_new ();
     directory->details->extension_queue = caja_file_queue_new ();
@@ -149,6 +152,21 @@ caja_directory_unref (CajaDirectory *directory)
     g_object_unref (directory);
 }
 
+static void
+free_request_list (gpointer key,
+                   gpointer value,
+                   gpointer user_data)
+{
+    g_list_free_full (value, g_free);
+}
+
+static void
+request_table_destroy (GHashTable *table)
+{
+    g_hash_table_foreach (table, free_request_list, NULL);
+    g_hash_table_destroy (table);
+}
+
 static void
 caja_directory_finalize (GObject *object)
 {
@@ -162,11 +180,13 @@ caja_directory_finalize (GObject *object)
     g_assert (directory->details->count_in_progress == NULL);
     g_assert (directory->details->top_left_read_state == NULL);
 
-    if (directory->details->monitor_list != NULL)
+    if (g_hash_table_size (directory->details->monitor_table) != 0)
     {
         g_warning ("destroying a CajaDirectory while it's being monitored");
-        g_list_free_full (directory->details->monitor_list, g_free);
     }
+    request_table_destroy (directory->details->monitor_table);
+    request_table_destroy (directory->details->call_when_ready_active);
+    request_table_destroy (directory->details->call_when_ready_triggered);
 
     if (directory->details->monitor != NULL)
     {
@@ -23,7 +23,9 @@
 #include <config.h>
 #include "caja-file-changes-queue.h"
 
+#include "caja-debug-log.h"
 #include "caja-directory-notify.h"
+#include "caja-directory-private.h"
 
 typedef enum
 {
@@ -50,8 +52,34 @@ typedef struct
     GList *head;
     GList *tail;
     GMutex mutex;
+
+    /* Statistics, see caja_file_changes_queue_get_statistics().
+     * Lock mutex when accessing these. */
+    guint64 n_changes_queued;
+    guint64 n_changes_coalesced;
+    guint64 n_changes_dropped_for_reload;
+    guint64 n_changes_sent;
+    guint64 n_directory_reloads;
 } CajaFileChangesQueue;
 
+/* A directory that gets more than CHURN_RELOAD_THRESHOLD additions,
+ * changes and removals within CHURN_WINDOW_MSEC is reloaded once at the
+ * end of that time, instead of being sent the rest of them.
+ */
+#define CHURN_WINDOW_MSEC 1000
+#define CHURN_RELOAD_THRESHOLD 500
+
+typedef struct
+{
+    guint n_changes;
+    gboolean reload;
+} DirectoryChurn;
+
+/* Maps parent locations to their DirectoryChurn in the current window.
+ * Only used from the main thread. */
+static GHashTable *churning_directories = NULL;
+static guint churn_window_timeout_id = 0;
+
 static CajaFileChangesQueue *
 caja_file_changes_queue_new (void)
 {
@@ -87,6 +115,7 @@ caja_file_changes_queue_add_common (CajaFileChangesQueue *queue,
     queue->head = g_list_prepend (queue->head, new_item);
     if (queue->tail == NULL)
         queue->tail = queue->head;
+    queue->n_changes_queued++;
 
     g_mutex_unlock (&queue->mutex);
 }
@@ -142,7 +171,7 @@ caja_file_changes_queue_file_moved (GFile *from,
 
     queue = caja_file_changes_queue_get ();
 
-    new_item = g_new (CajaFileChange, 1);
+    new_item = g_new0 (CajaFileChange, 1);
     new_item->kind = CHANGE_FILE_MOVED;
     new_item->from = g_object_ref (from);
     new_item->to = g_object_ref (to);
@@ -159,7 +188,7 @@ caja_file_changes_queue_schedule_position_set (GFile *location,
 
     queue = caja_file_changes_queue_get ();
 
-    new_item = g_new (CajaFileChange, 1);
+    new_item = g_new0 (CajaFileChange, 1);
     new_item->kind = CHANGE_POSITION_SET;
     new_item->from = g_object_ref (location);
     new_item->point = point;
@@ -175,40 +204,348 @@ caja_file_changes_queue_schedule_position_remove (GFile *location)
 
     queue = caja_file_changes_queue_get ();
 
-    new_item = g_new (CajaFileChange, 1);
+    new_item = g_new0 (CajaFileChange, 1);
     new_item->kind = CHANGE_POSITION_REMOVE;
     new_item->from = g_object_ref (location);
     caja_file_changes_queue_add_common (queue, new_item);
 }
 
-static CajaFileChange *
-caja_file_changes_queue_get_change (CajaFileChangesQueue *queue)
+/* Takes all the queued changes, oldest first */
+static GList *
+caja_file_changes_queue_take_changes (CajaFileChangesQueue *queue)
 {
-    GList *new_tail;
-    CajaFileChange *result;
+    GList *result;
 
     g_assert (queue != NULL);
 
-    /* dequeue the tail item while locking down the list */
     g_mutex_lock (&queue->mutex);
 
-    if (queue->tail == NULL)
+    result = g_list_reverse (queue->head);
+    queue->head = NULL;
+    queue->tail = NULL;
+
+    g_mutex_unlock (&queue->mutex);
+
+    return result;
+}
+
+static void
+caja_file_change_free (CajaFileChange *change)
+{
+    g_object_unref (change->from);
+    if (change->to != NULL)
     {
-        result = NULL;
+        g_object_unref (change->to);
     }
-    else
+    g_free (change);
+}
+
+/* What is still pending for a location among the changes being
+ * coalesced */
+typedef struct
+{
+    CajaFileChangeKind last_kind;
+    /* Links of the additions and changes since the last removal */
+    GList *supersedable;
+} LocationChanges;
+
+static void
+location_changes_free (LocationChanges *location_changes)
+{
+    g_list_free (location_changes->supersedable);
+    g_free (location_changes);
+}
+
+static gboolean
+location_is_known (GFile *location)
+{
+    CajaFile *file;
+
+    file = caja_file_get_existing (location);
+    if (file == NULL)
     {
-        new_tail = queue->tail->prev;
-        result = queue->tail->data;
-        queue->head = g_list_remove_link (queue->head,
-                                          queue->tail);
-        g_list_free_1 (queue->tail);
-        queue->tail = new_tail;
+        return FALSE;
     }
 
+    caja_file_unref (file);
+    return TRUE;
+}
+
+/* Drops the additions, changes and removals that make no difference
+ * given the ones that follow them for the same location: repeats of the
+ * same kind, changes to a file that is only being added, and anything
+ * before a removal. Moves and position requests are kept in place, and
+ * nothing is coalesced across them.
+ */
+static GList *
+coalesce_changes (CajaFileChangesQueue *queue,
+                  GList *changes)
+{
+    GHashTable *locations;
+    LocationChanges *location_changes;
+    CajaFileChange *change;
+    GList *l, *next, *s;
+    guint n_coalesced;
+
+    locations = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                       g_object_unref,
+                                       (GDestroyNotify) location_changes_free);
+    n_coalesced = 0;
+
+    for (l = changes; l != NULL; l = next)
+    {
+        next = l->next;
+        change = l->data;
+
+        switch (change->kind)
+        {
+        case CHANGE_FILE_ADDED:
+        case CHANGE_FILE_CHANGED:
+        case CHANGE_FILE_REMOVED:
+            break;
+
+        case CHANGE_FILE_MOVED:
+            g_hash_table_remove (locations, change->to);
+            /* fall through */
+        default:
+            g_hash_table_remove (locations, change->from);
+            continue;
+        }
+
+        location_changes = g_hash_table_lookup (locations, change->from);
+        if (location_changes == NULL)
+        {
+            location_changes = g_new0 (LocationChanges, 1);
+            location_changes->last_kind = change->kind;
+            if (change->kind != CHANGE_FILE_REMOVED)
+            {
+                location_changes->supersedable = g_list_prepend (NULL, l);
+            }
+            g_hash_table_insert (locations, g_object_ref (change->from),
+                                 location_changes);
+            continue;
+        }
+
+        if (change->kind == location_changes->last_kind ||
+                (change->kind == CHANGE_FILE_CHANGED &&
+                 location_changes->last_kind == CHANGE_FILE_ADDED &&
+                 !location_is_known (change->from)))
+        {
+            caja_file_change_free (change);
+            changes = g_list_delete_link (changes, l);
+            n_coalesced++;
+            continue;
+        }
+
+        if (change->kind == CHANGE_FILE_REMOVED)
+        {
+            for (s = location_changes->supersedable; s != NULL; s = s->next)
+            {
+                caja_file_change_free (((GList *) s->data)->data);
+                changes = g_list_delete_link (changes, s->data);
+                n_coalesced++;
+            }
+            g_list_free (location_changes->supersedable);
+            location_changes->supersedable = NULL;
+        }
+        else
+        {
+            location_changes->supersedable =
+                g_list_prepend (location_changes->supersedable, l);
+        }
+        location_changes->last_kind = change->kind;
+    }
+
+    g_hash_table_destroy (locations);
+
+    g_mutex_lock (&queue->mutex);
+    queue->n_changes_coalesced += n_coalesced;
     g_mutex_unlock (&queue->mutex);
 
-    return result;
+    return changes;
+}
+
+static void
+log_statistics (void)
+{
+    char *statistics;
+
+    statistics = caja_file_changes_queue_get_statistics ();
+    caja_debug_log (FALSE, CAJA_DEBUG_LOG_DOMAIN_ASYNC, "%s", statistics);
+    g_free (statistics);
+}
+
+static gboolean
+churn_window_timeout_callback (gpointer callback_data)
+{
+    CajaFileChangesQueue *queue;
+    CajaDirectory *directory;
+    DirectoryChurn *churn;
+    GHashTableIter iter;
+    GFile *location;
+    guint n_reloads;
+
+    queue = callback_data;
+    n_reloads = 0;
+
+    g_hash_table_iter_init (&iter, churning_directories);
+    while (g_hash_table_iter_next (&iter, (gpointer *) &location, (gpointer *) &churn))
+    {
+        if (!churn->reload)
+        {
+            continue;
+        }
+
+        directory = caja_directory_get_existing (location);
+        if (directory != NULL)
+        {
+            caja_directory_force_reload (directory);
+            caja_directory_unref (directory);
+            n_reloads++;
+        }
+        else
+        {
+            CajaFile *file;
+
+            /* Nobody has the directory loaded, but its item
+             * count may be shown */
+            file = caja_file_get_existing (location);
+            if (file != NULL)
+            {
+                caja_file_invalidate_count_and_mime_list (file);
+                caja_file_unref (file);
+            }
+        }
+    }
+    g_hash_table_remove_all (churning_directories);
+    churn_window_timeout_id = 0;
+
+    if (n_reloads > 0)
+    {
+        g_mutex_lock (&queue->mutex);
+        queue->n_directory_reloads += n_reloads;
+        g_mutex_unlock (&queue->mutex);
+
+        log_statistics ();
+    }
+
+    return FALSE;
+}
+
+/* Counts the additions, changes and removals each directory gets, and
+ * drops them for the directories that get too many to keep up with,
+ * which are reloaded instead.
+ */
+static GList *
+drop_changes_of_churning_directories (CajaFileChangesQueue *queue,
+                                      GList *changes)
+{
+    CajaFileChange *change;
+    DirectoryChurn *churn;
+    GFile *parent;
+    GList *l, *next;
+    guint n_dropped;
+
+    if (churning_directories == NULL)
+    {
+        churning_directories = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                                      g_object_unref, g_free);
+    }
+
+    n_dropped = 0;
+    for (l = changes; l != NULL; l = next)
+    {
+        next = l->next;
+        change = l->data;
+
+        if (change->kind != CHANGE_FILE_ADDED &&
+                change->kind != CHANGE_FILE_CHANGED &&
+                change->kind != CHANGE_FILE_REMOVED)
+        {
+            continue;
+        }
+
+        parent = g_file_get_parent (change->from);
+        if (parent == NULL)
+        {
+            continue;
+        }
+
+        churn = g_hash_table_lookup (churning_directories, parent);
+        if (churn == NULL)
+        {
+            churn = g_new0 (DirectoryChurn, 1);
+            g_hash_table_insert (churning_directories, g_object_ref (parent), churn);
+        }
+        g_object_unref (parent);
+
+        if (churn_window_timeout_id == 0)
+        {
+            churn_window_timeout_id = g_timeout_add (CHURN_WINDOW_MSEC,
+                                      churn_window_timeout_callback,
+                                      queue);
+        }
+
+        churn->n_changes++;
+        if (churn->n_changes > CHURN_RELOAD_THRESHOLD)
+        {
+            churn->reload = TRUE;
+        }
+
+        if (churn->reload)
+        {
+            caja_file_change_free (change);
+            changes = g_list_delete_link (changes, l);
+            n_dropped++;
+        }
+    }
+
+    g_mutex_lock (&queue->mutex);
+    queue->n_changes_dropped_for_reload += n_dropped;
+    g_mutex_unlock (&queue->mutex);
+
+    return changes;
+}
+
+static GList *
+caja_file_changes_queue_take_coalesced_changes (CajaFileChangesQueue *queue)
+{
+    GList *changes;
+
+    changes = caja_file_changes_queue_take_changes (queue);
+    changes = coalesce_changes (queue, changes);
+    changes = drop_changes_of_churning_directories (queue, changes);
+
+    return changes;
+}
+
+/**
+ * caja_file_changes_queue_get_statistics:
+ *
+ * Returns a description of how many changes have been queued, how many
+ * of them were coalesced or dropped for directories that were reloaded
+ * instead, and how many were sent to the directories, for debugging.
+ *
+ * Return value: A newly allocated string.
+ **/
+char *
+caja_file_changes_queue_get_statistics (void)
+{
+    CajaFileChangesQueue *queue;
+    char *statistics;
+
+    queue = caja_file_changes_queue_get ();
+
+    g_mutex_lock (&queue->mutex);
+    statistics = g_strdup_printf ("file changes: %" G_GUINT64_FORMAT " queued, %" G_GUINT64_FORMAT " coalesced, "
+                                  "%" G_GUINT64_FORMAT " dropped for %" G_GUINT64_FORMAT " directory reloads, "
+                                  "%" G_GUINT64_FORMAT " sent\n",
+                                  queue->n_changes_queued, queue->n_changes_coalesced,
+                                  queue->n_changes_dropped_for_reload, queue->n_directory_reloads,
+                                  queue->n_changes_sent);
+    g_mutex_unlock (&queue->mutex);
+
+    return statistics;
 }
 
 enum
@@ -265,12 +602,16 @@ caja_file_changes_consume_changes (gboolean consume_all)
     guint chunk_count;
     CajaFileChangesQueue *queue;
     gboolean flush_needed;
+    GList *pending;
+    guint n_sent;
 
     additions = NULL;
     changes = NULL;
     deletions = NULL;
     moves = NULL;
     position_set_requests = NULL;
+    pending = NULL;
+    n_sent = 0;
 
     queue = caja_file_changes_queue_get();
 
@@ -281,7 +622,17 @@ caja_file_changes_consume_changes (gboolean consume_all)
      */
     for (chunk_count = 0; ; chunk_count++)
     {
-        change = caja_file_changes_queue_get_change (queue);
+        if (pending == NULL)
+        {
+            pending = caja_file_changes_queue_take_coalesced_changes (queue);
+        }
+
+        change = NULL;
+        if (pending != NULL)
+        {
+            change = pending->data;
+            pending = g_list_delete_link (pending, pending);
+        }
 
         /* figure out if we need to flush the pending changes that we collected sofar */
 
@@ -365,9 +716,14 @@ caja_file_changes_consume_changes (gboolean consume_all)
         if (change == NULL)
         {
             /* we are done */
+            g_mutex_lock (&queue->mutex);
+            queue->n_changes_sent += n_sent;
+            g_mutex_unlock (&queue->mutex);
             return;
         }
 
+        n_sent++;
+
         /* add the new change to the list */
         switch (change->kind)
         {
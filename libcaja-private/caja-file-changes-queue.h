@@ -38,4 +38,6 @@ void caja_file_changes_queue_schedule_position_remove        (GFile      *locati
 
 void caja_file_changes_consume_changes                       (gboolean    consume_all);
 
+char *caja_file_changes_queue_get_statistics                 (void);
+
 #endif /* CAJA_FILE_CHANGES_QUEUE_H */
@@ -26,6 +26,9 @@
             Pavel Cisler <pavel@eazel.com>
  */
 
+/* For copy_file_range() */
+#define _GNU_SOURCE
+
 #include <config.h>
 #include <string.h>
 #include <stdio.h>
@@ -33,7 +36,15 @@
 #include <locale.h>
 #include <math.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>
+#endif
 #include <stdlib.h>
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
@@ -87,6 +98,23 @@ typedef struct {
 	CajaUndoStackActionData* undo_redo_data;
 } CommonJob;
 
+/* How the contents of a copied file got to the destination */
+typedef enum {
+	COPY_METHOD_CLONE,
+	COPY_METHOD_COPY_FILE_RANGE,
+	COPY_METHOD_GIO,
+	N_COPY_METHODS
+} CopyMethod;
+
+typedef struct {
+	GMutex mutex;
+	guint n_files[N_COPY_METHODS];
+	goffset n_bytes[N_COPY_METHODS];
+	gint64 usecs[N_COPY_METHODS];
+	/* Of n_files, those copied by the copy pool */
+	guint n_pool_files[N_COPY_METHODS];
+} CopyStatistics;
+
 typedef struct {
 	CommonJob common;
 	gboolean is_move;
@@ -98,6 +126,8 @@ typedef struct {
 	GHashTable *debuting_files;
 	CajaCopyCallback  done_callback;
 	gpointer done_callback_data;
+	GThreadPool *copy_pool;
+	CopyStatistics *copy_statistics;
 } CopyMoveJob;
 
 typedef struct {
@@ -160,11 +190,14 @@ typedef enum {
 	OP_KIND_TRASH
 } OpKind;
 
+typedef struct _SourceScan SourceScan;
+
 typedef struct {
 	int num_files;
 	goffset num_bytes;
 	int num_files_since_progress;
 	OpKind op;
+	SourceScan *scan; /* non-NULL while the totals are still being counted */
 } SourceInfo;
 
 typedef struct {
@@ -242,6 +275,14 @@ static void scan_sources (GList *files,
 			  SourceInfo *source_info,
 			  CommonJob *job,
 			  OpKind kind);
+static void source_scan_start (GList *files,
+			       SourceInfo *source_info,
+			       CommonJob *job,
+			       OpKind kind);
+static void source_scan_finish (SourceInfo *source_info);
+static gboolean source_info_refresh (SourceInfo *source_info);
+static gboolean more_files_left (SourceInfo *source_info,
+				 TransferInfo *transfer_info);
 
 static gboolean empty_trash_job (GIOSchedulerJob *io_job,
 				 GCancellable *cancellable,
@@ -1508,6 +1549,8 @@ report_delete_progress (CommonJob *job,
 	}
 	transfer_info->last_report_time = now;
 
+	source_info_refresh (source_info);
+
 	files_left = source_info->num_files - transfer_info->num_files;
 
 	/* Races and whatnot could cause this to be negative... */
@@ -1556,8 +1599,251 @@ report_delete_progress (CommonJob *job,
 	g_free (files_left_s);
 
 	if (source_info->num_files != 0) {
-		caja_progress_info_set_progress (job->progress, transfer_info->num_files, source_info->num_files);
+		/* Files deleted before they were counted make the
+		 * streamed total lag behind */
+		caja_progress_info_set_progress (job->progress, transfer_info->num_files,
+						 MAX (source_info->num_files, transfer_info->num_files));
+	}
+}
+
+/* The contents of a local folder are deleted by several threads, one
+ * folder at a time each, before the folder is walked the usual way.
+ * The threads give up quietly on anything they can't delete, so the
+ * walk only finds what is left and asks about it as it always did.
+ *
+ * Everything is opened and removed relative to the open parent folder,
+ * so a folder swapped for a link while this runs is never followed.
+ * Deeper folders go first, which keeps few folders open at a time.
+ */
+#define PARALLEL_DELETE_MAX_THREADS 8
+#define PARALLEL_DELETE_PROGRESS_INTERVAL (G_USEC_PER_SEC / 10)
+#define PARALLEL_DELETE_BATCH 256
+
+typedef struct _ParallelDeleteDir ParallelDeleteDir;
+
+struct _ParallelDeleteDir {
+	ParallelDeleteDir *parent;
+	char *name;
+	/* Only used to tell the views */
+	char *path;
+	guint depth;
+	/* Open from the listing until the folder is done with */
+	int fd;
+	/* The listing itself plus each subfolder not yet removed */
+	gint pending;
+	gint failed;
+};
+
+typedef struct {
+	GThreadPool *pool;
+	GCancellable *cancellable;
+	gint n_deleted;
+	GMutex mutex;
+	GCond cond;
+	gboolean done;
+} ParallelDelete;
+
+static void
+parallel_delete_dir_free (ParallelDeleteDir *dir)
+{
+	if (dir->fd >= 0) {
+		close (dir->fd);
+	}
+	g_free (dir->name);
+	g_free (dir->path);
+	g_free (dir);
+}
+
+static gint
+parallel_delete_compare_depth (gconstpointer a,
+			       gconstpointer b,
+			       gpointer user_data)
+{
+	const ParallelDeleteDir *dir_a = a, *dir_b = b;
+
+	if (dir_a->depth == dir_b->depth) {
+		return 0;
+	}
+	return dir_a->depth > dir_b->depth ? -1 : 1;
+}
+
+static void
+parallel_delete_dir_done (ParallelDelete *delete,
+			  ParallelDeleteDir *dir)
+{
+	ParallelDeleteDir *parent;
+	GFile *file;
+
+	while (g_atomic_int_dec_and_test (&dir->pending)) {
+		parent = dir->parent;
+		if (parent == NULL) {
+			/* The folder itself is left for delete_dir() */
+			g_mutex_lock (&delete->mutex);
+			delete->done = TRUE;
+			g_cond_signal (&delete->cond);
+			g_mutex_unlock (&delete->mutex);
+			return;
+		}
+
+		if (dir->fd >= 0) {
+			close (dir->fd);
+			dir->fd = -1;
+		}
+
+		if (g_atomic_int_get (&dir->failed) ||
+		    unlinkat (parent->fd, dir->name, AT_REMOVEDIR) != 0) {
+			g_atomic_int_set (&parent->failed, TRUE);
+		} else {
+			file = g_file_new_for_path (dir->path);
+			caja_file_changes_queue_file_removed (file);
+			g_object_unref (file);
+			g_atomic_int_inc (&delete->n_deleted);
+		}
+
+		parallel_delete_dir_free (dir);
+		dir = parent;
+	}
+}
+
+/* Runs in a thread of the delete pool */
+static void
+parallel_delete_run (gpointer data,
+		     gpointer user_data)
+{
+	ParallelDelete *delete;
+	ParallelDeleteDir *dir, *child;
+	struct dirent *entry;
+	struct stat statbuf;
+	DIR *dirp;
+	int fd, n_deleted;
+
+	dir = data;
+	delete = user_data;
+
+	if (dir->parent == NULL) {
+		dir->fd = open (dir->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	} else {
+		dir->fd = openat (dir->parent->fd, dir->name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	}
+	/* The listing gets its own descriptor, dir->fd stays open for
+	 * the subfolders */
+	fd = dir->fd >= 0 ? dup (dir->fd) : -1;
+	dirp = fd >= 0 ? fdopendir (fd) : NULL;
+	if (dirp == NULL) {
+		if (fd >= 0) {
+			close (fd);
+		}
+		g_atomic_int_set (&dir->failed, TRUE);
+		parallel_delete_dir_done (delete, dir);
+		return;
+	}
+
+	n_deleted = 0;
+	for (;;) {
+		if (g_cancellable_is_cancelled (delete->cancellable)) {
+			g_atomic_int_set (&dir->failed, TRUE);
+			break;
+		}
+
+		errno = 0;
+		entry = readdir (dirp);
+		if (entry == NULL) {
+			if (errno != 0) {
+				g_atomic_int_set (&dir->failed, TRUE);
+			}
+			break;
+		}
+		if (strcmp (entry->d_name, ".") == 0 ||
+		    strcmp (entry->d_name, "..") == 0) {
+			continue;
+		}
+
+		if (entry->d_type != DT_DIR) {
+			if (unlinkat (dir->fd, entry->d_name, 0) == 0) {
+				if (++n_deleted == PARALLEL_DELETE_BATCH) {
+					g_atomic_int_add (&delete->n_deleted, n_deleted);
+					n_deleted = 0;
+				}
+				continue;
+			}
+			/* The type may not have been known */
+			if ((errno != EISDIR && errno != EPERM) ||
+			    fstatat (dir->fd, entry->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) != 0 ||
+			    !S_ISDIR (statbuf.st_mode)) {
+				g_atomic_int_set (&dir->failed, TRUE);
+				continue;
+			}
+		}
+
+		child = g_new0 (ParallelDeleteDir, 1);
+		child->parent = dir;
+		child->name = g_strdup (entry->d_name);
+		child->path = g_build_filename (dir->path, entry->d_name, NULL);
+		child->depth = dir->depth + 1;
+		child->fd = -1;
+		child->pending = 1;
+		g_atomic_int_inc (&dir->pending);
+		g_thread_pool_push (delete->pool, child, NULL);
+	}
+
+	closedir (dirp);
+	g_atomic_int_add (&delete->n_deleted, n_deleted);
+
+	parallel_delete_dir_done (delete, dir);
+}
+
+static void
+delete_dir_contents_in_parallel (CommonJob *job,
+				 GFile *dir,
+				 SourceInfo *source_info,
+				 TransferInfo *transfer_info)
+{
+	ParallelDelete delete;
+	ParallelDeleteDir *root;
+	char *path;
+	int num_files;
+
+	path = g_file_get_path (dir);
+	if (path == NULL) {
+		return;
+	}
+
+	memset (&delete, 0, sizeof (delete));
+	delete.cancellable = job->cancellable;
+	g_mutex_init (&delete.mutex);
+	g_cond_init (&delete.cond);
+	delete.pool = g_thread_pool_new (parallel_delete_run, &delete,
+					 CLAMP (g_get_num_processors (), 2, PARALLEL_DELETE_MAX_THREADS),
+					 FALSE, NULL);
+	g_thread_pool_set_sort_function (delete.pool, parallel_delete_compare_depth, NULL);
+
+	root = g_new0 (ParallelDeleteDir, 1);
+	root->path = path;
+	root->fd = -1;
+	root->pending = 1;
+
+	num_files = transfer_info->num_files;
+	g_thread_pool_push (delete.pool, root, NULL);
+
+	g_mutex_lock (&delete.mutex);
+	while (!delete.done) {
+		g_cond_wait_until (&delete.cond, &delete.mutex,
+				   g_get_monotonic_time () + PARALLEL_DELETE_PROGRESS_INTERVAL);
+		g_mutex_unlock (&delete.mutex);
+
+		transfer_info->num_files = num_files + g_atomic_int_get (&delete.n_deleted);
+		report_delete_progress (job, source_info, transfer_info);
+
+		g_mutex_lock (&delete.mutex);
 	}
+	g_mutex_unlock (&delete.mutex);
+
+	g_thread_pool_free (delete.pool, FALSE, TRUE);
+	transfer_info->num_files = num_files + delete.n_deleted;
+
+	g_mutex_clear (&delete.mutex);
+	g_cond_clear (&delete.cond);
+	parallel_delete_dir_free (root);
 }
 
 static void delete_file (CommonJob *job, GFile *file,
@@ -1584,6 +1870,12 @@ delete_dir (CommonJob *job, GFile *dir,
 
 	local_skipped_file = FALSE;
 
+	if (toplevel &&
+	    job->skip_files == NULL &&
+	    g_file_is_native (dir)) {
+		delete_dir_contents_in_parallel (job, dir, source_info, transfer_info);
+	}
+
 	skip_error = should_skip_readdir_error (job, dir);
  retry:
 	error = NULL;
@@ -1690,7 +1982,7 @@ delete_dir (CommonJob *job, GFile *dir,
 						primary,
 						secondary,
 						details,
-						(source_info->num_files - transfer_info->num_files) > 1,
+						more_files_left (source_info, transfer_info),
 						CANCEL, SKIP_ALL, SKIP,
 						NULL);
 
@@ -1767,7 +2059,7 @@ delete_file (CommonJob *job, GFile *file,
 					primary,
 					secondary,
 					details,
-					(source_info->num_files - transfer_info->num_files) > 1,
+					more_files_left (source_info, transfer_info),
 					CANCEL, SKIP_ALL, SKIP,
 					NULL);
 
@@ -1800,13 +2092,11 @@ delete_files (CommonJob *job, GList *files, guint *files_skipped)
 		return;
 	}
 
-	scan_sources (files,
-		      &source_info,
-		      job,
-		      OP_KIND_DELETE);
-	if (job_aborted (job)) {
-		return;
-	}
+	/* Start deleting while the files are still being counted */
+	source_scan_start (files,
+			   &source_info,
+			   job,
+			   OP_KIND_DELETE);
 
 	g_timer_start (job->time);
 
@@ -1827,6 +2117,8 @@ delete_files (CommonJob *job, GList *files, guint *files_skipped)
 			(*files_skipped)++;
 		}
 	}
+
+	source_scan_finish (&source_info);
 }
 
 static void
@@ -1853,12 +2145,443 @@ report_trash_progress (CommonJob *job,
 	}
 }
 
+/* Local files are moved to the trash a folder at a time: the .trashinfo
+ * files for a folder are all written first, then its files are renamed
+ * into the trash relative to the open folder. Anything that can't go
+ * this way is left to g_file_trash(), with the questions it always had.
+ */
+#define TRASH_BATCH_PROGRESS_INTERVAL 64
+
+typedef struct {
+	char *path;
+	/* Where the original paths are relative to, NULL for the home trash */
+	char *topdir;
+	int files_fd;
+	int info_fd;
+} TrashDir;
+
+typedef struct {
+	GFile *file;
+	char *name;
+	char *trash_name;
+	guint64 mtime;
+} TrashItem;
+
+typedef struct {
+	char *path;
+	GPtrArray *items;
+} TrashFolder;
+
+static void
+trash_dir_free (TrashDir *trash)
+{
+	if (trash == NULL) {
+		return;
+	}
+	close (trash->files_fd);
+	close (trash->info_fd);
+	g_free (trash->path);
+	g_free (trash->topdir);
+	g_free (trash);
+}
+
+static void
+trash_item_free (TrashItem *item)
+{
+	g_free (item->name);
+	g_free (item->trash_name);
+	g_free (item);
+}
+
+static void
+trash_folder_free (TrashFolder *folder)
+{
+	g_free (folder->path);
+	g_ptr_array_free (folder->items, TRUE);
+	g_free (folder);
+}
+
+static TrashDir *
+trash_dir_open (const char *path,
+		const char *topdir)
+{
+	TrashDir *trash;
+	struct stat statbuf;
+	int fd, files_fd, info_fd;
+
+	fd = open (path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat (fd, &statbuf) != 0 || statbuf.st_uid != getuid ()) {
+		close (fd);
+		return NULL;
+	}
+
+	mkdirat (fd, "files", 0700);
+	mkdirat (fd, "info", 0700);
+	files_fd = openat (fd, "files", O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	info_fd = openat (fd, "info", O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	close (fd);
+
+	if (files_fd < 0 || info_fd < 0) {
+		if (files_fd >= 0) {
+			close (files_fd);
+		}
+		if (info_fd >= 0) {
+			close (info_fd);
+		}
+		return NULL;
+	}
+
+	trash = g_new0 (TrashDir, 1);
+	trash->path = g_strdup (path);
+	trash->topdir = g_strdup (topdir);
+	trash->files_fd = files_fd;
+	trash->info_fd = info_fd;
+
+	return trash;
+}
+
+/* The top folder of the file system dir_path is in */
+static char *
+find_topdir (const char *dir_path,
+	     dev_t device)
+{
+	struct stat statbuf;
+	char *topdir, *parent;
+
+	topdir = g_strdup (dir_path);
+	while (strcmp (topdir, "/") != 0) {
+		parent = g_path_get_dirname (topdir);
+		if (g_lstat (parent, &statbuf) != 0 ||
+		    statbuf.st_dev != device) {
+			g_free (parent);
+			break;
+		}
+		g_free (topdir);
+		topdir = parent;
+	}
+
+	return topdir;
+}
+
+/* Picks the trash the way GIO does, except that a trash folder is only
+ * made for the home folder; other file systems must already have one. */
+static TrashDir *
+get_trash_dir_for_device (GHashTable *trash_dirs,
+			  const char *dir_path,
+			  dev_t device)
+{
+	TrashDir *trash;
+	struct stat statbuf;
+	gint64 *key;
+	char *path, *topdir, *relpath;
+	gpointer value;
+
+	key = g_new (gint64, 1);
+	*key = device;
+	if (g_hash_table_lookup_extended (trash_dirs, key, NULL, &value)) {
+		g_free (key);
+		return value;
+	}
+
+	trash = NULL;
+	if (g_stat (g_get_user_data_dir (), &statbuf) == 0 &&
+	    statbuf.st_dev == device) {
+		path = g_build_filename (g_get_user_data_dir (), "Trash", NULL);
+		g_mkdir_with_parents (path, 0700);
+		trash = trash_dir_open (path, NULL);
+		g_free (path);
+	} else {
+		topdir = find_topdir (dir_path, device);
+
+		path = g_build_filename (topdir, ".Trash", NULL);
+		if (g_lstat (path, &statbuf) == 0 &&
+		    S_ISDIR (statbuf.st_mode) &&
+		    (statbuf.st_mode & S_ISVTX) != 0) {
+			relpath = g_strdup_printf ("%d", getuid ());
+			g_free (path);
+			path = g_build_filename (topdir, ".Trash", relpath, NULL);
+			trash = trash_dir_open (path, topdir);
+			g_free (relpath);
+		}
+		g_free (path);
+
+		if (trash == NULL) {
+			relpath = g_strdup_printf (".Trash-%d", getuid ());
+			path = g_build_filename (topdir, relpath, NULL);
+			trash = trash_dir_open (path, topdir);
+			g_free (path);
+			g_free (relpath);
+		}
+
+		g_free (topdir);
+	}
+
+	g_hash_table_insert (trash_dirs, key, trash);
+
+	return trash;
+}
+
+/* Reserves a name in the trash for item and writes its .trashinfo */
+static gboolean
+write_trash_info (TrashDir *trash,
+		  TrashItem *item,
+		  const char *original_path,
+		  const char *deletion_date)
+{
+	struct stat statbuf;
+	const char *path;
+	char *info_name, *escaped, *contents;
+	gboolean res;
+	gsize len;
+	int fd, i;
+
+	path = original_path;
+	if (trash->topdir != NULL) {
+		path += strlen (trash->topdir);
+		while (*path == '/') {
+			path++;
+		}
+	}
+
+	for (i = 1; ; i++) {
+		if (i == 1) {
+			item->trash_name = g_strdup (item->name);
+		} else {
+			item->trash_name = g_strdup_printf ("%s.%d", item->name, i);
+		}
+		info_name = g_strconcat (item->trash_name, ".trashinfo", NULL);
+
+		fd = openat (trash->info_fd, info_name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+		if (fd >= 0 &&
+		    fstatat (trash->files_fd, item->trash_name, &statbuf, AT_SYMLINK_NOFOLLOW) != 0) {
+			break;
+		}
+		if (fd >= 0) {
+			/* A leftover without its info, keep away from it */
+			close (fd);
+			unlinkat (trash->info_fd, info_name, 0);
+		} else if (errno != EEXIST) {
+			g_free (info_name);
+			g_free (item->trash_name);
+			item->trash_name = NULL;
+			return FALSE;
+		}
+		g_free (info_name);
+		g_free (item->trash_name);
+	}
+
+	escaped = g_uri_escape_string (path, "/", FALSE);
+	contents = g_strdup_printf ("[Trash Info]\nPath=%s\nDeletionDate=%s\n",
+				    escaped, deletion_date);
+	len = strlen (contents);
+	res = write (fd, contents, len) == (gssize) len;
+	if (close (fd) != 0) {
+		res = FALSE;
+	}
+	if (!res) {
+		unlinkat (trash->info_fd, info_name, 0);
+		g_free (item->trash_name);
+		item->trash_name = NULL;
+	}
+
+	g_free (contents);
+	g_free (escaped);
+	g_free (info_name);
+
+	return res;
+}
+
+static gboolean
+path_has_prefix (const char *path,
+		 const char *prefix)
+{
+	gsize len;
+
+	len = strlen (prefix);
+	return strncmp (path, prefix, len) == 0 &&
+		(path[len] == 0 || path[len] == '/');
+}
+
+static void
+trash_folder (CommonJob *job,
+	      TrashFolder *folder,
+	      GHashTable *trash_dirs,
+	      const char *deletion_date,
+	      guint *files_trashed,
+	      guint total_files,
+	      GList **left)
+{
+	TrashDir *trash;
+	TrashItem *item;
+	struct stat statbuf;
+	GPtrArray *pending;
+	GList *removed, *l;
+	char *path, *info_name;
+	dev_t device;
+	guint i;
+	int dir_fd;
+
+	pending = g_ptr_array_new ();
+
+	dir_fd = open (folder->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	trash = NULL;
+	device = 0;
+	if (dir_fd >= 0 && fstat (dir_fd, &statbuf) == 0) {
+		device = statbuf.st_dev;
+		trash = get_trash_dir_for_device (trash_dirs, folder->path, device);
+	}
+
+	/* Write all the .trashinfo files first */
+	for (i = 0; i < folder->items->len; i++) {
+		item = g_ptr_array_index (folder->items, i);
+		path = g_build_filename (folder->path, item->name, NULL);
+
+		if (trash == NULL ||
+		    job_aborted (job) ||
+		    fstatat (dir_fd, item->name, &statbuf, AT_SYMLINK_NOFOLLOW) != 0 ||
+		    /* Mount points and anything in or around the trash */
+		    statbuf.st_dev != device ||
+		    path_has_prefix (path, trash->path) ||
+		    path_has_prefix (trash->path, path) ||
+		    !write_trash_info (trash, item, path, deletion_date)) {
+			*left = g_list_prepend (*left, item->file);
+		} else {
+			item->mtime = statbuf.st_mtime;
+			g_ptr_array_add (pending, item);
+		}
+		g_free (path);
+	}
+
+	/* Then move the files */
+	removed = NULL;
+	for (i = 0; i < pending->len; i++) {
+		item = g_ptr_array_index (pending, i);
+
+		caja_progress_info_get_ready (job->progress, job->time);
+
+		if (job_aborted (job) ||
+		    renameat (dir_fd, item->name, trash->files_fd, item->trash_name) != 0) {
+			info_name = g_strconcat (item->trash_name, ".trashinfo", NULL);
+			unlinkat (trash->info_fd, info_name, 0);
+			g_free (info_name);
+			*left = g_list_prepend (*left, item->file);
+			continue;
+		}
+
+		removed = g_list_prepend (removed, item->file);
+
+		// Start UNDO-REDO
+		caja_undostack_manager_data_add_trashed_file (job->undo_redo_data, item->file, item->mtime);
+		// End UNDO-REDO
+
+		(*files_trashed)++;
+		if (*files_trashed % TRASH_BATCH_PROGRESS_INTERVAL == 0) {
+			report_trash_progress (job, *files_trashed, total_files);
+		}
+	}
+
+	/* The views get these as one batch */
+	removed = g_list_reverse (removed);
+	for (l = removed; l != NULL; l = l->next) {
+		caja_file_changes_queue_file_removed (l->data);
+	}
+	g_list_free (removed);
+
+	if (dir_fd >= 0) {
+		close (dir_fd);
+	}
+	g_ptr_array_free (pending, TRUE);
+}
+
+/* Trashes what it can of files, and returns the files left for
+ * g_file_trash() */
+static GList *
+trash_files_in_batches (CommonJob *job,
+			GList *files,
+			guint *files_trashed,
+			guint total_files)
+{
+	GHashTable *folders, *trash_dirs;
+	GPtrArray *folder_order;
+	TrashFolder *folder;
+	TrashItem *item;
+	GDateTime *now;
+	GList *l, *left;
+	GFile *file, *parent;
+	char *deletion_date, *parent_path;
+	guint i;
+
+	folders = g_hash_table_new (g_str_hash, g_str_equal);
+	folder_order = g_ptr_array_new_with_free_func ((GDestroyNotify) trash_folder_free);
+	left = NULL;
+
+	for (l = files; l != NULL; l = l->next) {
+		file = l->data;
+
+		parent = g_file_get_parent (file);
+		parent_path = NULL;
+		if (parent != NULL && g_file_is_native (file)) {
+			parent_path = g_file_get_path (parent);
+		}
+		if (parent != NULL) {
+			g_object_unref (parent);
+		}
+		if (parent_path == NULL) {
+			left = g_list_prepend (left, file);
+			continue;
+		}
+
+		folder = g_hash_table_lookup (folders, parent_path);
+		if (folder == NULL) {
+			folder = g_new0 (TrashFolder, 1);
+			folder->path = parent_path;
+			folder->items = g_ptr_array_new_with_free_func ((GDestroyNotify) trash_item_free);
+			g_hash_table_insert (folders, folder->path, folder);
+			g_ptr_array_add (folder_order, folder);
+		} else {
+			g_free (parent_path);
+		}
+
+		item = g_new0 (TrashItem, 1);
+		item->file = file;
+		item->name = g_file_get_basename (file);
+		g_ptr_array_add (folder->items, item);
+	}
+
+	now = g_date_time_new_now_local ();
+	deletion_date = g_date_time_format (now, "%Y-%m-%dT%H:%M:%S");
+	g_date_time_unref (now);
+
+	trash_dirs = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+					    g_free, (GDestroyNotify) trash_dir_free);
+
+	for (i = 0; i < folder_order->len; i++) {
+		caja_progress_info_get_ready (job->progress, job->time);
+
+		trash_folder (job, g_ptr_array_index (folder_order, i),
+			      trash_dirs, deletion_date,
+			      files_trashed, total_files,
+			      &left);
+		report_trash_progress (job, *files_trashed, total_files);
+	}
+
+	g_hash_table_destroy (trash_dirs);
+	g_free (deletion_date);
+	g_ptr_array_free (folder_order, TRUE);
+	g_hash_table_destroy (folders);
+
+	return g_list_reverse (left);
+}
+
 static void
 trash_files (CommonJob *job, GList *files, guint *files_skipped)
 {
 	GList *l;
 	GFile *file;
-	GList *to_delete;
+	GList *left, *to_delete;
 	GError *error;
 	guint total_files, files_trashed;
 	char *primary, *secondary, *details;
@@ -1875,8 +2598,10 @@ trash_files (CommonJob *job, GList *files, guint *files_skipped)
 
 	report_trash_progress (job, files_trashed, total_files);
 
+	left = trash_files_in_batches (job, files, &files_trashed, total_files);
+
 	to_delete = NULL;
-	for (l = files;
+	for (l = left;
 	     l != NULL && !job_aborted (job);
 	     l = l->next) {
         caja_progress_info_get_ready (job->progress, job->time);
@@ -1943,6 +2668,8 @@ trash_files (CommonJob *job, GList *files, guint *files_skipped)
 		}
 	}
 
+	g_list_free (left);
+
 	if (to_delete) {
 		to_delete = g_list_reverse (to_delete);
 		delete_files (job, to_delete, files_skipped);
@@ -2833,9 +3560,199 @@ scan_sources (GList *files,
 	report_count_progress (job, source_info);
 }
 
-static char *
-get_verify_primary (OpKind kind,
-		GFile *dest)
+/* Streaming: the sources are counted by a thread of their own while
+ * the job already works on them. The counting doesn't ask anything, the
+ * job reports the errors when it gets to the files, and the SourceInfo
+ * of the job catches up with the totals whenever progress is reported.
+ */
+#define SOURCE_SCAN_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_STANDARD_NAME"," \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE"," \
+	G_FILE_ATTRIBUTE_STANDARD_SIZE"," \
+	G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE
+
+struct _SourceScan {
+	GList *files;
+	GCancellable *cancellable;
+	GThread *thread;
+
+	/* Lock mutex when accessing these */
+	GMutex mutex;
+	int num_files;
+	goffset num_bytes;
+	gboolean done;
+};
+
+static void
+source_scan_count (SourceScan *scan,
+		   GFileInfo *info)
+{
+	g_mutex_lock (&scan->mutex);
+	scan->num_files += 1;
+	scan->num_bytes += g_file_info_get_size (info);
+	g_mutex_unlock (&scan->mutex);
+}
+
+static gpointer
+source_scan_run (gpointer data)
+{
+	SourceScan *scan;
+	GFileEnumerator *enumerator;
+	GFileInfo *info;
+	GQueue dirs = G_QUEUE_INIT;
+	GFile *dir;
+	GList *l;
+
+	scan = data;
+
+	for (l = scan->files;
+	     l != NULL && !g_cancellable_is_cancelled (scan->cancellable);
+	     l = l->next) {
+		info = g_file_query_info (l->data,
+					  SOURCE_SCAN_ATTRIBUTES,
+					  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+					  scan->cancellable,
+					  NULL);
+		if (info == NULL) {
+			continue;
+		}
+
+		source_scan_count (scan, info);
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+			g_queue_push_head (&dirs, g_object_ref (l->data));
+		}
+		g_object_unref (info);
+
+		/* Same order as scan_file(), the job goes depth first too */
+		while (!g_cancellable_is_cancelled (scan->cancellable) &&
+		       (dir = g_queue_pop_head (&dirs)) != NULL) {
+			enumerator = g_file_enumerate_children (dir,
+								SOURCE_SCAN_ATTRIBUTES,
+								G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+								scan->cancellable,
+								NULL);
+			if (enumerator != NULL) {
+				while ((info = g_file_enumerator_next_file (enumerator,
+									    scan->cancellable,
+									    NULL)) != NULL) {
+					source_scan_count (scan, info);
+					if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+						g_queue_push_head (&dirs,
+								   g_file_get_child (dir, g_file_info_get_name (info)));
+					}
+					g_object_unref (info);
+				}
+				g_file_enumerator_close (enumerator, NULL, NULL);
+				g_object_unref (enumerator);
+			}
+			g_object_unref (dir);
+		}
+	}
+
+	while ((dir = g_queue_pop_head (&dirs)) != NULL) {
+		g_object_unref (dir);
+	}
+
+	g_mutex_lock (&scan->mutex);
+	scan->done = TRUE;
+	g_mutex_unlock (&scan->mutex);
+
+	return NULL;
+}
+
+static void
+source_scan_start (GList *files,
+		   SourceInfo *source_info,
+		   CommonJob *job,
+		   OpKind kind)
+{
+	SourceScan *scan;
+
+	memset (source_info, 0, sizeof (SourceInfo));
+	source_info->op = kind;
+
+	scan = g_new0 (SourceScan, 1);
+	scan->files = files;
+	scan->cancellable = g_cancellable_new ();
+	g_mutex_init (&scan->mutex);
+	scan->thread = g_thread_new ("caja-source-scan", source_scan_run, scan);
+
+	source_info->scan = scan;
+}
+
+/* Stops counting, if the job got done first */
+static void
+source_scan_finish (SourceInfo *source_info)
+{
+	SourceScan *scan;
+
+	scan = source_info->scan;
+	if (scan == NULL) {
+		return;
+	}
+
+	g_cancellable_cancel (scan->cancellable);
+	g_thread_join (scan->thread);
+
+	g_object_unref (scan->cancellable);
+	g_mutex_clear (&scan->mutex);
+	g_free (scan);
+	source_info->scan = NULL;
+}
+
+/* Takes the totals counted so far. Returns TRUE the one time the totals
+ * are found to be final, after which the SourceInfo stays as it is. */
+static gboolean
+source_info_refresh (SourceInfo *source_info)
+{
+	SourceScan *scan;
+	gboolean done;
+
+	scan = source_info->scan;
+	if (scan == NULL) {
+		return FALSE;
+	}
+
+	g_mutex_lock (&scan->mutex);
+	source_info->num_files = scan->num_files;
+	source_info->num_bytes = scan->num_bytes;
+	done = scan->done;
+	g_mutex_unlock (&scan->mutex);
+
+	if (done) {
+		source_scan_finish (source_info);
+	}
+
+	return done;
+}
+
+/* Whether a choice in an error dialog may apply to more than one file.
+ * The scan is left for the progress reports to finish, they act on it. */
+static gboolean
+more_files_left (SourceInfo *source_info,
+		 TransferInfo *transfer_info)
+{
+	SourceScan *scan;
+	gboolean done;
+	int num_files;
+
+	scan = source_info->scan;
+	if (scan == NULL) {
+		return source_info->num_files - transfer_info->num_files > 1;
+	}
+
+	g_mutex_lock (&scan->mutex);
+	num_files = scan->num_files;
+	done = scan->done;
+	g_mutex_unlock (&scan->mutex);
+
+	/* Files still being counted are left too */
+	return !done || num_files - transfer_info->num_files > 1;
+}
+
+static char *
+get_verify_primary (OpKind kind,
+		GFile *dest)
 {
 	switch (kind) {
 	default:
@@ -3035,6 +3952,23 @@ report_copy_progress (CopyMoveJob *copy_job,
 	}
 	transfer_info->last_report_time = now;
 
+	if (source_info_refresh (source_info)) {
+		GFile *dest;
+
+		/* Only now is it known how much space the rest takes */
+		if (copy_job->destination != NULL) {
+			dest = g_object_ref (copy_job->destination);
+		} else {
+			dest = g_file_get_parent (copy_job->files->data);
+		}
+		verify_destination (job,
+				    is_move ? OP_KIND_MOVE : OP_KIND_COPY,
+				    dest,
+				    NULL,
+				    source_info->num_bytes - transfer_info->num_bytes);
+		g_object_unref (dest);
+	}
+
 	files_left = source_info->num_files - transfer_info->num_files;
 
 	/* Races and whatnot could cause this to be negative... */
@@ -3556,6 +4490,478 @@ create_dest_dir (CommonJob *job,
 	return CREATE_DEST_DIR_SUCCESS;
 }
 
+/* Plain files between local folders are copied without the data going
+ * through caja: the destination shares the blocks of the source when the
+ * file system can clone them, or the kernel copies them otherwise. Any
+ * other copy, and anything these can't do, goes through g_file_copy().
+ */
+#define KERNEL_COPY_CHUNK_SIZE (64 * 1024 * 1024)
+
+typedef struct {
+	GFileProgressCallback callback;
+	gpointer data;
+	goffset num_bytes;
+} CopyProgress;
+
+static void
+count_copy_progress_callback (goffset current_num_bytes,
+			      goffset total_num_bytes,
+			      gpointer user_data)
+{
+	CopyProgress *progress;
+
+	progress = user_data;
+	progress->num_bytes = current_num_bytes;
+	if (progress->callback) {
+		progress->callback (current_num_bytes, total_num_bytes, progress->data);
+	}
+}
+
+/* Returns FALSE, with the destination left as it was, if the file has to
+ * be copied by GIO instead. Otherwise *res tells if the copy worked.
+ * If dest_created, dest is an empty file made for this copy, which is
+ * written into and left for the caller to remove on failure. */
+static gboolean
+copy_file_in_kernel (GFile *src,
+		     GFile *dest,
+		     gboolean dest_created,
+		     GFileCopyFlags flags,
+		     GCancellable *cancellable,
+		     GFileProgressCallback progress_callback,
+		     gpointer progress_data,
+		     CopyMethod *method,
+		     gboolean *res,
+		     GError **error)
+{
+#if defined (FICLONE) || defined (HAVE_COPY_FILE_RANGE)
+	char *src_path, *dest_path;
+	struct stat statbuf;
+	int src_fd, dest_fd;
+	int errsv;
+	mode_t mode;
+	goffset copied;
+	gboolean handled;
+
+	if (((flags & G_FILE_COPY_OVERWRITE) && !dest_created) ||
+	    !g_file_is_native (src) ||
+	    !g_file_is_native (dest)) {
+		return FALSE;
+	}
+
+	src_path = g_file_get_path (src);
+	dest_path = g_file_get_path (dest);
+	src_fd = dest_fd = -1;
+	handled = FALSE;
+
+	if (src_path == NULL || dest_path == NULL) {
+		goto out;
+	}
+
+	/* Symlinks, special files and errors are left to GIO, which
+	 * knows how to copy and report them */
+	src_fd = open (src_path, O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+	if (src_fd < 0) {
+		goto out;
+	}
+	/* Files in /proc and the like claim to be empty, read them */
+	if (fstat (src_fd, &statbuf) != 0 ||
+	    !S_ISREG (statbuf.st_mode) ||
+	    statbuf.st_size == 0) {
+		goto out;
+	}
+
+	if (flags & G_FILE_COPY_TARGET_DEFAULT_PERMS) {
+		mode = 0666;
+	} else {
+		mode = statbuf.st_mode & 0777;
+	}
+	if (dest_created) {
+		/* The mode is set with the other attributes afterwards */
+		dest_fd = open (dest_path, O_WRONLY | O_TRUNC | O_NOFOLLOW | O_CLOEXEC);
+	} else {
+		dest_fd = open (dest_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+	}
+	if (dest_fd < 0) {
+		goto out;
+	}
+
+	copied = 0;
+	errsv = 0;
+
+#ifdef FICLONE
+	if (ioctl (dest_fd, FICLONE, src_fd) == 0) {
+		*method = COPY_METHOD_CLONE;
+		copied = statbuf.st_size;
+		handled = TRUE;
+	}
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+	if (!handled) {
+		ssize_t n;
+
+		*method = COPY_METHOD_COPY_FILE_RANGE;
+		handled = TRUE;
+		for (;;) {
+			if (g_cancellable_is_cancelled (cancellable)) {
+				errsv = ECANCELED;
+				break;
+			}
+			n = copy_file_range (src_fd, NULL, dest_fd, NULL,
+					     KERNEL_COPY_CHUNK_SIZE, 0);
+			if (n < 0) {
+				errsv = errno;
+				if (errsv == EINTR) {
+					errsv = 0;
+					continue;
+				}
+				break;
+			}
+			if (n == 0) {
+				break;
+			}
+			copied += n;
+			if (progress_callback) {
+				progress_callback (copied, MAX (copied, statbuf.st_size), progress_data);
+			}
+		}
+
+		/* Not supported between these two file systems */
+		if (copied == 0 &&
+		    (errsv == ENOSYS || errsv == EXDEV || errsv == EINVAL ||
+		     errsv == EOPNOTSUPP || errsv == EBADF || errsv == EPERM)) {
+			handled = FALSE;
+		}
+	}
+#endif
+
+	if (!handled) {
+		close (dest_fd);
+		dest_fd = -1;
+		if (!dest_created) {
+			g_unlink (dest_path);
+		}
+		goto out;
+	}
+
+	if (close (dest_fd) != 0 && errsv == 0) {
+		errsv = errno;
+	}
+	dest_fd = -1;
+
+	if (errsv != 0) {
+		if (!dest_created) {
+			g_unlink (dest_path);
+		}
+		if (errsv == ECANCELED) {
+			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+					     _("Operation was cancelled"));
+		} else {
+			g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+				     _("Error copying file: %s"), g_strerror (errsv));
+		}
+		*res = FALSE;
+	} else {
+		if (progress_callback && *method == COPY_METHOD_CLONE) {
+			progress_callback (copied, copied, progress_data);
+		}
+		*res = TRUE;
+	}
+
+ out:
+	if (src_fd >= 0) {
+		close (src_fd);
+	}
+	if (dest_fd >= 0) {
+		close (dest_fd);
+	}
+	g_free (src_path);
+	g_free (dest_path);
+
+	return handled;
+#else
+	return FALSE;
+#endif
+}
+
+/* Copies the contents of src to a new dest the fastest way there is,
+ * counting the file in the job's statistics. Called from the job thread,
+ * and from the copy pool with dest_created as it makes dest first. */
+static gboolean
+copy_file_contents (CopyMoveJob *copy_job,
+		    GFile *src,
+		    GFile *dest,
+		    gboolean dest_created,
+		    GFileCopyFlags flags,
+		    GCancellable *cancellable,
+		    GFileProgressCallback progress_callback,
+		    gpointer progress_data,
+		    GError **error)
+{
+	CopyStatistics *statistics;
+	CopyProgress progress;
+	CopyMethod method;
+	gint64 start;
+	gboolean res;
+
+	progress.callback = progress_callback;
+	progress.data = progress_data;
+	progress.num_bytes = 0;
+
+	start = g_get_monotonic_time ();
+	if (!copy_file_in_kernel (src, dest, dest_created, flags, cancellable,
+				  count_copy_progress_callback, &progress,
+				  &method, &res, error)) {
+		method = COPY_METHOD_GIO;
+		if (dest_created) {
+			flags |= G_FILE_COPY_OVERWRITE;
+		}
+		res = g_file_copy (src, dest, flags, cancellable,
+				   count_copy_progress_callback, &progress,
+				   error);
+	}
+
+	statistics = copy_job->copy_statistics;
+	if (res && statistics != NULL) {
+		g_mutex_lock (&statistics->mutex);
+		statistics->n_files[method]++;
+		statistics->n_bytes[method] += progress.num_bytes;
+		statistics->usecs[method] += g_get_monotonic_time () - start;
+		if (dest_created) {
+			statistics->n_pool_files[method]++;
+		}
+		g_mutex_unlock (&statistics->mutex);
+	}
+
+	return res;
+}
+
+static void
+log_copy_statistics (CopyStatistics *statistics)
+{
+	static const char *method_names[N_COPY_METHODS] = {
+		"cloned", "copied by the kernel", "copied through GIO"
+	};
+	GString *str;
+	char *size;
+	int i;
+
+	str = g_string_new ("copy:");
+	for (i = 0; i < N_COPY_METHODS; i++) {
+		size = g_format_size (statistics->n_bytes[i]);
+		g_string_append_printf (str, " %u files (%s, %u in the pool) %s",
+					statistics->n_files[i], size,
+					statistics->n_pool_files[i], method_names[i]);
+		if (statistics->usecs[i] > 0) {
+			g_string_append_printf (str, " at %.1f MB/s",
+						statistics->n_bytes[i] / (double) statistics->usecs[i]);
+		}
+		g_string_append (str, i + 1 < N_COPY_METHODS ? "," : "");
+		g_free (size);
+	}
+
+	caja_debug_log (FALSE, CAJA_DEBUG_LOG_DOMAIN_ASYNC, "%s", str->str);
+	g_string_free (str, TRUE);
+}
+
+/* Small files in a folder being copied are copied by several threads
+ * at once, while the folder is still being read. A file that can't be
+ * copied without asking anything, and any other kind of file, is then
+ * copied the usual way, so conflicts, errors and undo work as before.
+ */
+#define PARALLEL_COPY_THREADS 8
+#define PARALLEL_COPY_MAX_SIZE (1024 * 1024)
+
+typedef struct {
+	CopyMoveJob *job;
+	GFile *src;
+	GFile *dest;
+	goffset size;
+	GFileCopyFlags flags;
+	GCancellable *cancellable;
+	GAsyncQueue *results;
+	GError *error;
+} ParallelCopy;
+
+static gboolean is_trusted_desktop_file (GFile *file,
+					 GCancellable *cancellable);
+
+static void
+parallel_copy_free (ParallelCopy *copy)
+{
+	g_object_unref (copy->src);
+	g_object_unref (copy->dest);
+	if (copy->error) {
+		g_error_free (copy->error);
+	}
+	g_free (copy);
+}
+
+/* Each pool thread has its own timer to stop while the job is paused,
+ * the job's timer belongs to the job thread */
+static GPrivate parallel_copy_timer = G_PRIVATE_INIT ((GDestroyNotify) g_timer_destroy);
+
+/* Runs in a thread of the job's copy pool */
+static void
+parallel_copy_run (gpointer data,
+		   gpointer user_data)
+{
+	ParallelCopy *copy;
+	GFileOutputStream *stream;
+	GTimer *timer;
+
+	copy = data;
+
+	timer = g_private_get (&parallel_copy_timer);
+	if (timer == NULL) {
+		timer = g_timer_new ();
+		g_private_set (&parallel_copy_timer, timer);
+	}
+	caja_progress_info_get_ready (copy->job->common.progress, timer);
+
+	/* Claim the destination before copying into it, so that a failed
+	 * copy never removes a file that was there before */
+	stream = NULL;
+	if (!g_cancellable_set_error_if_cancelled (copy->cancellable, &copy->error)) {
+		stream = g_file_create (copy->dest, G_FILE_CREATE_NONE,
+					copy->cancellable, &copy->error);
+	}
+	if (stream == NULL) {
+		g_async_queue_push (copy->results, copy);
+		return;
+	}
+	g_object_unref (stream);
+
+	if (copy_file_contents (copy->job, copy->src, copy->dest, TRUE,
+				copy->flags,
+				copy->cancellable,
+				NULL, NULL,
+				&copy->error)) {
+		/* Ignore errors here. Failure to copy metadata is not a hard error */
+		g_file_copy_attributes (copy->src, copy->dest,
+					copy->flags | G_FILE_COPY_ALL_METADATA,
+					copy->cancellable, NULL);
+	} else {
+		/* The file was made above, leave a clean slate for
+		 * the second attempt */
+		g_file_delete (copy->dest, NULL, NULL);
+	}
+
+	g_async_queue_push (copy->results, copy);
+}
+
+static GFile *
+get_target_file_for_info (GFile *src,
+			  GFileInfo *info,
+			  GFile *dest_dir,
+			  const char *dest_fs_type,
+			  gboolean same_fs)
+{
+	const char *copy_name;
+	char *name;
+	GFile *dest;
+
+	/* Like get_target_file(), without querying the copy name again */
+	dest = NULL;
+	copy_name = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_COPY_NAME);
+	if (!same_fs && copy_name != NULL) {
+		name = g_strdup (copy_name);
+		make_file_name_valid_for_dest_fs (name, dest_fs_type);
+		dest = g_file_get_child_for_display_name (dest_dir, name, NULL);
+		g_free (name);
+	}
+
+	if (dest == NULL) {
+		name = g_strdup (g_file_info_get_name (info));
+		make_file_name_valid_for_dest_fs (name, dest_fs_type);
+		dest = g_file_get_child (dest_dir, name);
+		g_free (name);
+	}
+
+	return dest;
+}
+
+/* Hands a file to the copy pool if it is a small regular file */
+static gboolean
+parallel_copy_start (CopyMoveJob *copy_job,
+		     GFile *src,
+		     GFileInfo *info,
+		     GFile *dest_dir,
+		     const char *dest_fs_type,
+		     gboolean same_fs,
+		     gboolean readonly_source_fs,
+		     GAsyncQueue *results)
+{
+	CommonJob *job;
+	ParallelCopy *copy;
+
+	job = (CommonJob *)copy_job;
+
+	if (copy_job->copy_pool == NULL ||
+	    g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR ||
+	    g_file_info_get_size (info) > PARALLEL_COPY_MAX_SIZE ||
+	    should_skip_file (job, src)) {
+		return FALSE;
+	}
+
+	copy = g_new0 (ParallelCopy, 1);
+	copy->job = copy_job;
+	copy->src = g_object_ref (src);
+	copy->dest = get_target_file_for_info (src, info, dest_dir, dest_fs_type, same_fs);
+	copy->size = g_file_info_get_size (info);
+	copy->flags = G_FILE_COPY_NOFOLLOW_SYMLINKS;
+	if (readonly_source_fs) {
+		copy->flags |= G_FILE_COPY_TARGET_DEFAULT_PERMS;
+	}
+	copy->cancellable = job->cancellable;
+	copy->results = results;
+
+	g_thread_pool_push (copy_job->copy_pool, copy, NULL);
+
+	return TRUE;
+}
+
+/* Does what copy_move_file() does after a successful copy, for a file
+ * copied by the pool. Returns FALSE if the file still needs copying. */
+static gboolean
+parallel_copy_finish (CopyMoveJob *copy_job,
+		      ParallelCopy *copy,
+		      GFile *dest_dir,
+		      SourceInfo *source_info,
+		      TransferInfo *transfer_info)
+{
+	CommonJob *job;
+
+	job = (CommonJob *)copy_job;
+
+	if (copy->error != NULL) {
+		return IS_IO_ERROR (copy->error, CANCELLED);
+	}
+
+	transfer_info->num_files ++;
+	transfer_info->num_bytes += copy->size;
+	report_copy_progress (copy_job, source_info, transfer_info);
+
+	caja_file_changes_queue_file_added (copy->dest);
+
+	/* If copying a trusted desktop file to the desktop,
+	   mark it as trusted. */
+	if (copy_job->desktop_location != NULL &&
+	    g_file_equal (copy_job->desktop_location, dest_dir) &&
+	    is_trusted_desktop_file (copy->src, job->cancellable)) {
+		mark_desktop_file_trusted (job,
+					   job->cancellable,
+					   copy->dest,
+					   FALSE);
+	}
+
+	// Start UNDO-REDO
+	caja_undostack_manager_data_add_origin_target_pair (job->undo_redo_data, copy->src, copy->dest);
+	// End UNDO-REDO
+
+	return TRUE;
+}
+
 /* a return value of FALSE means retry, i.e.
  * the destination has changed and the source
  * is expected to re-try the preceeding
@@ -3588,6 +4994,10 @@ copy_move_directory (CopyMoveJob *copy_job,
 	CommonJob *job;
 	GFileCopyFlags flags;
 	gboolean last_item;
+	GAsyncQueue *results;
+	ParallelCopy *copy;
+	GList *later, *l;
+	int n_copying;
 
 	job = (CommonJob *)copy_job;
 
@@ -3622,13 +5032,23 @@ copy_move_directory (CopyMoveJob *copy_job,
  retry:
 	error = NULL;
 	enumerator = g_file_enumerate_children (src,
+						copy_job->copy_pool != NULL ?
+						G_FILE_ATTRIBUTE_STANDARD_NAME ","
+						G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+						G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+						G_FILE_ATTRIBUTE_STANDARD_COPY_NAME :
 						G_FILE_ATTRIBUTE_STANDARD_NAME,
 						G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
 						job->cancellable,
 						&error);
 	if (enumerator) {
 		error = NULL;
+		results = g_async_queue_new ();
+		later = NULL;
+		n_copying = 0;
 
+		/* Small files go to the copy pool as they are read, the
+		 * rest waits until the whole folder has been read. */
 		nextinfo = g_file_enumerator_next_file (enumerator, job->cancellable, skip_error?NULL:&error);
 		while (!job_aborted (job) &&
 		       (info = nextinfo) != NULL) {
@@ -3638,12 +5058,22 @@ copy_move_directory (CopyMoveJob *copy_job,
 			src_file = g_file_get_child (src,
 						     g_file_info_get_name (info));
 
-			last_item = (last_item_above) && (!nextinfo);
-			copy_move_file (copy_job, src_file, *dest, same_fs, FALSE, &dest_fs_type,
-					source_info, transfer_info, NULL, NULL, FALSE, &local_skipped_file,
-					readonly_source_fs, last_item);
-			g_object_unref (src_file);
+			if (parallel_copy_start (copy_job, src_file, info, *dest, dest_fs_type,
+						 same_fs, readonly_source_fs, results)) {
+				n_copying++;
+				g_object_unref (src_file);
+			} else {
+				later = g_list_prepend (later, src_file);
+			}
 			g_object_unref (info);
+
+			while ((copy = g_async_queue_try_pop (results)) != NULL) {
+				n_copying--;
+				if (!parallel_copy_finish (copy_job, copy, *dest, source_info, transfer_info)) {
+					later = g_list_prepend (later, g_object_ref (copy->src));
+				}
+				parallel_copy_free (copy);
+			}
 		}
 		if (nextinfo)
 			g_object_unref (nextinfo);
@@ -3651,6 +5081,27 @@ copy_move_directory (CopyMoveJob *copy_job,
 		g_file_enumerator_close (enumerator, job->cancellable, NULL);
 		g_object_unref (enumerator);
 
+		while (n_copying > 0) {
+			copy = g_async_queue_pop (results);
+			n_copying--;
+			if (!parallel_copy_finish (copy_job, copy, *dest, source_info, transfer_info)) {
+				later = g_list_prepend (later, g_object_ref (copy->src));
+			}
+			parallel_copy_free (copy);
+		}
+		g_async_queue_unref (results);
+
+		later = g_list_reverse (later);
+		for (l = later; l != NULL && !job_aborted (job); l = l->next) {
+			caja_progress_info_get_ready (job->progress, job->time);
+
+			last_item = (last_item_above) && (l->next == NULL);
+			copy_move_file (copy_job, l->data, *dest, same_fs, FALSE, &dest_fs_type,
+					source_info, transfer_info, NULL, NULL, FALSE, &local_skipped_file,
+					readonly_source_fs, last_item);
+		}
+		g_list_free_full (later, g_object_unref);
+
 		if (error && IS_IO_ERROR (error, CANCELLED)) {
 			g_error_free (error);
 		} else if (error) {
@@ -3760,7 +5211,7 @@ copy_move_directory (CopyMoveJob *copy_job,
 						primary,
 						secondary,
 						details,
-						(source_info->num_files - transfer_info->num_files) > 1,
+						more_files_left (source_info, transfer_info),
 						CANCEL, SKIP_ALL, SKIP,
 						NULL);
 
@@ -4206,7 +5657,7 @@ copy_move_file (CopyMoveJob *copy_job,
 					primary,
 					secondary,
 					NULL,
-					(source_info->num_files - transfer_info->num_files) > 1,
+					more_files_left (source_info, transfer_info),
 					CANCEL, SKIP_ALL, SKIP,
 					NULL);
 
@@ -4239,7 +5690,7 @@ copy_move_file (CopyMoveJob *copy_job,
 					primary,
 					secondary,
 					NULL,
-					(source_info->num_files - transfer_info->num_files) > 1,
+					more_files_left (source_info, transfer_info),
 					CANCEL, SKIP_ALL, SKIP,
 					NULL);
 
@@ -4283,12 +5734,12 @@ copy_move_file (CopyMoveJob *copy_job,
 				   &pdata,
 				   &error);
 	} else {
-		res = g_file_copy (src, dest,
-				   flags,
-				   job->cancellable,
-				   copy_file_progress_callback,
-				   &pdata,
-				   &error);
+		res = copy_file_contents (copy_job, src, dest, FALSE,
+					  flags,
+					  job->cancellable,
+					  copy_file_progress_callback,
+					  &pdata,
+					  &error);
 	}
 
 	if (res) {
@@ -4533,7 +5984,7 @@ copy_move_file (CopyMoveJob *copy_job,
 					primary,
 					secondary,
 					details,
-					(source_info->num_files - transfer_info->num_files) > 1,
+					more_files_left (source_info, transfer_info),
 					CANCEL, SKIP_ALL, SKIP,
 					NULL);
 
@@ -4593,6 +6044,13 @@ copy_files (CopyMoveJob *job,
 		g_object_unref (source_dir);
 	}
 
+	if (!job->is_move) {
+		job->copy_statistics = g_new0 (CopyStatistics, 1);
+		g_mutex_init (&job->copy_statistics->mutex);
+		job->copy_pool = g_thread_pool_new (parallel_copy_run, NULL,
+						    PARALLEL_COPY_THREADS, FALSE, NULL);
+	}
+
 	unique_names = (job->destination == NULL);
 	i = 0;
 	for (l = job->files;
@@ -4635,6 +6093,17 @@ copy_files (CopyMoveJob *job,
 		i++;
 	}
 
+	if (job->copy_pool != NULL) {
+		g_thread_pool_free (job->copy_pool, FALSE, TRUE);
+		job->copy_pool = NULL;
+	}
+	if (job->copy_statistics != NULL) {
+		log_copy_statistics (job->copy_statistics);
+		g_mutex_clear (&job->copy_statistics->mutex);
+		g_free (job->copy_statistics);
+		job->copy_statistics = NULL;
+	}
+
 	g_free (dest_fs_type);
 }
 
@@ -4684,13 +6153,12 @@ copy_job (GIOSchedulerJob *io_job,
 
 	caja_progress_info_start (job->common.progress);
 
-	scan_sources (job->files,
-		      &source_info,
-		      common,
-		      OP_KIND_COPY);
-	if (job_aborted (common)) {
-		goto aborted;
-	}
+	/* Start copying while the files are still being counted. The free
+	 * space is checked again once the total size is known. */
+	source_scan_start (job->files,
+			   &source_info,
+			   common,
+			   OP_KIND_COPY);
 
 	if (job->destination) {
 		dest = g_object_ref (job->destination);
@@ -4705,7 +6173,7 @@ copy_job (GIOSchedulerJob *io_job,
 			    OP_KIND_COPY,
 			    dest,
 			    &dest_fs_id,
-			    source_info.num_bytes);
+			    0);
 	g_object_unref (dest);
 	if (job_aborted (common)) {
 		goto aborted;
@@ -4719,6 +6187,7 @@ copy_job (GIOSchedulerJob *io_job,
 		    &source_info, &transfer_info);
 
  aborted:
+	source_scan_finish (&source_info);
 
 	g_free (dest_fs_id);
 
@@ -44,6 +44,10 @@
 #define CAJA_FILE_DEFAULT_ATTRIBUTES				\
 	"standard::*,access::*,mountable::*,time::*,unix::*,owner::*,selinux::*,thumbnail::*,id::filesystem,trash::orig-path,trash::deletion-date,metadata::*"
 
+/* Set on GFileInfos by the directory loading threads, so that the key
+ * doesn't have to be computed in the main loop when the info is used */
+#define CAJA_FILE_INFO_ATTRIBUTE_COLLATION_KEY "caja-private::display-name-collation-key"
+
 /* These are in the typical sort order. Known things come first, then
  * things where we can't know, finally things where we don't yet know.
  */
@@ -59,6 +63,48 @@ typedef struct
     char emblem_keywords[1];
 } CajaFileSortByEmblemCache;
 
+/* State that only some files ever have is kept out of the file
+ * details and allocated the first time it is set, since a directory
+ * can hold a great many CajaFile objects.
+ */
+typedef struct
+{
+    guint deep_directory_count;
+    guint deep_file_count;
+    guint deep_unreadable_count;
+    goffset deep_size;
+    goffset deep_size_on_disk;
+} CajaFileDeepCounts;
+
+typedef struct
+{
+    /* CajaInfoProviders that need to be run for this file */
+    GList *pending_info_providers;
+
+    /* Emblems provided by extensions */
+    GList *extension_emblems;
+    GList *pending_extension_emblems;
+
+    /* Attributes provided by extensions */
+    GHashTable *extension_attributes;
+    GHashTable *pending_extension_attributes;
+} CajaFileExtensionInfo;
+
+typedef struct
+{
+    GList *mime_list; /* If this is a directory, the list of MIME types in it. */
+    char *top_left_text;
+
+    /* Info you might get from a link (.desktop, .directory or caja link) */
+    char *custom_icon;
+    char *activation_uri;
+
+    char *selinux_context;
+
+    char *trash_orig_path;
+    time_t trash_time; /* 0 is unknown */
+} CajaFileExtras;
+
 struct _CajaFilePrivate
 {
     CajaDirectory *directory;
@@ -69,7 +115,8 @@ struct _CajaFilePrivate
     GFileType type;
 
     GRefString *display_name;
-    char *display_name_collation_key;
+    char *display_name_collation_key; /* NULL until first needed */
+    guint64 display_name_collation_prefix;
     GRefString *edit_name;
 
     goffset size; /* -1 is unknown */
@@ -94,18 +141,13 @@ struct _CajaFilePrivate
 
     GRefString *mime_type;
 
-    char *selinux_context;
     char *description;
 
     GError *get_info_error;
 
     guint directory_count;
 
-    guint deep_directory_count;
-    guint deep_file_count;
-    guint deep_unreadable_count;
-    goffset deep_size;
-    goffset deep_size_on_disk;
+    CajaFileDeepCounts *deep_counts;
 
     GIcon *icon;
 
@@ -113,20 +155,11 @@ struct _CajaFilePrivate
     GdkPixbuf *thumbnail;
     time_t thumbnail_mtime;
 
-    GList *mime_list; /* If this is a directory, the list of MIME types in it. */
-    char *top_left_text;
-
-    /* Info you might get from a link (.desktop, .directory or caja link) */
-    char *custom_icon;
-    char *activation_uri;
-
     /* used during DND, for checking whether source and destination are on
      * the same file system.
      */
     GRefString *filesystem_id;
 
-    char *trash_orig_path;
-
     /* The following is for file operations in progress. Since
      * there are normally only a few of these, we can move them to
      * a separate hash table or something if required to keep the
@@ -138,16 +171,8 @@ struct _CajaFilePrivate
        to speed up compare_by_emblems. */
     CajaFileSortByEmblemCache *compare_by_emblem_cache;
 
-    /* CajaInfoProviders that need to be run for this file */
-    GList *pending_info_providers;
-
-    /* Emblems provided by extensions */
-    GList *extension_emblems;
-    GList *pending_extension_emblems;
-
-    /* Attributes provided by extensions */
-    GHashTable *extension_attributes;
-    GHashTable *pending_extension_attributes;
+    CajaFileExtensionInfo *extension_info;
+    CajaFileExtras *extras;
 
     GHashTable *metadata;
 
@@ -232,8 +257,6 @@ struct _CajaFilePrivate
     eel_boolean_bit filesystem_readonly           : 1;
     eel_boolean_bit filesystem_use_preview        : 2; /* GFilesystemPreviewType */
     eel_boolean_bit filesystem_info_is_up_to_date : 1;
-
-    time_t trash_time; /* 0 is unknown */
 };
 
 typedef struct
@@ -263,6 +286,16 @@ gboolean      caja_file_get_date                       (CajaFile           *file
         time_t                 *date);
 void          caja_file_updated_deep_count_in_progress (CajaFile           *file);
 
+/* The get functions allocate the side structure if needed, the peek
+ * functions return an all-zero one instead and must not be written to.
+ */
+CajaFileDeepCounts *          caja_file_get_deep_counts     (CajaFile           *file);
+const CajaFileDeepCounts *    caja_file_peek_deep_counts    (CajaFile           *file);
+CajaFileExtensionInfo *       caja_file_get_extension_info  (CajaFile           *file);
+const CajaFileExtensionInfo * caja_file_peek_extension_info (CajaFile           *file);
+CajaFileExtras *              caja_file_get_extras          (CajaFile           *file);
+const CajaFileExtras *        caja_file_peek_extras         (CajaFile           *file);
+
 void          caja_file_clear_info                     (CajaFile           *file);
 /* Compare file's state with a fresh file info struct, return FALSE if
  * no change, update file and return TRUE if the file info contains
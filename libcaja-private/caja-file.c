@@ -199,11 +199,43 @@ caja_file_constructor (GType                  type,
   return object;
 }
 
-gboolean
-caja_file_set_display_name (CajaFile *file,
-				const char *display_name,
-				const char *edit_name,
-				gboolean custom)
+/* The first bytes of the collation key, packed so that comparing two
+ * prefixes as integers orders like strcmp() of the keys. That settles
+ * most name comparisons without going to the keys themselves.
+ */
+static guint64
+pack_collation_prefix (const char *collation_key)
+{
+	guint64 prefix;
+	int i;
+
+	prefix = 0;
+	for (i = 0; i < 8; i++) {
+		prefix <<= 8;
+		if (*collation_key != '\0') {
+			prefix |= (guchar) *collation_key++;
+		}
+	}
+
+	return prefix;
+}
+
+static void
+set_display_name_collation_key (CajaFile *file,
+				char *collation_key)
+{
+	g_free (file->details->display_name_collation_key);
+	file->details->display_name_collation_key = collation_key;
+	file->details->display_name_collation_prefix =
+		collation_key != NULL ? pack_collation_prefix (collation_key) : 0;
+}
+
+static gboolean
+set_display_name_with_collation_key (CajaFile *file,
+				     const char *display_name,
+				     const char *edit_name,
+				     const char *collation_key,
+				     gboolean custom)
 {
 	gboolean changed;
 
@@ -243,8 +275,9 @@ caja_file_set_display_name (CajaFile *file,
 			file->details->display_name = g_ref_string_new (display_name);
 		}
 
-		g_free (file->details->display_name_collation_key);
-		file->details->display_name_collation_key = g_utf8_collate_key_for_filename (display_name, -1);
+		/* Without a key made ahead of time, wait until the
+		 * file gets sorted or compared by name. */
+		set_display_name_collation_key (file, g_strdup (collation_key));
 	}
 
 	if (eel_strcmp (file->details->edit_name, edit_name) != 0) {
@@ -262,13 +295,22 @@ caja_file_set_display_name (CajaFile *file,
 	return changed;
 }
 
+gboolean
+caja_file_set_display_name (CajaFile *file,
+				const char *display_name,
+				const char *edit_name,
+				gboolean custom)
+{
+	return set_display_name_with_collation_key (file, display_name, edit_name,
+						    NULL, custom);
+}
+
 static void
 caja_file_clear_display_name (CajaFile *file)
 {
 	g_clear_pointer (&file->details->display_name, g_ref_string_release);
 	file->details->display_name = NULL;
-	g_free (file->details->display_name_collation_key);
-	file->details->display_name_collation_key = NULL;
+	set_display_name_collation_key (file, NULL);
 	g_clear_pointer (&file->details->edit_name, g_ref_string_release);
 	file->details->edit_name = NULL;
 }
@@ -432,9 +474,9 @@ caja_file_clear_info (CajaFile *file)
 	}
 
 	if (!file->details->got_custom_activation_uri &&
-	    file->details->activation_uri != NULL) {
-		g_free (file->details->activation_uri);
-		file->details->activation_uri = NULL;
+	    file->details->extras != NULL) {
+		g_free (file->details->extras->activation_uri);
+		file->details->extras->activation_uri = NULL;
 	}
 
 	if (file->details->icon != NULL) {
@@ -479,13 +521,15 @@ caja_file_clear_info (CajaFile *file)
 	file->details->atime = 0;
 	file->details->ctime = 0;
 	file->details->btime = 0;
-	file->details->trash_time = 0;
 	g_free (file->details->symlink_name);
 	file->details->symlink_name = NULL;
 	g_clear_pointer (&file->details->mime_type, g_ref_string_release);
 	file->details->mime_type = NULL;
-	g_free (file->details->selinux_context);
-	file->details->selinux_context = NULL;
+	if (file->details->extras != NULL) {
+		file->details->extras->trash_time = 0;
+		g_free (file->details->extras->selinux_context);
+		file->details->extras->selinux_context = NULL;
+	}
 	g_free (file->details->description);
 	file->details->description = NULL;
 	g_clear_pointer (&file->details->owner, g_ref_string_release);
@@ -759,6 +803,104 @@ caja_file_is_self_owned (CajaFile *file)
 	return file->details->directory->details->as_file == file;
 }
 
+CajaFileDeepCounts *
+caja_file_get_deep_counts (CajaFile *file)
+{
+	if (file->details->deep_counts == NULL) {
+		file->details->deep_counts = g_new0 (CajaFileDeepCounts, 1);
+	}
+	return file->details->deep_counts;
+}
+
+const CajaFileDeepCounts *
+caja_file_peek_deep_counts (CajaFile *file)
+{
+	static const CajaFileDeepCounts no_deep_counts;
+
+	if (file->details->deep_counts == NULL) {
+		return &no_deep_counts;
+	}
+	return file->details->deep_counts;
+}
+
+CajaFileExtensionInfo *
+caja_file_get_extension_info (CajaFile *file)
+{
+	if (file->details->extension_info == NULL) {
+		file->details->extension_info = g_new0 (CajaFileExtensionInfo, 1);
+	}
+	return file->details->extension_info;
+}
+
+const CajaFileExtensionInfo *
+caja_file_peek_extension_info (CajaFile *file)
+{
+	static const CajaFileExtensionInfo no_extension_info;
+
+	if (file->details->extension_info == NULL) {
+		return &no_extension_info;
+	}
+	return file->details->extension_info;
+}
+
+static void
+extension_info_free (CajaFileExtensionInfo *extension_info)
+{
+	if (extension_info == NULL) {
+		return;
+	}
+
+	g_list_free_full (extension_info->pending_extension_emblems, g_free);
+	g_list_free_full (extension_info->extension_emblems, g_free);
+	g_list_free_full (extension_info->pending_info_providers, g_object_unref);
+
+	if (extension_info->pending_extension_attributes) {
+		g_hash_table_destroy (extension_info->pending_extension_attributes);
+	}
+
+	if (extension_info->extension_attributes) {
+		g_hash_table_destroy (extension_info->extension_attributes);
+	}
+
+	g_free (extension_info);
+}
+
+CajaFileExtras *
+caja_file_get_extras (CajaFile *file)
+{
+	if (file->details->extras == NULL) {
+		file->details->extras = g_new0 (CajaFileExtras, 1);
+	}
+	return file->details->extras;
+}
+
+const CajaFileExtras *
+caja_file_peek_extras (CajaFile *file)
+{
+	static const CajaFileExtras no_extras;
+
+	if (file->details->extras == NULL) {
+		return &no_extras;
+	}
+	return file->details->extras;
+}
+
+static void
+extras_free (CajaFileExtras *extras)
+{
+	if (extras == NULL) {
+		return;
+	}
+
+	g_list_free_full (extras->mime_list, g_free);
+	g_free (extras->top_left_text);
+	g_free (extras->custom_icon);
+	g_free (extras->activation_uri);
+	g_free (extras->selinux_context);
+	g_free (extras->trash_orig_path);
+	g_free (extras);
+}
+
 static void
 finalize (GObject *object)
 {
@@ -809,11 +951,7 @@ finalize (GObject *object)
 	g_clear_pointer (&file->details->owner, g_ref_string_release);
 	g_clear_pointer (&file->details->owner_real, g_ref_string_release);
 	g_clear_pointer (&file->details->group, g_ref_string_release);
-	g_free (file->details->selinux_context);
 	g_free (file->details->description);
-	g_free (file->details->top_left_text);
-	g_free (file->details->custom_icon);
-	g_free (file->details->activation_uri);
 	g_free (file->details->compare_by_emblem_cache);
 
 	if (file->details->thumbnail) {
@@ -826,18 +964,9 @@ finalize (GObject *object)
 
 	g_clear_pointer (&file->details->filesystem_id, g_ref_string_release);
 
-	g_list_free_full (file->details->mime_list, g_free);
-	g_list_free_full (file->details->pending_extension_emblems, g_free);
-	g_list_free_full (file->details->extension_emblems, g_free);
-	g_list_free_full (file->details->pending_info_providers, g_object_unref);
-
-	if (file->details->pending_extension_attributes) {
-		g_hash_table_destroy (file->details->pending_extension_attributes);
-	}
-
-	if (file->details->extension_attributes) {
-		g_hash_table_destroy (file->details->extension_attributes);
-	}
+	g_free (file->details->deep_counts);
+	extension_info_free (file->details->extension_info);
+	extras_free (file->details->extras);
 
 	if (file->details->metadata) {
 		metadata_hash_free (file->details->metadata);
@@ -2146,10 +2275,11 @@ update_info_internal (CajaFile *file,
 	}
 	file->details->got_file_info = TRUE;
 
-	changed |= caja_file_set_display_name (file,
-						  g_file_info_get_display_name (info),
-						  g_file_info_get_edit_name (info),
-						  FALSE);
+	changed |= set_display_name_with_collation_key (file,
+							g_file_info_get_display_name (info),
+							g_file_info_get_edit_name (info),
+							g_file_info_get_attribute_byte_string (info, CAJA_FILE_INFO_ATTRIBUTE_COLLATION_KEY),
+							FALSE);
 
 	file_type = g_file_info_get_file_type (info);
 	if (file->details->type != file_type) {
@@ -2162,20 +2292,22 @@ update_info_internal (CajaFile *file,
 
 		activation_uri = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_TARGET_URI);
 		if (activation_uri == NULL) {
-			if (file->details->activation_uri) {
-				g_free (file->details->activation_uri);
-				file->details->activation_uri = NULL;
+			if (caja_file_peek_extras (file)->activation_uri) {
+				g_free (file->details->extras->activation_uri);
+				file->details->extras->activation_uri = NULL;
 				changed = TRUE;
 			}
 		} else {
+			CajaFileExtras *extras;
 			char *old_activation_uri;
 
-			old_activation_uri = file->details->activation_uri;
-			file->details->activation_uri = g_strdup (activation_uri);
+			extras = caja_file_get_extras (file);
+			old_activation_uri = extras->activation_uri;
+			extras->activation_uri = g_strdup (activation_uri);
 
 			if (old_activation_uri) {
 				if (strcmp (old_activation_uri,
-					    file->details->activation_uri) != 0) {
+					    extras->activation_uri) != 0) {
 					changed = TRUE;
 				}
 				g_free (old_activation_uri);
@@ -2471,10 +2603,13 @@ update_info_internal (CajaFile *file,
 	}
 
 	selinux_context = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_SELINUX_CONTEXT);
-	if (eel_strcmp (file->details->selinux_context, selinux_context) != 0) {
+	if (eel_strcmp (caja_file_peek_extras (file)->selinux_context, selinux_context) != 0) {
+		CajaFileExtras *extras;
+
 		changed = TRUE;
-		g_free (file->details->selinux_context);
-		file->details->selinux_context = g_strdup (selinux_context);
+		extras = caja_file_get_extras (file);
+		g_free (extras->selinux_context);
+		extras->selinux_context = g_strdup (selinux_context);
 	}
 
 	description = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_DESCRIPTION);
@@ -2510,16 +2645,19 @@ update_info_internal (CajaFile *file,
 		trash_time = g_trash_time.tv_sec;
 #endif
 	}
-	if (file->details->trash_time != trash_time) {
+	if (caja_file_peek_extras (file)->trash_time != trash_time) {
 		changed = TRUE;
-		file->details->trash_time = trash_time;
+		caja_file_get_extras (file)->trash_time = trash_time;
 	}
 
 	trash_orig_path = g_file_info_get_attribute_byte_string (info, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH);
-	if (eel_strcmp (file->details->trash_orig_path, trash_orig_path) != 0) {
+	if (eel_strcmp (caja_file_peek_extras (file)->trash_orig_path, trash_orig_path) != 0) {
+		CajaFileExtras *extras;
+
 		changed = TRUE;
-		g_free (file->details->trash_orig_path);
-		file->details->trash_orig_path = g_strdup (trash_orig_path);
+		extras = caja_file_get_extras (file);
+		g_free (extras->trash_orig_path);
+		extras->trash_orig_path = g_strdup (trash_orig_path);
 	}
 
 	changed |=
@@ -2803,7 +2941,7 @@ get_time (CajaFile *file,
 		time = file->details->btime;
 		break;
 	case CAJA_DATE_TYPE_TRASHED:
-		time = file->details->trash_time;
+		time = caja_file_peek_extras (file)->trash_time;
 		break;
 	default:
 		g_assert_not_reached ();
@@ -2956,7 +3094,13 @@ compare_by_display_name (CajaFile *file_1, CajaFile *file_2)
 	} else {
 		key_1 = caja_file_peek_display_name_collation_key (file_1);
 		key_2 = caja_file_peek_display_name_collation_key (file_2);
-		compare = strcmp (key_1, key_2);
+		if (file_1->details->display_name_collation_prefix !=
+		    file_2->details->display_name_collation_prefix) {
+			compare = file_1->details->display_name_collation_prefix <
+				file_2->details->display_name_collation_prefix ? -1 : +1;
+		} else {
+			compare = strcmp (key_1, key_2);
+		}
 	}
 
 	return compare;
@@ -3550,6 +3694,46 @@ caja_file_compare_for_sort (CajaFile *file_1,
 	return result;
 }
 
+/**
+ * caja_file_get_sort_type_for_attribute_q:
+ * @attribute: An attribute name quark, 0 meaning the name
+ * @sort_type: Location for the sort type
+ *
+ * Return value: TRUE if sorting by @attribute is done the same way as
+ * sorting by one of the CajaFileSortTypes, FALSE for attributes that
+ * are sorted by their string value.
+ **/
+gboolean
+caja_file_get_sort_type_for_attribute_q (GQuark attribute,
+					 CajaFileSortType *sort_type)
+{
+	if (attribute == 0 || attribute == attribute_name_q) {
+		*sort_type = CAJA_FILE_SORT_BY_DISPLAY_NAME;
+	} else if (attribute == attribute_size_q) {
+		*sort_type = CAJA_FILE_SORT_BY_SIZE;
+	} else if (attribute == attribute_size_on_disk_q) {
+		*sort_type = CAJA_FILE_SORT_BY_SIZE_ON_DISK;
+	} else if (attribute == attribute_type_q) {
+		*sort_type = CAJA_FILE_SORT_BY_TYPE;
+	} else if (attribute == attribute_modification_date_q || attribute == attribute_date_modified_q) {
+		*sort_type = CAJA_FILE_SORT_BY_MTIME;
+	} else if (attribute == attribute_creation_date_q || attribute == attribute_date_created_q) {
+		*sort_type = CAJA_FILE_SORT_BY_BTIME;
+	} else if (attribute == attribute_accessed_date_q || attribute == attribute_date_accessed_q) {
+		*sort_type = CAJA_FILE_SORT_BY_ATIME;
+	} else if (attribute == attribute_trashed_on_q) {
+		*sort_type = CAJA_FILE_SORT_BY_TRASHED_TIME;
+	} else if (attribute == attribute_emblems_q) {
+		*sort_type = CAJA_FILE_SORT_BY_EMBLEMS;
+	} else if (attribute == attribute_extension_q) {
+		*sort_type = CAJA_FILE_SORT_BY_EXTENSION;
+	} else {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 int
 caja_file_compare_for_sort_by_attribute_q   (CajaFile                   *file_1,
 						 CajaFile                   *file_2,
@@ -3557,6 +3741,7 @@ caja_file_compare_for_sort_by_attribute_q   (CajaFile                   *file_1,
 						 gboolean                        directories_first,
 						 gboolean                        reversed)
 {
+	CajaFileSortType sort_type;
 	int result;
 
 	if (file_1 == file_2) {
@@ -3566,54 +3751,9 @@ caja_file_compare_for_sort_by_attribute_q   (CajaFile                   *file_1,
 	/* Convert certain attributes into CajaFileSortTypes and use
 	 * caja_file_compare_for_sort()
 	 */
-	if (attribute == 0 || attribute == attribute_name_q) {
-		return caja_file_compare_for_sort (file_1, file_2,
-						       CAJA_FILE_SORT_BY_DISPLAY_NAME,
-						       directories_first,
-						       reversed);
-	} else if (attribute == attribute_size_q) {
-		return caja_file_compare_for_sort (file_1, file_2,
-						       CAJA_FILE_SORT_BY_SIZE,
-						       directories_first,
-						       reversed);
-	} else if (attribute == attribute_size_on_disk_q) {
-		return caja_file_compare_for_sort (file_1, file_2,
-						       CAJA_FILE_SORT_BY_SIZE_ON_DISK,
-						       directories_first,
-						       reversed);
-	} else if (attribute == attribute_type_q) {
-		return caja_file_compare_for_sort (file_1, file_2,
-						       CAJA_FILE_SORT_BY_TYPE,
-						       directories_first,
-						       reversed);
-	} else if (attribute == attribute_modification_date_q || attribute == attribute_date_modified_q) {
-		return caja_file_compare_for_sort (file_1, file_2,
-						       CAJA_FILE_SORT_BY_MTIME,
-						       directories_first,
-						       reversed);
-        } else if (attribute == attribute_creation_date_q || attribute == attribute_date_created_q) {
-                return caja_file_compare_for_sort (file_1, file_2,
-                                                       CAJA_FILE_SORT_BY_BTIME,
-                                                       directories_first,
-                                                       reversed);
-        } else if (attribute == attribute_accessed_date_q || attribute == attribute_date_accessed_q) {
-		return caja_file_compare_for_sort (file_1, file_2,
-						       CAJA_FILE_SORT_BY_ATIME,
-						       directories_first,
-						       reversed);
-        } else if (attribute == attribute_trashed_on_q) {
+	if (caja_file_get_sort_type_for_attribute_q (attribute, &sort_type)) {
 		return caja_file_compare_for_sort (file_1, file_2,
-						       CAJA_FILE_SORT_BY_TRASHED_TIME,
-						       directories_first,
-						       reversed);
-	} else if (attribute == attribute_emblems_q) {
-		return caja_file_compare_for_sort (file_1, file_2,
-						       CAJA_FILE_SORT_BY_EMBLEMS,
-						       directories_first,
-						       reversed);
-	} else if (attribute == attribute_extension_q) {
-		return caja_file_compare_for_sort (file_1, file_2,
-						       CAJA_FILE_SORT_BY_EXTENSION,
+						       sort_type,
 						       directories_first,
 						       reversed);
 	}
@@ -3659,6 +3799,616 @@ caja_file_compare_for_sort_by_attribute     (CajaFile                   *file_1,
 							      reversed);
 }
 
+/* Sorting many files at once: everything the comparison needs is
+ * taken from the files once, up front, with as much of the order as
+ * possible packed into a 64 bit key. Comparisons then never go back to
+ * the files, which also makes it safe to sort large arrays in several
+ * threads.
+ */
+#define SORT_PARALLEL_THRESHOLD 20000
+#define SORT_MAX_THREADS 8
+
+/* Packed key layouts, from the most significant bit:
+ *   name:      sort last (1), first bytes of the collation key (56)
+ *   type:      not a directory (1), first bytes of the type collation key (56)
+ *   size:      not a directory (1), knowledge (2), count or size (61)
+ *   time:      knowledge (2), time (61)
+ */
+#define SORT_KEY_HIGH_BIT ((guint64) 1 << 63)
+#define SORT_KEY_KNOWLEDGE_SHIFT 61
+#define SORT_KEY_VALUE_MASK (((guint64) 1 << SORT_KEY_KNOWLEDGE_SHIFT) - 1)
+#define SORT_KEY_PREFIX_BYTES 7
+
+typedef struct {
+	guint64 key;
+	const char *name_key;
+	const char *type_key;
+	const char *directory_key;
+	int sort_order;
+	guint directory_group : 1;
+	guint sort_last : 1;
+	CajaFileSortItem item;
+} SortEntry;
+
+typedef struct {
+	CajaFileSortType sort_type;
+	gboolean directories_first;
+	gboolean reversed;
+} SortContext;
+
+static guint64
+pack_string_prefix (const char *string)
+{
+	guint64 key;
+	int i;
+
+	key = 0;
+	for (i = 0; i < SORT_KEY_PREFIX_BYTES; i++) {
+		key <<= 8;
+		if (*string != '\0') {
+			key |= (guchar) *string++;
+		}
+	}
+
+	return key;
+}
+
+static guint64
+pack_knowledge (Knowledge knowledge, gint64 value)
+{
+	/* Unknown values sort first, then unknowable ones, then known
+	 * values in increasing order, like compare_by_time() and
+	 * compare_by_size() do.
+	 */
+	if (knowledge != KNOWN || value < 0) {
+		value = 0;
+	}
+
+	return ((guint64) (UNKNOWN - knowledge) << SORT_KEY_KNOWLEDGE_SHIFT) |
+		MIN ((guint64) value, SORT_KEY_VALUE_MASK);
+}
+
+static guint64
+get_sort_key (CajaFile *file,
+	      CajaFileSortType sort_type,
+	      const char *type_key)
+{
+	Knowledge knowledge;
+	time_t time;
+	goffset size;
+	guint count;
+	gint64 value;
+
+	switch (sort_type) {
+	case CAJA_FILE_SORT_BY_DISPLAY_NAME:
+		caja_file_peek_display_name_collation_key (file);
+		return file->details->display_name_collation_prefix >> (8 * (8 - SORT_KEY_PREFIX_BYTES));
+	case CAJA_FILE_SORT_BY_TYPE:
+		if (type_key == NULL) {
+			return 0;
+		}
+		return SORT_KEY_HIGH_BIT | pack_string_prefix (type_key);
+	case CAJA_FILE_SORT_BY_SIZE:
+	case CAJA_FILE_SORT_BY_SIZE_ON_DISK:
+		if (caja_file_is_directory (file)) {
+			count = 0;
+			knowledge = get_item_count (file, &count);
+			return pack_knowledge (knowledge, count);
+		}
+		size = 0;
+		knowledge = get_size (file, &size,
+				      sort_type == CAJA_FILE_SORT_BY_SIZE_ON_DISK);
+		return SORT_KEY_HIGH_BIT | pack_knowledge (knowledge, size);
+	case CAJA_FILE_SORT_BY_MTIME:
+	case CAJA_FILE_SORT_BY_BTIME:
+	case CAJA_FILE_SORT_BY_ATIME:
+	case CAJA_FILE_SORT_BY_TRASHED_TIME:
+		time = 0;
+		knowledge = get_time (file, &time,
+				      sort_type == CAJA_FILE_SORT_BY_MTIME ? CAJA_DATE_TYPE_MODIFIED :
+				      sort_type == CAJA_FILE_SORT_BY_BTIME ? CAJA_DATE_TYPE_CREATED :
+				      sort_type == CAJA_FILE_SORT_BY_ATIME ? CAJA_DATE_TYPE_ACCESSED :
+				      CAJA_DATE_TYPE_TRASHED);
+		/* Shift so that times before the epoch stay in order */
+		value = (gint64) time + ((gint64) 1 << (SORT_KEY_KNOWLEDGE_SHIFT - 1));
+		return pack_knowledge (knowledge, value);
+	default:
+		return 0;
+	}
+}
+
+static gboolean
+sort_type_uses_sort_keys (CajaFileSortType sort_type)
+{
+	/* Emblems and extensions are still compared on the files */
+	return sort_type != CAJA_FILE_SORT_BY_EMBLEMS &&
+		sort_type != CAJA_FILE_SORT_BY_EXTENSION;
+}
+
+static int
+compare_sort_entry_names (const SortEntry *entry_1, const SortEntry *entry_2)
+{
+	if (entry_1->sort_last != entry_2->sort_last) {
+		return entry_1->sort_last ? +1 : -1;
+	}
+	return strcmp (entry_1->name_key, entry_2->name_key);
+}
+
+static int
+compare_sort_entry_directories (const SortEntry *entry_1, const SortEntry *entry_2)
+{
+	/* Keys are shared by all files of a directory */
+	if (entry_1->directory_key == entry_2->directory_key) {
+		return 0;
+	}
+	return strcmp (entry_1->directory_key, entry_2->directory_key);
+}
+
+/* Same order as caja_file_compare_for_sort() */
+static int
+compare_sort_entries (gconstpointer a, gconstpointer b, gpointer callback_data)
+{
+	const SortEntry *entry_1, *entry_2;
+	const SortContext *context;
+	int result;
+
+	entry_1 = a;
+	entry_2 = b;
+	context = callback_data;
+
+	if (!sort_type_uses_sort_keys (context->sort_type)) {
+		return caja_file_compare_for_sort (entry_1->item.file, entry_2->item.file,
+						   context->sort_type,
+						   context->directories_first,
+						   context->reversed);
+	}
+
+	if (entry_1->directory_group != entry_2->directory_group) {
+		return entry_1->directory_group < entry_2->directory_group ? -1 : +1;
+	}
+
+	if (entry_1->sort_order != entry_2->sort_order) {
+		result = entry_1->sort_order < entry_2->sort_order ? -1 : +1;
+	} else if (entry_1->key != entry_2->key) {
+		result = entry_1->key < entry_2->key ? -1 : +1;
+	} else if (context->sort_type == CAJA_FILE_SORT_BY_DISPLAY_NAME) {
+		result = compare_sort_entry_names (entry_1, entry_2);
+		if (result == 0) {
+			result = compare_sort_entry_directories (entry_1, entry_2);
+		}
+	} else {
+		result = 0;
+		if (entry_1->type_key != NULL && entry_2->type_key != NULL) {
+			result = strcmp (entry_1->type_key, entry_2->type_key);
+		}
+		if (result == 0) {
+			result = compare_sort_entry_directories (entry_1, entry_2);
+		}
+		if (result == 0) {
+			result = compare_sort_entry_names (entry_1, entry_2);
+		}
+	}
+
+	return context->reversed ? -result : result;
+}
+
+typedef struct {
+	SortEntry *entries;
+	guint n_entries;
+	guint n_left;
+	SortEntry *output;
+	const SortContext *context;
+} SortTask;
+
+static gpointer
+sort_task_run (gpointer data)
+{
+	SortTask *task;
+	const SortEntry *left, *right, *left_end, *right_end;
+	SortEntry *output;
+
+	task = data;
+
+	if (task->output == NULL) {
+		g_qsort_with_data (task->entries, task->n_entries, sizeof (SortEntry),
+				   compare_sort_entries, (gpointer) task->context);
+		return NULL;
+	}
+
+	/* Merge two sorted runs, taking from the left one on ties so
+	 * that the sort stays stable. */
+	left = task->entries;
+	left_end = right = task->entries + task->n_left;
+	right_end = task->entries + task->n_entries;
+	output = task->output;
+
+	while (left < left_end && right < right_end) {
+		if (compare_sort_entries (left, right, (gpointer) task->context) <= 0) {
+			*output++ = *left++;
+		} else {
+			*output++ = *right++;
+		}
+	}
+	while (left < left_end) {
+		*output++ = *left++;
+	}
+	while (right < right_end) {
+		*output++ = *right++;
+	}
+
+	return NULL;
+}
+
+static void
+sort_tasks_run (SortTask *tasks, guint n_tasks)
+{
+	GThread *threads[SORT_MAX_THREADS];
+	guint i;
+
+	for (i = 1; i < n_tasks; i++) {
+		threads[i] = g_thread_new ("caja-sort", sort_task_run, &tasks[i]);
+	}
+	sort_task_run (&tasks[0]);
+	for (i = 1; i < n_tasks; i++) {
+		g_thread_join (threads[i]);
+	}
+}
+
+/* A merge sort where the runs are sorted, and then merged pairwise, by
+ * as many threads as there are runs. */
+static void
+sort_entries_parallel (SortEntry *entries, guint n_entries,
+		       const SortContext *context, guint n_runs)
+{
+	SortTask tasks[SORT_MAX_THREADS];
+	SortEntry *buffer, *source, *destination, *swap;
+	guint run_length, i, start, n_tasks;
+
+	run_length = (n_entries + n_runs - 1) / n_runs;
+	for (i = 0; i < n_runs; i++) {
+		start = MIN (i * run_length, n_entries);
+		tasks[i].entries = entries + start;
+		tasks[i].n_entries = MIN (run_length, n_entries - start);
+		tasks[i].n_left = 0;
+		tasks[i].output = NULL;
+		tasks[i].context = context;
+	}
+	sort_tasks_run (tasks, n_runs);
+
+	buffer = g_new (SortEntry, n_entries);
+	source = entries;
+	destination = buffer;
+	for (; run_length < n_entries; run_length *= 2) {
+		n_tasks = 0;
+		for (start = 0; start < n_entries; start += 2 * run_length) {
+			tasks[n_tasks].entries = source + start;
+			tasks[n_tasks].n_entries = MIN (2 * run_length, n_entries - start);
+			tasks[n_tasks].n_left = MIN (run_length, tasks[n_tasks].n_entries);
+			tasks[n_tasks].output = destination + start;
+			tasks[n_tasks].context = context;
+			n_tasks++;
+		}
+		sort_tasks_run (tasks, n_tasks);
+
+		swap = source;
+		source = destination;
+		destination = swap;
+	}
+
+	if (source != entries) {
+		memcpy (entries, source, n_entries * sizeof (SortEntry));
+	}
+	g_free (buffer);
+}
+
+/* Collation keys missing when many files get sorted are made all at
+ * once, split between threads. The threads only see the names, the
+ * keys are stored in the files once they are done.
+ */
+#define COLLATION_KEY_PARALLEL_THRESHOLD 5000
+
+typedef struct {
+	const char **names;
+	char **keys;
+	guint n_names;
+} CollationKeyTask;
+
+static gpointer
+collation_key_task_run (gpointer data)
+{
+	CollationKeyTask *task;
+	guint i;
+
+	task = data;
+	for (i = 0; i < task->n_names; i++) {
+		task->keys[i] = g_utf8_collate_key_for_filename (task->names[i], -1);
+	}
+
+	return NULL;
+}
+
+static void
+prepare_display_name_collation_keys (CajaFileSortItem *items,
+				     guint n_items)
+{
+	CollationKeyTask tasks[SORT_MAX_THREADS];
+	GThread *threads[SORT_MAX_THREADS];
+	CajaFile **files;
+	const char **names;
+	char **keys;
+	guint n_files, n_tasks, task_length, start, i;
+
+	files = g_new (CajaFile *, n_items);
+	names = g_new (const char *, n_items);
+	n_files = 0;
+	for (i = 0; i < n_items; i++) {
+		CajaFile *file;
+
+		file = items[i].file;
+		/* This may set the display name, which drops the key */
+		names[n_files] = caja_file_peek_display_name (file);
+		if (file->details->display_name_collation_key == NULL) {
+			files[n_files++] = file;
+		}
+	}
+
+	if (n_files < COLLATION_KEY_PARALLEL_THRESHOLD) {
+		/* Not worth the threads, keys are made as needed */
+		g_free (files);
+		g_free (names);
+		return;
+	}
+
+	keys = g_new (char *, n_files);
+	n_tasks = MIN (g_get_num_processors (), SORT_MAX_THREADS);
+	task_length = (n_files + n_tasks - 1) / n_tasks;
+	for (i = 0; i < n_tasks; i++) {
+		start = MIN (i * task_length, n_files);
+		tasks[i].names = names + start;
+		tasks[i].keys = keys + start;
+		tasks[i].n_names = MIN (task_length, n_files - start);
+	}
+
+	for (i = 1; i < n_tasks; i++) {
+		threads[i] = g_thread_new ("caja-collate", collation_key_task_run, &tasks[i]);
+	}
+	collation_key_task_run (&tasks[0]);
+	for (i = 1; i < n_tasks; i++) {
+		g_thread_join (threads[i]);
+	}
+
+	for (i = 0; i < n_files; i++) {
+		set_display_name_collation_key (files[i], keys[i]);
+	}
+
+	g_free (keys);
+	g_free (files);
+	g_free (names);
+}
+
+/* Apart from the MIME type, caja_file_get_type_as_string() looks at
+ * whether the file is a (broken) link and, for unknown content types,
+ * whether it is executable. Files with the same MIME type and the same
+ * variant get the same description.
+ */
+enum {
+	TYPE_KEY_PLAIN = 0,
+	TYPE_KEY_LINK = 1 << 0,
+	TYPE_KEY_PROGRAM = 1 << 1,
+	TYPE_KEY_BROKEN_LINK = 1 << 2,
+	N_TYPE_KEY_VARIANTS = TYPE_KEY_BROKEN_LINK + 1
+};
+
+static guint
+get_type_key_variant (CajaFile *file)
+{
+	guint variant;
+
+	if (caja_file_is_broken_symbolic_link (file)) {
+		return TYPE_KEY_BROKEN_LINK;
+	}
+
+	variant = TYPE_KEY_PLAIN;
+	if (caja_file_is_symbolic_link (file)) {
+		variant |= TYPE_KEY_LINK;
+	}
+	if (!eel_str_is_empty (file->details->mime_type) &&
+	    g_content_type_is_unknown (file->details->mime_type) &&
+	    caja_file_is_executable (file)) {
+		variant |= TYPE_KEY_PROGRAM;
+	}
+
+	return variant;
+}
+
+/**
+ * caja_file_sort_items:
+ * @items: Array of items to sort, each with a file
+ * @n_items: Number of items
+ * @sort_type: Sort criterion
+ * @directories_first: Put all directories before any non-directories
+ * @reversed: Reverse the order of the items, except that
+ * the directories_first flag is still respected.
+ *
+ * Sorts @items in place, in the order caja_file_compare_for_sort() gives
+ * their files, keeping items with equal files in their original order.
+ * This is a lot faster than sorting with caja_file_compare_for_sort()
+ * when there are many items.
+ **/
+void
+caja_file_sort_items (CajaFileSortItem *items,
+		      guint n_items,
+		      CajaFileSortType sort_type,
+		      gboolean directories_first,
+		      gboolean reversed)
+{
+	SortContext context;
+	SortEntry *entries, *entry;
+	GHashTable *type_keys[N_TYPE_KEY_VARIANTS], *directory_keys;
+	CajaDirectory *directory;
+	gboolean use_sort_keys;
+	guint i, n_runs;
+
+	if (n_items <= 1) {
+		return;
+	}
+
+	context.sort_type = sort_type;
+	context.directories_first = directories_first;
+	context.reversed = reversed;
+	use_sort_keys = sort_type_uses_sort_keys (sort_type);
+
+	/* The parent path only breaks ties between files from
+	 * different directories, don't compute it otherwise. */
+	directory_keys = NULL;
+	directory = items[0].file->details->directory;
+	for (i = 1; i < n_items; i++) {
+		if (items[i].file->details->directory != directory) {
+			directory_keys = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+			break;
+		}
+	}
+
+	if (use_sort_keys) {
+		prepare_display_name_collation_keys (items, n_items);
+	}
+
+	/* The type description depends on the MIME type and on the
+	 * few file states get_type_key_variant() picks out, so keep
+	 * one MIME type table per variant. */
+	for (i = 0; i < N_TYPE_KEY_VARIANTS; i++) {
+		type_keys[i] = NULL;
+		if (sort_type == CAJA_FILE_SORT_BY_TYPE) {
+			type_keys[i] = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+		}
+	}
+
+	entries = g_new (SortEntry, n_items);
+	for (i = 0; i < n_items; i++) {
+		CajaFile *file;
+		const char *name;
+
+		file = items[i].file;
+		entry = &entries[i];
+		entry->item = items[i];
+
+		if (!use_sort_keys) {
+			continue;
+		}
+
+		name = caja_file_peek_display_name (file);
+		entry->sort_last = name[0] == SORT_LAST_CHAR1 || name[0] == SORT_LAST_CHAR2;
+		entry->name_key = caja_file_peek_display_name_collation_key (file);
+		entry->sort_order = file->details->sort_order;
+		entry->directory_group = directories_first && !caja_file_is_directory (file);
+
+		entry->type_key = NULL;
+		if (type_keys[0] != NULL && !caja_file_is_directory (file)) {
+			GHashTable *variant_keys;
+			char *type_key;
+
+			variant_keys = type_keys[get_type_key_variant (file)];
+			if (!g_hash_table_lookup_extended (variant_keys, file->details->mime_type,
+							   NULL, (gpointer *) &type_key)) {
+				char *type_string;
+
+				type_string = caja_file_get_type_as_string (file);
+				type_key = g_utf8_collate_key (type_string, -1);
+				g_free (type_string);
+				g_hash_table_insert (variant_keys, file->details->mime_type, type_key);
+			}
+			entry->type_key = type_key;
+		}
+
+		entry->directory_key = NULL;
+		if (directory_keys != NULL) {
+			char *directory_key;
+
+			directory_key = g_hash_table_lookup (directory_keys, file->details->directory);
+			if (directory_key == NULL) {
+				char *parent_uri;
+
+				parent_uri = caja_file_get_parent_uri_for_display (file);
+				directory_key = g_utf8_collate_key (parent_uri, -1);
+				g_free (parent_uri);
+				g_hash_table_insert (directory_keys, file->details->directory, directory_key);
+			}
+			entry->directory_key = directory_key;
+		}
+
+		entry->key = get_sort_key (file, sort_type, entry->type_key);
+		if (sort_type == CAJA_FILE_SORT_BY_DISPLAY_NAME && entry->sort_last) {
+			entry->key |= SORT_KEY_HIGH_BIT;
+		}
+	}
+
+	n_runs = 1;
+	if (use_sort_keys && n_items >= SORT_PARALLEL_THRESHOLD) {
+		n_runs = MIN (g_get_num_processors (), SORT_MAX_THREADS);
+	}
+
+	if (n_runs > 1) {
+		sort_entries_parallel (entries, n_items, &context, n_runs);
+	} else {
+		g_qsort_with_data (entries, n_items, sizeof (SortEntry),
+				   compare_sort_entries, &context);
+	}
+
+	for (i = 0; i < n_items; i++) {
+		items[i] = entries[i].item;
+	}
+
+	g_free (entries);
+	for (i = 0; i < N_TYPE_KEY_VARIANTS; i++) {
+		if (type_keys[i] != NULL) {
+			g_hash_table_destroy (type_keys[i]);
+		}
+	}
+	if (directory_keys != NULL) {
+		g_hash_table_destroy (directory_keys);
+	}
+}
+
+/**
+ * caja_file_list_sort:
+ * @file_list: GList of files
+ * @sort_type: Sort criterion
+ * @directories_first: Put all directories before any non-directories
+ * @reversed: Reverse the order of the items, except that
+ * the directories_first flag is still respected.
+ *
+ * Sorts the list like g_list_sort() with caja_file_compare_for_sort()
+ * would, using caja_file_sort_items().
+ *
+ * Return value: the sorted list.
+ **/
+GList *
+caja_file_list_sort (GList *file_list,
+		     CajaFileSortType sort_type,
+		     gboolean directories_first,
+		     gboolean reversed)
+{
+	CajaFileSortItem *items;
+	GList *node;
+	guint n_items, i;
+
+	n_items = g_list_length (file_list);
+	items = g_new (CajaFileSortItem, n_items);
+	for (node = file_list, i = 0; node != NULL; node = node->next, i++) {
+		items[i].file = node->data;
+		items[i].data = NULL;
+	}
+
+	caja_file_sort_items (items, n_items, sort_type, directories_first, reversed);
+
+	for (node = file_list, i = 0; node != NULL; node = node->next, i++) {
+		node->data = items[i].file;
+	}
+	g_free (items);
+
+	return file_list;
+}
+
 /**
  * caja_file_compare_name:
  * @file: A file object
@@ -4056,13 +4806,15 @@ caja_file_set_integer_metadata (CajaFile *file,
 static const char *
 caja_file_peek_display_name_collation_key (CajaFile *file)
 {
-	const char *res;
+	const char *display_name;
 
-	res = file->details->display_name_collation_key;
-	if (res == NULL)
-		res = "";
+	if (file->details->display_name_collation_key == NULL) {
+		display_name = caja_file_peek_display_name (file);
+		set_display_name_collation_key (file,
+						g_utf8_collate_key_for_filename (display_name, -1));
+	}
 
-	return res;
+	return file->details->display_name_collation_key;
 }
 
 static const char *
@@ -4193,7 +4945,7 @@ caja_file_is_trusted_link (CajaFile *file)
 gboolean
 caja_file_has_activation_uri (CajaFile *file)
 {
-	return file->details->activation_uri != NULL;
+	return caja_file_peek_extras (file)->activation_uri != NULL;
 }
 
 /* Return the uri associated with the passed-in file, which may not be
@@ -4203,10 +4955,13 @@ caja_file_has_activation_uri (CajaFile *file)
 char *
 caja_file_get_activation_uri (CajaFile *file)
 {
+	const char *activation_uri;
+
 	g_return_val_if_fail (CAJA_IS_FILE (file), NULL);
 
-	if (file->details->activation_uri != NULL) {
-		return g_strdup (file->details->activation_uri);
+	activation_uri = caja_file_peek_extras (file)->activation_uri;
+	if (activation_uri != NULL) {
+		return g_strdup (activation_uri);
 	}
 
 	return caja_file_get_uri (file);
@@ -4215,10 +4970,13 @@ caja_file_get_activation_uri (CajaFile *file)
 GFile *
 caja_file_get_activation_location (CajaFile *file)
 {
+	const char *activation_uri;
+
 	g_return_val_if_fail (CAJA_IS_FILE (file), NULL);
 
-	if (file->details->activation_uri != NULL) {
-		return g_file_new_for_uri (file->details->activation_uri);
+	activation_uri = caja_file_peek_extras (file)->activation_uri;
+	if (activation_uri != NULL) {
+		return g_file_new_for_uri (activation_uri);
 	}
 
 	return caja_file_get_location (file);
@@ -4324,13 +5082,16 @@ get_custom_icon (CajaFile *file)
 		g_free (custom_icon_uri);
 	}
 
-	if (icon == NULL && file->details->got_link_info && file->details->custom_icon != NULL) {
-		if (g_path_is_absolute (file->details->custom_icon)) {
-			icon_file = g_file_new_for_path (file->details->custom_icon);
+	if (icon == NULL && file->details->got_link_info && caja_file_peek_extras (file)->custom_icon != NULL) {
+		const char *link_icon;
+
+		link_icon = caja_file_peek_extras (file)->custom_icon;
+		if (g_path_is_absolute (link_icon)) {
+			icon_file = g_file_new_for_path (link_icon);
 			icon = g_file_icon_new (icon_file);
 			g_object_unref (icon_file);
 		} else {
-			icon = g_themed_icon_new (file->details->custom_icon);
+			icon = g_themed_icon_new (link_icon);
 		}
  	}
 
@@ -4707,7 +5468,7 @@ caja_file_get_custom_icon (CajaFile *file)
 	custom_icon = get_custom_icon_metadata_uri (file);
 
 	if (custom_icon == NULL && file->details->got_link_info) {
-		custom_icon = g_strdup (file->details->custom_icon);
+		custom_icon = g_strdup (caja_file_peek_extras (file)->custom_icon);
  	}
 
 	return custom_icon;
@@ -4972,7 +5733,7 @@ caja_file_fit_modified_date_as_string (CajaFile *file,
 static char *
 caja_file_get_trash_original_file_parent_as_string (CajaFile *file)
 {
-	if (file->details->trash_orig_path != NULL) {
+	if (caja_file_peek_extras (file)->trash_orig_path != NULL) {
 		CajaFile *orig_file, *parent;
 		GFile *location;
 		char *filename;
@@ -5512,7 +6273,7 @@ caja_file_set_permissions (CajaFile *file,
 gboolean
 caja_file_can_get_selinux_context (CajaFile *file)
 {
-	return file->details->selinux_context != NULL;
+	return caja_file_peek_extras (file)->selinux_context != NULL;
 }
 
 /**
@@ -5537,7 +6298,7 @@ caja_file_get_selinux_context (CajaFile *file)
 		return NULL;
 	}
 
-	raw = file->details->selinux_context;
+	raw = (char *) caja_file_peek_extras (file)->selinux_context;
 
 #ifdef HAVE_SELINUX
 	if (selinux_raw_to_trans_context (raw, &translated) == 0) {
@@ -6613,13 +7374,13 @@ caja_file_get_string_attribute_q (CajaFile *file, GQuark attribute_q)
 
 	extension_attribute = NULL;
 
-	if (file->details->pending_extension_attributes) {
-		extension_attribute = g_hash_table_lookup (file->details->pending_extension_attributes,
+	if (caja_file_peek_extension_info (file)->pending_extension_attributes) {
+		extension_attribute = g_hash_table_lookup (file->details->extension_info->pending_extension_attributes,
 							   GINT_TO_POINTER (attribute_q));
 	}
 
-	if (extension_attribute == NULL && file->details->extension_attributes) {
-		extension_attribute = g_hash_table_lookup (file->details->extension_attributes,
+	if (extension_attribute == NULL && caja_file_peek_extension_info (file)->extension_attributes) {
+		extension_attribute = g_hash_table_lookup (file->details->extension_info->extension_attributes,
 							   GINT_TO_POINTER (attribute_q));
 	}
 
@@ -7061,8 +7822,8 @@ caja_file_get_keywords (CajaFile *file)
 	keywords = caja_file_get_metadata_list
 		(file, CAJA_METADATA_KEY_EMBLEMS);
 
-	keywords = g_list_concat (keywords, g_list_copy_deep (file->details->extension_emblems, (GCopyFunc) g_strdup, NULL));
-	keywords = g_list_concat (keywords, g_list_copy_deep (file->details->pending_extension_emblems, (GCopyFunc) g_strdup, NULL));
+	keywords = g_list_concat (keywords, g_list_copy_deep (caja_file_peek_extension_info (file)->extension_emblems, (GCopyFunc) g_strdup, NULL));
+	keywords = g_list_concat (keywords, g_list_copy_deep (caja_file_peek_extension_info (file)->pending_extension_emblems, (GCopyFunc) g_strdup, NULL));
 
 	return sort_keyword_list_and_remove_duplicates (keywords);
 }
@@ -7613,7 +8374,7 @@ caja_file_peek_top_left_text (CajaFile *file,
 	}
 
 	/* Show what we read in. */
-	return file->details->top_left_text;
+	return (char *) caja_file_peek_extras (file)->top_left_text;
 }
 
 /**
@@ -7644,10 +8405,10 @@ caja_file_get_trash_original_file (CajaFile *file)
 
 	original_file = NULL;
 
-	if (file->details->trash_orig_path != NULL) {
+	if (caja_file_peek_extras (file)->trash_orig_path != NULL) {
 		GFile *location;
 
-		location = g_file_new_for_path (file->details->trash_orig_path);
+		location = g_file_new_for_path (file->details->extras->trash_orig_path);
 		original_file = caja_file_get (location);
 		g_object_unref (location);
 	}
@@ -7925,11 +8686,16 @@ invalidate_mount (CajaFile *file)
 void
 caja_file_invalidate_extension_info_internal (CajaFile *file)
 {
-	if (file->details->pending_info_providers)
-		g_list_free_full (file->details->pending_info_providers, g_object_unref);
+	GList *providers;
+
+	providers = caja_extensions_get_for_type (CAJA_TYPE_INFO_PROVIDER);
+	if (providers == NULL && file->details->extension_info == NULL) {
+		return;
+	}
 
-	file->details->pending_info_providers =
-		caja_extensions_get_for_type (CAJA_TYPE_INFO_PROVIDER);
+	g_list_free_full (caja_file_get_extension_info (file)->pending_info_providers,
+			  g_object_unref);
+	file->details->extension_info->pending_info_providers = providers;
 }
 
 void
@@ -8079,8 +8845,8 @@ caja_file_invalidate_all_attributes (CajaFile *file)
 void
 caja_file_dump (CajaFile *file)
 {
-	long size = file->details->deep_size;
-	long size_on_disk = file->details->deep_size_on_disk;
+	long size = caja_file_peek_deep_counts (file)->deep_size;
+	long size_on_disk = caja_file_peek_deep_counts (file)->deep_size_on_disk;
 	char *uri;
 	const char *file_kind;
 
@@ -8682,12 +9448,15 @@ static void
 caja_file_add_emblem (CajaFile *file,
 			  const char *emblem_name)
 {
-	if (file->details->pending_info_providers) {
-		file->details->pending_extension_emblems = g_list_prepend (file->details->pending_extension_emblems,
-									   g_strdup (emblem_name));
+	CajaFileExtensionInfo *extension_info;
+
+	extension_info = caja_file_get_extension_info (file);
+	if (extension_info->pending_info_providers) {
+		extension_info->pending_extension_emblems = g_list_prepend (extension_info->pending_extension_emblems,
+									    g_strdup (emblem_name));
 	} else {
-		file->details->extension_emblems = g_list_prepend (file->details->extension_emblems,
-								   g_strdup (emblem_name));
+		extension_info->extension_emblems = g_list_prepend (extension_info->extension_emblems,
+								    g_strdup (emblem_name));
 	}
 
 	caja_file_changed (file);
@@ -8698,25 +9467,28 @@ caja_file_add_string_attribute (CajaFile *file,
 				    const char *attribute_name,
 				    const char *value)
 {
-	if (file->details->pending_info_providers) {
+	CajaFileExtensionInfo *extension_info;
+
+	extension_info = caja_file_get_extension_info (file);
+	if (extension_info->pending_info_providers) {
 		/* Lazily create hashtable */
-		if (!file->details->pending_extension_attributes) {
-			file->details->pending_extension_attributes =
+		if (!extension_info->pending_extension_attributes) {
+			extension_info->pending_extension_attributes =
 				g_hash_table_new_full (g_direct_hash, g_direct_equal,
 						       NULL,
 						       (GDestroyNotify)g_free);
 		}
-		g_hash_table_insert (file->details->pending_extension_attributes,
+		g_hash_table_insert (extension_info->pending_extension_attributes,
 				     GINT_TO_POINTER (g_quark_from_string (attribute_name)),
 				     g_strdup (value));
 	} else {
-		if (!file->details->extension_attributes) {
-			file->details->extension_attributes =
+		if (!extension_info->extension_attributes) {
+			extension_info->extension_attributes =
 				g_hash_table_new_full (g_direct_hash, g_direct_equal,
 						       NULL,
 						       (GDestroyNotify)g_free);
 		}
-		g_hash_table_insert (file->details->extension_attributes,
+		g_hash_table_insert (extension_info->extension_attributes,
 				     GINT_TO_POINTER (g_quark_from_string (attribute_name)),
 				     g_strdup (value));
 	}
@@ -8733,16 +9505,21 @@ caja_file_invalidate_extension_info (CajaFile *file)
 void
 caja_file_info_providers_done (CajaFile *file)
 {
-	g_list_free_full (file->details->extension_emblems, g_free);
-	file->details->extension_emblems = file->details->pending_extension_emblems;
-	file->details->pending_extension_emblems = NULL;
+	CajaFileExtensionInfo *extension_info;
 
-	if (file->details->extension_attributes) {
-		g_hash_table_destroy (file->details->extension_attributes);
-	}
+	extension_info = file->details->extension_info;
+	if (extension_info != NULL) {
+		g_list_free_full (extension_info->extension_emblems, g_free);
+		extension_info->extension_emblems = extension_info->pending_extension_emblems;
+		extension_info->pending_extension_emblems = NULL;
 
-	file->details->extension_attributes = file->details->pending_extension_attributes;
-	file->details->pending_extension_attributes = NULL;
+		if (extension_info->extension_attributes) {
+			g_hash_table_destroy (extension_info->extension_attributes);
+		}
+
+		extension_info->extension_attributes = extension_info->pending_extension_attributes;
+		extension_info->pending_extension_attributes = NULL;
+	}
 
 	caja_file_changed (file);
 }
@@ -122,6 +122,13 @@ typedef char * (*CajaTruncateCallback)    (const char    *string,
 
 typedef void CajaFileListHandle;
 
+/* An entry sorted by caja_file_sort_items(), with data of the caller's */
+typedef struct
+{
+    CajaFile *file;
+    gpointer data;
+} CajaFileSortItem;
+
 /* GObject requirements. */
 GType                   caja_file_get_type                          (void);
 
@@ -427,6 +434,17 @@ int                     caja_file_compare_for_sort_by_attribute_q   (CajaFile
         gboolean                        directories_first,
         gboolean                        reversed);
 gboolean                caja_file_is_date_sort_attribute_q          (GQuark                          attribute);
+gboolean                caja_file_get_sort_type_for_attribute_q     (GQuark                          attribute,
+        CajaFileSortType           *sort_type);
+void                    caja_file_sort_items                        (CajaFileSortItem           *items,
+        guint                           n_items,
+        CajaFileSortType            sort_type,
+        gboolean                        directories_first,
+        gboolean                        reversed);
+GList *                 caja_file_list_sort                         (GList                          *file_list,
+        CajaFileSortType            sort_type,
+        gboolean                        directories_first,
+        gboolean                        reversed);
 
 int                     caja_file_compare_display_name              (CajaFile                   *file_1,
         const char                     *pattern);
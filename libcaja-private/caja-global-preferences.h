@@ -70,6 +70,12 @@ G_BEGIN_DECLS
 #define CAJA_PREFERENCES_USE_IEC_UNITS			"use-iec-units"
 #define CAJA_PREFERENCES_SHOW_ICONS_IN_LIST_VIEW	"show-icons-in-list-view"
 
+/* Search */
+#define CAJA_PREFERENCES_SEARCH_INDEX_ROOTS		"search-index-roots"
+
+/* Directory monitoring */
+#define CAJA_PREFERENCES_MONITOR_BATCH_LATENCY		"monitor-batch-latency"
+
 /* Mouse */
 #define CAJA_PREFERENCES_MOUSE_USE_EXTRA_BUTTONS 	"mouse-use-extra-buttons"
 #define CAJA_PREFERENCES_MOUSE_FORWARD_BUTTON		"mouse-forward-button"
@@ -186,6 +192,7 @@ typedef enum
 #define CAJA_PREFERENCES_SHOW_DIRECTORY_ITEM_COUNTS "show-directory-item-counts"
 #define CAJA_PREFERENCES_SHOW_IMAGE_FILE_THUMBNAILS	"show-image-thumbnails"
 #define CAJA_PREFERENCES_IMAGE_FILE_THUMBNAIL_LIMIT	"thumbnail-limit"
+#define CAJA_PREFERENCES_THUMBNAIL_THREADS		"thumbnail-threads"
 #define CAJA_PREFERENCES_PREVIEW_SOUND		        "preview-sound"
 
     typedef enum
@@ -92,6 +92,9 @@ struct _CajaIconCanvasItemPrivate
     double x, y;
     GdkPixbuf *pixbuf;
     cairo_surface_t *rendered_surface;
+    /* Size of the image while it is released, see
+     * caja_icon_canvas_item_release_image() */
+    int released_width, released_height;
     GList *emblem_pixbufs;
     char *editable_text;		/* Text that can be modified by a renaming function */
     char *additional_text;		/* Text that cannot be modifed, such as file size, etc. */
@@ -140,6 +143,8 @@ struct _CajaIconCanvasItemPrivate
 
     guint is_visible : 1;
 
+    guint is_image_released : 1;
+
     GdkRectangle embedded_text_rect;
     char *embedded_text;
 
@@ -226,6 +231,8 @@ static void     draw_pixbuf                          (GdkPixbuf
 static PangoLayout *get_label_layout                 (PangoLayout               **layout,
     						      CajaIconCanvasItem        *item,
     						      const char                *text);
+static PangoAlignment get_label_alignment           (CajaIconCanvasItem        *item);
+static PangoFontDescription *get_label_font_description (CajaIconCanvasItem     *item);
 
 static gboolean hit_test_stretch_handle              (CajaIconCanvasItem        *item,
     						      EelIRect                  canvas_rect,
@@ -519,6 +526,15 @@ get_scaled_icon_size (CajaIconCanvasItem *item,
         canvas = EEL_CANVAS_ITEM (item)->canvas;
         scale = gtk_widget_get_scale_factor (GTK_WIDGET (canvas));
         pixbuf = item->details->pixbuf;
+
+        if (item->details->is_image_released)
+        {
+            if (width)
+                *width = item->details->released_width / scale;
+            if (height)
+                *height = item->details->released_height / scale;
+            return;
+        }
     }
 
     if (width)
@@ -623,6 +639,7 @@ caja_icon_canvas_item_set_image (CajaIconCanvasItem *item,
     g_return_if_fail (image == NULL || pixbuf_is_acceptable (image));
 
     details = item->details;
+    details->is_image_released = FALSE;
     if (details->pixbuf == image)
     {
         return;
@@ -648,6 +665,76 @@ caja_icon_canvas_item_set_image (CajaIconCanvasItem *item,
     eel_canvas_item_request_update (EEL_CANVAS_ITEM (item));
 }
 
+/* Lets go of the image and what was rendered from it while the item is
+ * far from the visible part of the canvas, keeping its size so that the
+ * bounds of the item don't change. Set the image again before the item
+ * is drawn.
+ */
+void
+caja_icon_canvas_item_release_image (CajaIconCanvasItem *item)
+{
+    CajaIconCanvasItemPrivate *details;
+
+    g_return_if_fail (CAJA_IS_ICON_CANVAS_ITEM (item));
+
+    details = item->details;
+    if (details->pixbuf == NULL)
+    {
+        return;
+    }
+
+    details->released_width = gdk_pixbuf_get_width (details->pixbuf);
+    details->released_height = gdk_pixbuf_get_height (details->pixbuf);
+    details->is_image_released = TRUE;
+
+    g_object_unref (details->pixbuf);
+    details->pixbuf = NULL;
+
+    if (details->rendered_surface != NULL)
+    {
+        cairo_surface_destroy (details->rendered_surface);
+        details->rendered_surface = NULL;
+    }
+}
+
+/* Like caja_icon_canvas_item_release_image(), for when the image was
+ * not loaded at all: the item is laid out as if it had an image of the
+ * given size, in device pixels, until the image is set.
+ */
+void
+caja_icon_canvas_item_set_released_image_size (CajaIconCanvasItem *item,
+                                               int width,
+                                               int height)
+{
+    CajaIconCanvasItemPrivate *details;
+
+    g_return_if_fail (CAJA_IS_ICON_CANVAS_ITEM (item));
+
+    details = item->details;
+    if (details->is_image_released &&
+            details->released_width == width &&
+            details->released_height == height)
+    {
+        return;
+    }
+
+    caja_icon_canvas_item_release_image (item);
+    details->released_width = width;
+    details->released_height = height;
+    details->is_image_released = TRUE;
+
+    caja_icon_canvas_item_invalidate_bounds_cache (item);
+    eel_canvas_item_request_update (EEL_CANVAS_ITEM (item));
+}
+
+gboolean
+caja_icon_canvas_item_is_image_released (CajaIconCanvasItem *item)
+{
+    g_return_val_if_fail (CAJA_IS_ICON_CANVAS_ITEM (item), FALSE);
+
+    return item->details->is_image_released;
+}
+
 void
 caja_icon_canvas_item_set_emblems (CajaIconCanvasItem *item,
                                    GList *emblem_pixbufs)
@@ -1026,51 +1113,63 @@ layout_get_size_for_layout (PangoLayout *layout,
 #define TEXT_BACK_PADDING_X 4
 #define TEXT_BACK_PADDING_Y 1
 
-static void
-prepare_pango_layout_width (CajaIconCanvasItem *item,
-                            PangoLayout *layout)
+static int
+get_pango_layout_width (CajaIconCanvasItem *item)
 {
     if (caja_icon_canvas_item_get_max_text_width (item) < 0)
     {
-        pango_layout_set_width (layout, -1);
+        return -1;
     }
-    else
+
+    return floor (caja_icon_canvas_item_get_max_text_width (item)) * PANGO_SCALE;
+}
+
+static void
+prepare_pango_layout_width (CajaIconCanvasItem *item,
+                            PangoLayout *layout)
+{
+    int width;
+
+    width = get_pango_layout_width (item);
+    pango_layout_set_width (layout, width);
+    if (width >= 0)
     {
-        pango_layout_set_width (layout, floor (caja_icon_canvas_item_get_max_text_width (item)) * PANGO_SCALE);
         pango_layout_set_ellipsize (layout, PANGO_ELLIPSIZE_END);
     }
 }
 
-static void
-prepare_pango_layout_for_measure_entire_text (CajaIconCanvasItem *item,
-        PangoLayout *layout)
+static int
+get_pango_layout_height_for_measure_entire_text (CajaIconCanvasItem *item)
 {
     CajaIconContainer *container;
 
-    prepare_pango_layout_width (item, layout);
-
     container = CAJA_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
 
     if (IS_COMPACT_VIEW (container))
     {
-        pango_layout_set_height (layout, -1);
+        return -1;
     }
     else
     {
-        pango_layout_set_height (layout, G_MININT);
+        return G_MININT;
     }
 }
 
 static void
-prepare_pango_layout_for_draw (CajaIconCanvasItem *item,
-                               PangoLayout *layout)
+prepare_pango_layout_for_measure_entire_text (CajaIconCanvasItem *item,
+        PangoLayout *layout)
+{
+    prepare_pango_layout_width (item, layout);
+    pango_layout_set_height (layout, get_pango_layout_height_for_measure_entire_text (item));
+}
+
+static int
+get_pango_layout_height_for_draw (CajaIconCanvasItem *item)
 {
     CajaIconCanvasItemPrivate *details;
     CajaIconContainer *container;
     gboolean needs_highlight;
 
-    prepare_pango_layout_width (item, layout);
-
     container = CAJA_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
     details = item->details;
 
@@ -1078,7 +1177,7 @@ prepare_pango_layout_for_draw (CajaIconCanvasItem *item,
 
     if (IS_COMPACT_VIEW (container))
     {
-        pango_layout_set_height (layout, -1);
+        return -1;
     }
     else if (needs_highlight ||
              details->is_highlighted_as_keyboard_focus ||
@@ -1086,7 +1185,7 @@ prepare_pango_layout_for_draw (CajaIconCanvasItem *item,
              container->details->label_position == CAJA_ICON_LABEL_POSITION_BESIDE)
     {
         /* VOODOO-TODO, cf. compute_text_rectangle() */
-        pango_layout_set_height (layout, G_MININT);
+        return G_MININT;
     }
     else
     {
@@ -1094,20 +1193,190 @@ prepare_pango_layout_for_draw (CajaIconCanvasItem *item,
          * the layout height already fits into max. layout lines. But pango should figure this
          * out itself (which it doesn't ATM).
          */
-        pango_layout_set_height (layout,
-                                 caja_icon_container_get_max_layout_lines_for_pango (container));
+        return caja_icon_container_get_max_layout_lines_for_pango (container);
     }
 }
 
+static void
+prepare_pango_layout_for_draw (CajaIconCanvasItem *item,
+                               PangoLayout *layout)
+{
+    prepare_pango_layout_width (item, layout);
+    pango_layout_set_height (layout, get_pango_layout_height_for_draw (item));
+}
+
+/* Sizes of a label, shared by all the items showing the same text the
+ * same way, so that a relayout after a zoom, a resize or a new sort
+ * doesn't have to shape every label again.
+ */
+typedef struct
+{
+    int width;
+    int height;
+    int dx;
+    int height_for_entire_text;
+    int height_for_layout;
+} LabelSize;
+
+typedef struct
+{
+    char *key;
+    LabelSize size;
+    GList link;
+} LabelSizeCacheEntry;
+
+#define LABEL_SIZE_CACHE_MAX_ENTRIES 50000
+
+/* Maps keys to LabelSizeCacheEntries; the queue holds them most
+ * recently used first. */
+static GHashTable *label_size_cache = NULL;
+static GQueue label_size_cache_lru = G_QUEUE_INIT;
+
+static void
+label_size_cache_entry_free (gpointer data)
+{
+    LabelSizeCacheEntry *entry;
+
+    entry = data;
+    g_free (entry->key);
+    g_free (entry);
+}
+
+/* Everything that changes how the text is measured goes into the key */
+static char *
+get_label_size_key (CajaIconCanvasItem *item,
+                    const char *text,
+                    gboolean for_layout)
+{
+    CajaIconContainer *container;
+    PangoContext *context;
+    PangoFontDescription *desc;
+    char *font, *key;
+
+    container = CAJA_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
+    context = gtk_widget_get_pango_context (GTK_WIDGET (container));
+
+    desc = get_label_font_description (item);
+    font = pango_font_description_to_string (desc);
+    pango_font_description_free (desc);
+
+    key = g_strdup_printf ("%s\n%g\n%d\n%d\n%d\n%d\n%d\n%s",
+                           font,
+                           pango_cairo_context_get_resolution (context),
+                           get_label_alignment (item),
+                           get_pango_layout_width (item),
+                           get_pango_layout_height_for_draw (item),
+                           for_layout ? get_pango_layout_height_for_measure_entire_text (item) : 0,
+                           for_layout ? caja_icon_container_get_max_layout_lines (container) : 0,
+                           text);
+    g_free (font);
+
+    return key;
+}
+
+static void
+measure_label (CajaIconCanvasItem *item,
+               PangoLayout **layout_cache,
+               const char *text,
+               gboolean for_layout,
+               LabelSize *size)
+{
+    CajaIconContainer *container;
+    LabelSizeCacheEntry *entry;
+    PangoLayout *layout;
+    char *key;
+
+    key = get_label_size_key (item, text, for_layout);
+
+    if (label_size_cache == NULL)
+    {
+        label_size_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  NULL, label_size_cache_entry_free);
+    }
+
+    entry = g_hash_table_lookup (label_size_cache, key);
+    if (entry != NULL)
+    {
+        g_queue_unlink (&label_size_cache_lru, &entry->link);
+        g_queue_push_head_link (&label_size_cache_lru, &entry->link);
+
+        *size = entry->size;
+        g_free (key);
+        return;
+    }
+
+    container = CAJA_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
+    layout = get_label_layout (layout_cache, item, text);
+
+    /* first, measure required text height: height_for_entire_text
+     * then, measure text height applicable for layout: height_for_layout
+     * next, measure actually displayed height: height
+     */
+    size->height_for_entire_text = 0;
+    size->height_for_layout = 0;
+    if (for_layout)
+    {
+        prepare_pango_layout_for_measure_entire_text (item, layout);
+        layout_get_full_size (layout,
+                              NULL,
+                              &size->height_for_entire_text,
+                              NULL);
+        layout_get_size_for_layout (layout,
+                                    caja_icon_container_get_max_layout_lines (container),
+                                    size->height_for_entire_text,
+                                    &size->height_for_layout);
+    }
+
+    prepare_pango_layout_for_draw (item, layout);
+    layout_get_full_size (layout,
+                          &size->width,
+                          &size->height,
+                          &size->dx);
+
+    g_object_unref (layout);
+
+    entry = g_new (LabelSizeCacheEntry, 1);
+    entry->key = key;
+    entry->size = *size;
+    entry->link.data = entry;
+    entry->link.prev = entry->link.next = NULL;
+    g_hash_table_insert (label_size_cache, key, entry);
+    g_queue_push_head_link (&label_size_cache_lru, &entry->link);
+
+    while (label_size_cache_lru.length > LABEL_SIZE_CACHE_MAX_ENTRIES)
+    {
+        entry = g_queue_peek_tail (&label_size_cache_lru);
+        g_queue_unlink (&label_size_cache_lru, &entry->link);
+        g_hash_table_remove (label_size_cache, entry->key);
+    }
+}
+
+/**
+ * caja_icon_canvas_item_clear_label_size_cache:
+ *
+ * Forgets the label sizes measured so far, for when the way text is
+ * rendered changes in a way the cache doesn't know about, such as new
+ * font rendering settings.
+ **/
+void
+caja_icon_canvas_item_clear_label_size_cache (void)
+{
+    if (label_size_cache == NULL)
+    {
+        return;
+    }
+
+    g_queue_init (&label_size_cache_lru);
+    g_hash_table_remove_all (label_size_cache);
+}
+
 static void
 measure_label_text (CajaIconCanvasItem *item)
 {
     CajaIconCanvasItemPrivate *details;
-    CajaIconContainer *container;
     gint editable_height, editable_height_for_layout, editable_height_for_entire_text, editable_width, editable_dx;
     gint additional_height, additional_width, additional_dx;
-    PangoLayout *editable_layout;
-    PangoLayout *additional_layout;
+    LabelSize size;
     gboolean have_editable, have_additional;
 
     /* check to see if the cached values are still valid; if so, there's
@@ -1152,41 +1421,24 @@ measure_label_text (CajaIconCanvasItem *item)
     additional_height = 0;
     additional_dx = 0;
 
-    container = CAJA_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
-    editable_layout = NULL;
-    additional_layout = NULL;
-
     if (have_editable)
     {
-        /* first, measure required text height: editable_height_for_entire_text
-         * then, measure text height applicable for layout: editable_height_for_layout
-         * next, measure actually displayed height: editable_height
-         */
-        editable_layout = get_label_layout (&details->editable_text_layout, item, details->editable_text);
-
-        prepare_pango_layout_for_measure_entire_text (item, editable_layout);
-        layout_get_full_size (editable_layout,
-                              NULL,
-                              &editable_height_for_entire_text,
-                              NULL);
-        layout_get_size_for_layout (editable_layout,
-                                    caja_icon_container_get_max_layout_lines (container),
-                                    editable_height_for_entire_text,
-                                    &editable_height_for_layout);
-
-        prepare_pango_layout_for_draw (item, editable_layout);
-        layout_get_full_size (editable_layout,
-                              &editable_width,
-                              &editable_height,
-                              &editable_dx);
+        measure_label (item, &details->editable_text_layout,
+                       details->editable_text, TRUE, &size);
+        editable_width = size.width;
+        editable_height = size.height;
+        editable_dx = size.dx;
+        editable_height_for_entire_text = size.height_for_entire_text;
+        editable_height_for_layout = size.height_for_layout;
     }
 
     if (have_additional)
     {
-        additional_layout = get_label_layout (&details->additional_text_layout, item, details->additional_text);
-        prepare_pango_layout_for_draw (item, additional_layout);
-        layout_get_full_size (additional_layout,
-                              &additional_width, &additional_height, &additional_dx);
+        measure_label (item, &details->additional_text_layout,
+                       details->additional_text, FALSE, &size);
+        additional_width = size.width;
+        additional_height = size.height;
+        additional_dx = size.dx;
     }
 
     details->editable_text_height = editable_height;
@@ -1225,16 +1477,6 @@ measure_label_text (CajaIconCanvasItem *item)
 
     /* extra to make it look nicer */
     details->text_width += TEXT_BACK_PADDING_X*2;
-
-    if (editable_layout)
-    {
-        g_object_unref (editable_layout);
-    }
-
-    if (additional_layout)
-    {
-        g_object_unref (additional_layout);
-    }
 }
 
 static void
@@ -1436,6 +1678,13 @@ caja_icon_canvas_item_set_is_visible (CajaIconCanvasItem       *item,
     if (!visible)
     {
         caja_icon_canvas_item_invalidate_label (item);
+
+        /* It is rendered again from the image when needed */
+        if (item->details->rendered_surface != NULL)
+        {
+            cairo_surface_destroy (item->details->rendered_surface);
+            item->details->rendered_surface = NULL;
+        }
     }
 }
 
@@ -1965,6 +2214,55 @@ caja_icon_canvas_item_draw (EelCanvasItem *item,
 	 (g_ascii_isdigit (*(p+1)) && \
 	  g_ascii_isdigit (*(p+2))))
 
+static PangoAlignment
+get_label_alignment (CajaIconCanvasItem *item)
+{
+    CajaIconContainer *container;
+
+    container = CAJA_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
+
+    if (container->details->label_position == CAJA_ICON_LABEL_POSITION_BESIDE)
+    {
+        if (!caja_icon_container_is_layout_rtl (container))
+        {
+            return PANGO_ALIGN_LEFT;
+        }
+        else
+        {
+            return PANGO_ALIGN_RIGHT;
+        }
+    }
+    else
+    {
+        return PANGO_ALIGN_CENTER;
+    }
+}
+
+static PangoFontDescription *
+get_label_font_description (CajaIconCanvasItem *item)
+{
+    CajaIconContainer *container;
+    PangoContext *context;
+    PangoFontDescription *desc;
+
+    container = CAJA_ICON_CONTAINER (EEL_CANVAS_ITEM (item)->canvas);
+    context = gtk_widget_get_pango_context (GTK_WIDGET (container));
+
+    if (container->details->font)
+    {
+        desc = pango_font_description_from_string (container->details->font);
+    }
+    else
+    {
+        desc = pango_font_description_copy (pango_context_get_font_description (context));
+        pango_font_description_set_size (desc,
+                                         pango_font_description_get_size (desc) +
+                                         container->details->font_size_table [container->details->zoom_level]);
+    }
+
+    return desc;
+}
+
 static PangoLayout *
 create_label_layout (CajaIconCanvasItem *item,
                      const char *text)
@@ -1972,7 +2270,6 @@ create_label_layout (CajaIconCanvasItem *item,
     PangoLayout *layout;
     PangoContext *context;
     PangoFontDescription *desc;
-    CajaIconContainer *container;
     EelCanvasItem *canvas_item;
     char *zeroified_text;
 #if PANGO_CHECK_VERSION (1, 44, 0)
@@ -1981,7 +2278,6 @@ create_label_layout (CajaIconCanvasItem *item,
 
     canvas_item = EEL_CANVAS_ITEM (item);
 
-    container = CAJA_ICON_CONTAINER (canvas_item->canvas);
     context = gtk_widget_get_pango_context (GTK_WIDGET (canvas_item->canvas));
     layout = pango_layout_new (context);
 #if PANGO_CHECK_VERSION (1, 44, 0)
@@ -2016,22 +2312,7 @@ create_label_layout (CajaIconCanvasItem *item,
 
     pango_layout_set_text (layout, zeroified_text, -1);
     pango_layout_set_auto_dir (layout, FALSE);
-
-    if (container->details->label_position == CAJA_ICON_LABEL_POSITION_BESIDE)
-    {
-        if (!caja_icon_container_is_layout_rtl (container))
-        {
-            pango_layout_set_alignment (layout, PANGO_ALIGN_LEFT);
-        }
-        else
-        {
-            pango_layout_set_alignment (layout, PANGO_ALIGN_RIGHT);
-        }
-    }
-    else
-    {
-        pango_layout_set_alignment (layout, PANGO_ALIGN_CENTER);
-    }
+    pango_layout_set_alignment (layout, get_label_alignment (item));
 
     pango_layout_set_spacing (layout, LABEL_LINE_SPACING);
     pango_layout_set_wrap (layout, PANGO_WRAP_WORD_CHAR);
@@ -2041,18 +2322,7 @@ create_label_layout (CajaIconCanvasItem *item,
     pango_layout_set_attributes (layout, attr_list);
 #endif
 
-    /* Create a font description */
-    if (container->details->font)
-    {
-        desc = pango_font_description_from_string (container->details->font);
-    }
-    else
-    {
-        desc = pango_font_description_copy (pango_context_get_font_description (context));
-        pango_font_description_set_size (desc,
-                                         pango_font_description_get_size (desc) +
-                                         container->details->font_size_table [container->details->zoom_level]);
-    }
+    desc = get_label_font_description (item);
     pango_layout_set_font_description (layout, desc);
     pango_font_description_free (desc);
     g_free (zeroified_text);
@@ -3275,11 +3545,9 @@ caja_icon_canvas_item_accessible_get_offset_at_point (AtkText	 *text,
 
     item = CAJA_ICON_CANVAS_ITEM (atk_gobject_accessible_get_object (ATK_GOBJECT_ACCESSIBLE (text)));
 
-    if (item->details->pixbuf)
-    {
-        get_scaled_icon_size (item, NULL, &height);
-        y -= height;
-    }
+    /* The stored size stands in for a released image */
+    get_scaled_icon_size (item, NULL, &height);
+    y -= height;
     have_editable = item->details->editable_text != NULL &&
                     item->details->editable_text[0] != '\0';
     have_additional = item->details->additional_text != NULL &&item->details->additional_text[0] != '\0';
@@ -3400,11 +3668,8 @@ caja_icon_canvas_item_accessible_get_character_extents (AtkText	   *text,
     atk_component_get_extents (ATK_COMPONENT (text), &pos_x, &pos_y, NULL, NULL, coords);
     item = CAJA_ICON_CANVAS_ITEM (atk_gobject_accessible_get_object (ATK_GOBJECT_ACCESSIBLE (text)));
 
-    if (item->details->pixbuf)
-    {
-        get_scaled_icon_size (item, NULL, &pix_height);
-        pos_y += pix_height;
-    }
+    get_scaled_icon_size (item, NULL, &pix_height);
+    pos_y += pix_height;
 
     have_editable = item->details->editable_text != NULL &&
                     item->details->editable_text[0] != '\0';
@@ -72,6 +72,11 @@ G_BEGIN_DECLS
     /* attributes */
     void        caja_icon_canvas_item_set_image                (CajaIconCanvasItem       *item,
             GdkPixbuf                    *image);
+    void        caja_icon_canvas_item_release_image            (CajaIconCanvasItem       *item);
+    void        caja_icon_canvas_item_set_released_image_size  (CajaIconCanvasItem       *item,
+            int                           width,
+            int                           height);
+    gboolean    caja_icon_canvas_item_is_image_released        (CajaIconCanvasItem       *item);
 
     cairo_surface_t* caja_icon_canvas_item_get_drag_surface    (CajaIconCanvasItem       *item);
 
@@ -99,6 +104,7 @@ G_BEGIN_DECLS
             GtkCornerType                *corner);
     void        caja_icon_canvas_item_invalidate_label         (CajaIconCanvasItem       *item);
     void        caja_icon_canvas_item_invalidate_label_size    (CajaIconCanvasItem       *item);
+    void        caja_icon_canvas_item_clear_label_size_cache   (void);
     EelDRect    caja_icon_canvas_item_get_icon_rectangle       (const CajaIconCanvasItem *item);
     EelDRect    caja_icon_canvas_item_get_text_rectangle       (CajaIconCanvasItem       *item,
             gboolean                      for_layout);
@@ -123,6 +123,15 @@
 /* Copied from CajaFile */
 #define UNDEFINED_TIME ((time_t) (-1))
 
+/* Size of the cells of the spatial index, and how far around the
+ * bounds of an icon it is indexed, in world units */
+#define SPATIAL_INDEX_CELL_SIZE 256
+#define SPATIAL_INDEX_MARGIN 8
+
+/* Icons further than this many viewports from the visible area let go
+ * of their images */
+#define NEAR_VIEWPORTS 1
+
 enum
 {
     ACTION_ACTIVATE,
@@ -294,6 +303,65 @@ icon_is_positioned (const CajaIcon *icon)
     return icon->x != ICON_UNPOSITIONED_VALUE && icon->y != ICON_UNPOSITIONED_VALUE;
 }
 
+/* Keeps the icon's entry in the spatial index in line with the area
+ * its canvas item covers. Call this whenever the position or the size
+ * of the item may have changed. */
+static void
+icon_update_spatial_index (CajaIconContainer *container,
+                           CajaIcon *icon)
+{
+    EelCanvasItem *item;
+    EelDRect bounds, entire_bounds;
+
+    if (!icon_is_positioned (icon))
+    {
+        caja_icon_spatial_index_remove (container->details->spatial_index, icon);
+        return;
+    }
+
+    /* The item bounds grow when the full label is shown on hover, so
+     * index whichever is larger, plus a margin for emblems and focus.
+     */
+    item = EEL_CANVAS_ITEM (icon->item);
+    eel_canvas_item_get_bounds (item,
+                                &bounds.x0, &bounds.y0,
+                                &bounds.x1, &bounds.y1);
+    caja_icon_canvas_item_get_bounds_for_entire_item (icon->item,
+            &entire_bounds.x0, &entire_bounds.y0,
+            &entire_bounds.x1, &entire_bounds.y1);
+    eel_drect_union (&bounds, &bounds, &entire_bounds);
+
+    eel_canvas_item_i2w (item->parent, &bounds.x0, &bounds.y0);
+    eel_canvas_item_i2w (item->parent, &bounds.x1, &bounds.y1);
+
+    bounds.x0 -= SPATIAL_INDEX_MARGIN;
+    bounds.y0 -= SPATIAL_INDEX_MARGIN;
+    bounds.x1 += SPATIAL_INDEX_MARGIN;
+    bounds.y1 += SPATIAL_INDEX_MARGIN;
+
+    caja_icon_spatial_index_set (container->details->spatial_index, icon, &bounds);
+}
+
+static void
+update_spatial_index (CajaIconContainer *container)
+{
+    GList *p;
+
+    for (p = container->details->icons; p != NULL; p = p->next)
+    {
+        icon_update_spatial_index (container, p->data);
+    }
+}
+
+/* Returns the icons that may have some part in the area, given in
+ * world coordinates. Free the list with g_list_free(). */
+GList *
+caja_icon_container_get_icons_in_area (CajaIconContainer *container,
+                                       const EelDRect *area)
+{
+    return caja_icon_spatial_index_query (container->details->spatial_index, area);
+}
+
 /* x, y are the top-left coordinates of the icon. */
 static void
 icon_set_position_full (CajaIcon *icon,
@@ -413,6 +481,8 @@ icon_set_position_full (CajaIcon *icon,
 
     icon->x = x;
     icon->y = y;
+
+    icon_update_spatial_index (container, icon);
 }
 
 static void
@@ -1250,10 +1320,25 @@ sort_icons (CajaIconContainer *container,
     *icons = g_list_sort_with_data (*icons, compare_icons, container);
 }
 
+static void
+renumber_stack_order (CajaIconContainer *container,
+                      GList *icons,
+                      int stack_order)
+{
+    GList *p;
+
+    for (p = icons; p != NULL; p = p->next)
+    {
+        ((CajaIcon *) p->data)->stack_order = stack_order++;
+    }
+}
+
 static void
 resort (CajaIconContainer *container)
 {
     sort_icons (container, &container->details->icons);
+    renumber_stack_order (container, container->details->icons, 0);
+    container->details->front_stack_order = 0;
 }
 
 typedef struct
@@ -1350,10 +1435,35 @@ lay_down_one_column (CajaIconContainer *container,
     }
 }
 
+typedef struct
+{
+    guint first_index;
+    double y;
+} LayoutRow;
+
+static void
+add_layout_row (GArray *rows, guint first_index, double y)
+{
+    LayoutRow row;
+
+    if (rows != NULL)
+    {
+        row.first_index = first_index;
+        row.y = y;
+        g_array_append_val (rows, row);
+    }
+}
+
+/* Lays down icons in rows. When rows is given, the index in rows of
+ * the first icon of each row is appended to it, counting from
+ * first_index for the first of the icons.
+ */
 static void
 lay_down_icons_horizontal (CajaIconContainer *container,
                            GList *icons,
-                           double start_y)
+                           double start_y,
+                           GArray *rows,
+                           guint first_index)
 {
     GList *p, *line_start;
     CajaIcon *icon;
@@ -1368,6 +1478,7 @@ lay_down_icons_horizontal (CajaIconContainer *container,
     double max_text_width, max_icon_width;
     int icon_width;
     int i;
+    guint index;
     GtkAllocation allocation;
     GArray *positions;
     IconPositions *position = NULL;
@@ -1419,10 +1530,12 @@ lay_down_icons_horizontal (CajaIconContainer *container,
     line_start = icons;
     y = start_y + CONTAINER_PAD_TOP;
     i = 0;
+    index = first_index;
+    add_layout_row (rows, index, y);
 
     max_height_above = 0;
     max_height_below = 0;
-    for (p = icons; p != NULL; p = p->next)
+    for (p = icons; p != NULL; p = p->next, index++)
     {
         double height_above, height_below;
 
@@ -1478,6 +1591,7 @@ lay_down_icons_horizontal (CajaIconContainer *container,
             line_width = container->details->label_position == CAJA_ICON_LABEL_POSITION_BESIDE ? ICON_PAD_LEFT : 0;
             line_start = p;
             i = 0;
+            add_layout_row (rows, index, y);
 
             max_height_above = height_above;
             max_height_below = height_below;
@@ -2328,7 +2442,7 @@ lay_down_icons (CajaIconContainer *container, GList *icons, double start_y)
     {
     case CAJA_ICON_LAYOUT_L_R_T_B:
     case CAJA_ICON_LAYOUT_R_L_T_B:
-        lay_down_icons_horizontal (container, icons, start_y);
+        lay_down_icons_horizontal (container, icons, start_y, NULL, 0);
         break;
 
     case CAJA_ICON_LAYOUT_T_B_L_R:
@@ -2348,9 +2462,223 @@ lay_down_icons (CajaIconContainer *container, GList *icons, double start_y)
     }
 }
 
+static double
+get_layout_width (CajaIconContainer *container)
+{
+    GtkAllocation allocation;
+
+    gtk_widget_get_allocation (GTK_WIDGET (container), &allocation);
+    return CANVAS_WIDTH (container, allocation);
+}
+
+static void
+invalidate_layout_rows (CajaIconContainer *container)
+{
+    g_array_set_size (container->details->layout_rows, 0);
+    container->details->layout_dirty_index = G_MAXUINT;
+}
+
+/* Records that the icons from index on in the icon list have to be
+ * laid down again. */
+static void
+set_layout_dirty_index (CajaIconContainer *container, guint index)
+{
+    container->details->layout_dirty_index =
+        MIN (container->details->layout_dirty_index, index);
+}
+
+/* Sorts and lays down all the icons, keeping the rows of a horizontal
+ * layout for the next incremental one. */
+static void
+lay_down_all_icons (CajaIconContainer *container)
+{
+    CajaIconContainerDetails *details;
+    GList *p;
+    CajaIcon *icon = NULL;
+
+    details = container->details;
+
+    for (p = details->icons; p != NULL; p = p->next)
+    {
+        icon = p->data;
+        icon->needs_layout = FALSE;
+        icon->is_laid_out = TRUE;
+    }
+
+    resort (container);
+
+    invalidate_layout_rows (container);
+    if (details->layout_mode == CAJA_ICON_LAYOUT_L_R_T_B ||
+            details->layout_mode == CAJA_ICON_LAYOUT_R_L_T_B)
+    {
+        details->layout_width = get_layout_width (container);
+        lay_down_icons_horizontal (container, details->icons, 0,
+                                   details->layout_rows, 0);
+    }
+    else
+    {
+        lay_down_icons (container, details->icons, 0);
+    }
+}
+
+/* Puts the new and changed icons in their place in the sorted icon
+ * list and lays down the rows from the first one that changed. Returns
+ * FALSE if the last layout can't be built on and everything has to be
+ * laid down again.
+ */
+static gboolean
+lay_down_changed_icons (CajaIconContainer *container,
+                        guint *n_laid_out)
+{
+    CajaIconContainerDetails *details;
+    GList *icons, *changed, *p, *next, *prev, *link;
+    LayoutRow *row;
+    guint index, n_icons, dirty_index, lo, hi, mid;
+    CajaIcon *icon = NULL;
+
+    details = container->details;
+
+    /* Rows are only kept for horizontal layouts. With labels beside
+     * the icons the grid depends on the widest icon of all, so any
+     * change can move every icon.
+     */
+    if (details->layout_rows->len == 0 ||
+            details->label_position == CAJA_ICON_LABEL_POSITION_BESIDE ||
+            details->layout_width != get_layout_width (container))
+    {
+        return FALSE;
+    }
+
+    /* Take the changed icons out, the others are still sorted */
+    icons = details->icons;
+    changed = NULL;
+    dirty_index = details->layout_dirty_index;
+    index = 0;
+    for (p = icons; p != NULL; p = next)
+    {
+        next = p->next;
+        icon = p->data;
+
+        if (icon->needs_layout)
+        {
+            icon->needs_layout = FALSE;
+            /* New icons left no hole, only where they go in matters */
+            if (icon->is_laid_out)
+            {
+                dirty_index = MIN (dirty_index, index);
+            }
+            icon->is_laid_out = TRUE;
+            icons = g_list_remove_link (icons, p);
+            changed = g_list_concat (p, changed);
+        }
+        else
+        {
+            index++;
+        }
+    }
+
+    /* and merge them back in */
+    sort_icons (container, &changed);
+    n_icons = index;
+    index = 0;
+    prev = NULL;
+    p = icons;
+    while (changed != NULL)
+    {
+        link = changed;
+        changed = g_list_remove_link (changed, link);
+
+        while (p != NULL && compare_icons (p->data, link->data, container) <= 0)
+        {
+            prev = p;
+            p = p->next;
+            index++;
+        }
+
+        dirty_index = MIN (dirty_index, index);
+
+        link->prev = prev;
+        link->next = p;
+        if (prev != NULL)
+        {
+            prev->next = link;
+        }
+        else
+        {
+            icons = link;
+        }
+        if (p != NULL)
+        {
+            p->prev = link;
+        }
+
+        prev = link;
+        index++;
+        n_icons++;
+    }
+    details->icons = icons;
+    details->layout_dirty_index = G_MAXUINT;
+
+    if (dirty_index == G_MAXUINT)
+    {
+        *n_laid_out = 0;
+        return TRUE;
+    }
+
+    /* Find the row the first changed icon is in. If that's past the
+     * end, start at the last row, which now needs the whole text. */
+    lo = 0;
+    hi = details->layout_rows->len;
+    while (hi - lo > 1)
+    {
+        mid = (lo + hi) / 2;
+        row = &g_array_index (details->layout_rows, LayoutRow, mid);
+        if (row->first_index <= dirty_index)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    while (lo > 0 &&
+            g_array_index (details->layout_rows, LayoutRow, lo).first_index >= n_icons)
+    {
+        lo--;
+    }
+
+    row = &g_array_index (details->layout_rows, LayoutRow, lo);
+    index = row->first_index;
+    g_array_set_size (details->layout_rows, lo);
+
+    link = g_list_nth (icons, index);
+    lay_down_icons_horizontal (container, link,
+                               row->y - CONTAINER_PAD_TOP,
+                               details->layout_rows, index);
+
+    /* Sizes may have changed without the icons moving */
+    for (p = link; p != NULL; p = p->next)
+    {
+        icon_update_spatial_index (container, p->data);
+    }
+
+    /* Nothing before the first changed row moved in the list */
+    renumber_stack_order (container, link, index);
+
+    *n_laid_out = n_icons - index;
+    return TRUE;
+}
+
 static void
 redo_layout_internal (CajaIconContainer *container)
 {
+    CajaIconContainerDetails *details;
+    gint64 start_time;
+    guint n_laid_out;
+
+    details = container->details;
+
     finish_adding_new_icons (container);
 
     /* Don't do any re-laying-out during stretching. Later we
@@ -2358,11 +2686,33 @@ redo_layout_internal (CajaIconContainer *container)
      * the stretched icon, but if we do it we want it to be fast
      * and only re-lay-out when it's really needed.
      */
-    if (container->details->auto_layout
-            && container->details->drag_state != DRAG_STATE_STRETCH)
+    if (details->auto_layout
+            && details->drag_state != DRAG_STATE_STRETCH)
     {
-        resort (container);
-        lay_down_icons (container, container->details->icons, 0);
+        start_time = g_get_monotonic_time ();
+
+        if (lay_down_changed_icons (container, &n_laid_out))
+        {
+            details->n_incremental_layouts++;
+            details->incremental_layout_time += g_get_monotonic_time () - start_time;
+            details->icons_laid_out += n_laid_out;
+        }
+        else
+        {
+            lay_down_all_icons (container);
+
+            /* Sizes may have changed without the icons moving */
+            update_spatial_index (container);
+
+            details->n_full_layouts++;
+            details->full_layout_time += g_get_monotonic_time () - start_time;
+            details->icons_laid_out += g_hash_table_size (details->icon_set);
+        }
+    }
+    else
+    {
+        invalidate_layout_rows (container);
+        update_spatial_index (container);
     }
 
     if (caja_icon_container_is_layout_rtl (container))
@@ -2399,8 +2749,11 @@ unschedule_redo_layout (CajaIconContainer *container)
     }
 }
 
+/* Schedules a layout that only lays down again the icons that were
+ * added, changed or moved by a removal, if the last layout allows it.
+ */
 static void
-schedule_redo_layout (CajaIconContainer *container)
+schedule_incremental_layout (CajaIconContainer *container)
 {
     if (container->details->idle_id == 0
             && container->details->has_been_allocated)
@@ -2410,10 +2763,18 @@ schedule_redo_layout (CajaIconContainer *container)
     }
 }
 
+static void
+schedule_redo_layout (CajaIconContainer *container)
+{
+    invalidate_layout_rows (container);
+    schedule_incremental_layout (container);
+}
+
 static void
 redo_layout (CajaIconContainer *container)
 {
     unschedule_redo_layout (container);
+    invalidate_layout_rows (container);
     redo_layout_internal (container);
 }
 
@@ -2692,16 +3053,31 @@ rubberband_select (CajaIconContainer *container,
                    const EelDRect *previous_rect,
                    const EelDRect *current_rect)
 {
-    GList *p;
+    GList *candidates, *p;
     gboolean selection_changed, is_in, canvas_rect_calculated;
     EelIRect canvas_rect;
+    EelDRect area;
     EelCanvas *canvas;
     CajaIcon *icon = NULL;
 
     selection_changed = FALSE;
     canvas_rect_calculated = FALSE;
 
-    for (p = container->details->icons; p != NULL; p = p->next)
+    /* Icons outside both rectangles were outside the band last time
+     * and still are, so their selection can't change. Without a
+     * previous rectangle any icon may have to be reverted.
+     */
+    if (previous_rect != NULL)
+    {
+        eel_drect_union (&area, previous_rect, current_rect);
+        candidates = caja_icon_container_get_icons_in_area (container, &area);
+    }
+    else
+    {
+        candidates = g_list_copy (container->details->icons);
+    }
+
+    for (p = candidates; p != NULL; p = p->next)
     {
         icon = p->data;
 
@@ -2730,6 +3106,7 @@ rubberband_select (CajaIconContainer *container,
                              (container, icon,
                               is_in ^ icon->was_selected_before_rubberband);
     }
+    g_list_free (candidates);
 
     if (selection_changed)
     {
@@ -3819,6 +4196,73 @@ closest_in_90_degrees (CajaIconContainer *container,
     return FALSE;
 }
 
+/* Like find_best_icon(). The usual destinations of the arrow keys only
+ * take icons on the start row or column, so only the icons indexed
+ * there are looked at. The other functions take icons anywhere, for
+ * "the nearest one" or "the first of the next row", and still look at
+ * all of them; they run when the start row or column has nothing more,
+ * or in manual layouts.
+ */
+static CajaIcon *
+find_best_arrow_key_icon (CajaIconContainer *container,
+                          CajaIcon *start_icon,
+                          IsBetterIconFunction function,
+                          void *data)
+{
+    GList *candidates, *p;
+    CajaIcon *best, *candidate;
+    EelDRect area;
+    double x, y;
+
+    /* Icons that aren't positioned yet aren't indexed */
+    if (caja_icon_spatial_index_size (container->details->spatial_index) !=
+            g_hash_table_size (container->details->icon_set))
+    {
+        return find_best_icon (container, start_icon, function, data);
+    }
+
+    eel_canvas_c2w (EEL_CANVAS (container),
+                    container->details->arrow_key_start_x,
+                    container->details->arrow_key_start_y,
+                    &x, &y);
+
+    if (function == same_row_right_side_leftmost ||
+            function == same_row_left_side_rightmost)
+    {
+        area.x0 = -G_MAXDOUBLE;
+        area.x1 = G_MAXDOUBLE;
+        area.y0 = area.y1 = y;
+    }
+    else if (function == same_column_above_lowest ||
+             function == same_column_below_highest)
+    {
+        area.x0 = area.x1 = x;
+        area.y0 = -G_MAXDOUBLE;
+        area.y1 = G_MAXDOUBLE;
+    }
+    else
+    {
+        return find_best_icon (container, start_icon, function, data);
+    }
+
+    /* The order doesn't matter, these functions break ties by URI */
+    candidates = caja_icon_container_get_icons_in_area (container, &area);
+    best = NULL;
+    for (p = candidates; p != NULL; p = p->next)
+    {
+        candidate = p->data;
+
+        if (candidate != start_icon &&
+                (* function) (container, start_icon, best, candidate, data))
+        {
+            best = candidate;
+        }
+    }
+    g_list_free (candidates);
+
+    return best;
+}
+
 static EelDRect
 get_rubberband (CajaIcon *icon1,
                 CajaIcon *icon2)
@@ -4037,7 +4481,7 @@ keyboard_arrow_key (CajaIconContainer *container,
     {
         record_arrow_key_start (container, from, direction);
 
-        to = find_best_icon
+        to = find_best_arrow_key_icon
              (container, from,
               container->details->auto_layout ? better_destination : better_destination_manual,
               &data);
@@ -4449,6 +4893,11 @@ finalize (GObject *object)
     g_hash_table_destroy (details->icon_set);
     details->icon_set = NULL;
 
+    caja_icon_spatial_index_free (details->spatial_index);
+    g_list_free (details->visible_icons);
+    g_list_free (details->near_icons);
+    g_array_free (details->layout_rows, TRUE);
+
     g_free (details->font);
 
     if (details->a11y_item_action_queue != NULL)
@@ -4685,6 +5134,9 @@ style_updated (GtkWidget *widget)
 
     if (gtk_widget_get_realized (widget))
     {
+        /* Font rendering settings may have changed */
+        caja_icon_canvas_item_clear_label_size_cache ();
+
         invalidate_labels (container);
         caja_icon_container_request_update_all (container);
     }
@@ -6785,6 +7237,9 @@ caja_icon_container_init (CajaIconContainer *container)
     details = g_new0 (CajaIconContainerDetails, 1);
 
     details->icon_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+    details->spatial_index = caja_icon_spatial_index_new (SPATIAL_INDEX_CELL_SIZE);
+    details->layout_rows = g_array_new (FALSE, FALSE, sizeof (LayoutRow));
+    details->layout_dirty_index = G_MAXUINT;
     details->layout_timestamp = UNDEFINED_TIME;
 
     details->zoom_level = CAJA_ZOOM_LEVEL_STANDARD;
@@ -7072,10 +7527,18 @@ caja_icon_container_clear (CajaIconContainer *container)
     details->icons = NULL;
     g_list_free (details->new_icons);
     details->new_icons = NULL;
+    details->front_stack_order = 0;
 
     g_hash_table_destroy (details->icon_set);
     details->icon_set = g_hash_table_new (g_direct_hash, g_direct_equal);
 
+    caja_icon_spatial_index_clear (details->spatial_index);
+    g_list_free (details->visible_icons);
+    details->visible_icons = NULL;
+    g_list_free (details->near_icons);
+    details->near_icons = NULL;
+    invalidate_layout_rows (container);
+
     caja_icon_container_update_scroll_region (container);
 }
 
@@ -7292,6 +7755,15 @@ icon_destroy (CajaIconContainer *container,
     details->icons = g_list_remove (details->icons, icon);
     details->new_icons = g_list_remove (details->new_icons, icon);
     g_hash_table_remove (details->icon_set, icon->data);
+    caja_icon_spatial_index_remove (details->spatial_index, icon);
+    if (icon->is_visible)
+    {
+        details->visible_icons = g_list_remove (details->visible_icons, icon);
+    }
+    if (icon->is_near)
+    {
+        details->near_icons = g_list_remove (details->near_icons, icon);
+    }
 
     was_selected = icon->is_selected;
 
@@ -7494,6 +7966,73 @@ caja_icon_container_prioritize_thumbnailing (CajaIconContainer *container,
     klass->prioritize_thumbnailing (container, icon->data);
 }
 
+/* Sorts icons so the ones rendered last come first, so that after
+ * prioritizing them in this order the top-left one is thumbnailed first.
+ */
+static int
+compare_icons_reverse_render_order (gconstpointer a,
+                                    gconstpointer b,
+                                    gpointer user_data)
+{
+    const CajaIcon *icon_a, *icon_b;
+    gboolean vertical;
+
+    icon_a = a;
+    icon_b = b;
+    vertical = GPOINTER_TO_INT (user_data);
+
+    if (vertical ? icon_a->x != icon_b->x : icon_a->y != icon_b->y)
+    {
+        return vertical ? (icon_a->x < icon_b->x ? 1 : -1)
+               : (icon_a->y < icon_b->y ? 1 : -1);
+    }
+    if (icon_a->x != icon_b->x || icon_a->y != icon_b->y)
+    {
+        return vertical ? (icon_a->y < icon_b->y ? 1 : -1)
+               : (icon_a->x < icon_b->x ? 1 : -1);
+    }
+    return 0;
+}
+
+/* Gives the images back to the icons that came near the visible area
+ * and takes them from the ones that went away from it. */
+static void
+update_near_icons (CajaIconContainer *container,
+                   GList *near_icons)
+{
+    GList *node;
+    CajaIcon *icon = NULL;
+
+    for (node = container->details->near_icons; node != NULL; node = node->next)
+    {
+        icon = node->data;
+        icon->is_near = FALSE;
+    }
+
+    for (node = near_icons; node != NULL; node = node->next)
+    {
+        icon = node->data;
+        icon->is_near = TRUE;
+
+        if (caja_icon_canvas_item_is_image_released (icon->item))
+        {
+            caja_icon_container_update_icon (container, icon);
+        }
+    }
+
+    for (node = container->details->near_icons; node != NULL; node = node->next)
+    {
+        icon = node->data;
+        if (!icon->is_near)
+        {
+            caja_icon_canvas_item_release_image (icon->item);
+        }
+    }
+
+    g_list_free (container->details->near_icons);
+    container->details->near_icons = g_list_copy (near_icons);
+}
+
 static void
 caja_icon_container_update_visible_icons (CajaIconContainer *container)
 {
@@ -7501,9 +8040,10 @@ caja_icon_container_update_visible_icons (CajaIconContainer *container)
     double min_y, max_y;
     double min_x, max_x;
     double x0, y0, x1, y1;
-    GList *node;
-    gboolean visible;
+    GList *node, *candidates, *visible_icons;
+    gboolean visible, vertical;
     GtkAllocation allocation;
+    EelDRect area;
     CajaIcon *icon = NULL;
 
     hadj = gtk_scrollable_get_hadjustment (GTK_SCROLLABLE (container));
@@ -7521,48 +8061,94 @@ caja_icon_container_update_visible_icons (CajaIconContainer *container)
     eel_canvas_c2w (EEL_CANVAS (container),
                     max_x, max_y, &max_x, &max_y);
 
-    /* Do the iteration in reverse to get the render-order from top to
-     * bottom for the prioritized thumbnails.
+    /* Only the scrolling direction decides whether an icon is visible.
+     * The icons close to the visible ones are also looked at, they keep
+     * their images for when they are scrolled to.
      */
-    for (node = g_list_last (container->details->icons); node != NULL; node = node->prev)
+    vertical = caja_icon_container_is_layout_vertical (container);
+    if (vertical)
+    {
+        area.x0 = min_x - NEAR_VIEWPORTS * (max_x - min_x);
+        area.x1 = max_x + NEAR_VIEWPORTS * (max_x - min_x);
+        area.y0 = -G_MAXDOUBLE;
+        area.y1 = G_MAXDOUBLE;
+    }
+    else
+    {
+        area.x0 = -G_MAXDOUBLE;
+        area.x1 = G_MAXDOUBLE;
+        area.y0 = min_y - NEAR_VIEWPORTS * (max_y - min_y);
+        area.y1 = max_y + NEAR_VIEWPORTS * (max_y - min_y);
+    }
+
+    candidates = caja_icon_container_get_icons_in_area (container, &area);
+    update_near_icons (container, candidates);
+
+    visible_icons = NULL;
+    for (node = candidates; node != NULL; node = node->next)
     {
         icon = node->data;
 
-        if (icon_is_positioned (icon))
+        eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
+                                    &x0,
+                                    &y0,
+                                    &x1,
+                                    &y1);
+        eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
+                             &x0,
+                             &y0);
+        eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
+                             &x1,
+                             &y1);
+
+        if (vertical)
         {
-            eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
-                                        &x0,
-                                        &y0,
-                                        &x1,
-                                        &y1);
-            eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
-                                 &x0,
-                                 &y0);
-            eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
-                                 &x1,
-                                 &y1);
+            visible = x1 >= min_x && x0 <= max_x;
+        }
+        else
+        {
+            visible = y1 >= min_y && y0 <= max_y;
+        }
 
-            if (caja_icon_container_is_layout_vertical (container))
-            {
-                visible = x1 >= min_x && x0 <= max_x;
-            }
-            else
-            {
-                visible = y1 >= min_y && y0 <= max_y;
-            }
+        if (visible)
+        {
+            visible_icons = g_list_prepend (visible_icons, icon);
+        }
+    }
+    g_list_free (candidates);
 
-            if (visible)
-            {
-                caja_icon_canvas_item_set_is_visible (icon->item, TRUE);
-                caja_icon_container_prioritize_thumbnailing (container,
-                        icon);
-            }
-            else
-            {
-                caja_icon_canvas_item_set_is_visible (icon->item, FALSE);
-            }
+    /* Icons that were visible and no longer are must be the only ones
+     * left with is_visible cleared and the item still shown.
+     */
+    for (node = container->details->visible_icons; node != NULL; node = node->next)
+    {
+        icon = node->data;
+        icon->is_visible = FALSE;
+    }
+
+    visible_icons = g_list_sort_with_data (visible_icons,
+                                           compare_icons_reverse_render_order,
+                                           GINT_TO_POINTER (vertical));
+    for (node = visible_icons; node != NULL; node = node->next)
+    {
+        icon = node->data;
+        icon->is_visible = TRUE;
+        caja_icon_canvas_item_set_is_visible (icon->item, TRUE);
+        caja_icon_container_prioritize_thumbnailing (container,
+                icon);
+    }
+
+    for (node = container->details->visible_icons; node != NULL; node = node->next)
+    {
+        icon = node->data;
+        if (!icon->is_visible)
+        {
+            caja_icon_canvas_item_set_is_visible (icon->item, FALSE);
         }
     }
+
+    g_list_free (container->details->visible_icons);
+    container->details->visible_icons = visible_icons;
 }
 
 static void
@@ -7629,6 +8215,48 @@ caja_icon_container_update_icon (CajaIconContainer *container,
     icon_size = MAX (icon_size, min_image_size);
     icon_size = MIN (icon_size, max_image_size);
 
+    caja_icon_container_get_icon_text (container,
+                                       icon->data,
+                                       &editable_text,
+                                       &additional_text,
+                                       FALSE);
+
+    /* If name of icon being renamed was changed from elsewhere, end renaming mode.
+     * Alternatively, we could replace the characters in the editable text widget
+     * with the new name, but that could cause timing problems if the user just
+     * happened to be typing at that moment.
+     */
+    if (icon == get_icon_being_renamed (container) &&
+            g_strcmp0 (editable_text,
+                        caja_icon_canvas_item_get_editable_text (icon->item)) != 0)
+    {
+        end_renaming_mode (container, FALSE);
+    }
+
+    eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
+                         "editable_text", editable_text,
+                         "additional_text", additional_text,
+                         "highlighted_for_drop", icon == details->drop_target,
+                         NULL);
+
+    g_free (editable_text);
+    g_free (additional_text);
+
+    /* Icons away from the visible area are laid out at the size asked
+     * for, which no image is larger than. update_near_icons() loads
+     * the images once they come near. */
+    if (!icon->is_near)
+    {
+        int scale;
+
+        scale = gtk_widget_get_scale_factor (GTK_WIDGET (container));
+        caja_icon_canvas_item_set_released_image_size (icon->item,
+                icon_size * scale,
+                icon_size * scale);
+        icon_update_spatial_index (container, icon);
+        return;
+    }
+
     /* Get the icons. */
     emblem_pixbufs = NULL;
     embedded_text = NULL;
@@ -7654,30 +8282,6 @@ caja_icon_container_update_icon (CajaIconContainer *container,
         caja_icon_container_start_monitor_top_left (container, icon->data, icon, large_embedded_text);
     }
 
-    caja_icon_container_get_icon_text (container,
-                                       icon->data,
-                                       &editable_text,
-                                       &additional_text,
-                                       FALSE);
-
-    /* If name of icon being renamed was changed from elsewhere, end renaming mode.
-     * Alternatively, we could replace the characters in the editable text widget
-     * with the new name, but that could cause timing problems if the user just
-     * happened to be typing at that moment.
-     */
-    if (icon == get_icon_being_renamed (container) &&
-            g_strcmp0 (editable_text,
-                        caja_icon_canvas_item_get_editable_text (icon->item)) != 0)
-    {
-        end_renaming_mode (container, FALSE);
-    }
-
-    eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
-                         "editable_text", editable_text,
-                         "additional_text", additional_text,
-                         "highlighted_for_drop", icon == details->drop_target,
-                         NULL);
-
     caja_icon_canvas_item_set_image (icon->item, pixbuf);
     caja_icon_canvas_item_set_attach_points (icon->item, attach_points, n_attach_points);
     caja_icon_canvas_item_set_emblems (icon->item, emblem_pixbufs);
@@ -7688,10 +8292,9 @@ caja_icon_container_update_icon (CajaIconContainer *container,
     g_object_unref (pixbuf);
     g_list_free_full (emblem_pixbufs, g_object_unref);
 
-    g_free (editable_text);
-    g_free (additional_text);
-
     g_object_unref (icon_info);
+
+    icon_update_spatial_index (container, icon);
 }
 
 static gboolean
@@ -7923,11 +8526,13 @@ caja_icon_container_add (CajaIconContainer *container,
     /* Put it on both lists. */
     details->icons = g_list_prepend (details->icons, icon);
     details->new_icons = g_list_prepend (details->new_icons, icon);
+    icon->stack_order = --details->front_stack_order;
 
     g_hash_table_insert (details->icon_set, data, icon);
 
     /* Run an idle function to add the icons. */
-    schedule_redo_layout (container);
+    icon->needs_layout = TRUE;
+    schedule_incremental_layout (container);
 
     return TRUE;
 }
@@ -7959,6 +8564,8 @@ caja_icon_container_remove (CajaIconContainer *container,
                             CajaIconData *data)
 {
     CajaIcon *icon;
+    GList *p;
+    guint index;
 
     g_return_val_if_fail (CAJA_IS_ICON_CONTAINER (container), FALSE);
     g_return_val_if_fail (data != NULL, FALSE);
@@ -7974,8 +8581,23 @@ caja_icon_container_remove (CajaIconContainer *container,
 
     g_signal_emit (container, signals[ICON_REMOVED], 0, icon);
 
+    /* The icons after it move up. Icons not laid down yet have no
+     * row and don't count. */
+    if (icon->is_laid_out)
+    {
+        index = 0;
+        for (p = container->details->icons; p->data != icon; p = p->next)
+        {
+            if (((CajaIcon *) p->data)->is_laid_out)
+            {
+                index++;
+            }
+        }
+        set_layout_dirty_index (container, index);
+    }
+
     icon_destroy (container, icon);
-    schedule_redo_layout (container);
+    schedule_incremental_layout (container);
 
     return TRUE;
 }
@@ -8001,7 +8623,10 @@ caja_icon_container_request_update (CajaIconContainer *container,
     if (icon != NULL)
     {
         caja_icon_container_update_icon (container, icon);
-        schedule_redo_layout (container);
+
+        /* Its size or its place in the sort order may have changed */
+        icon->needs_layout = TRUE;
+        schedule_incremental_layout (container);
     }
 }
 
@@ -10205,6 +10830,15 @@ void
 caja_icon_container_end_loading (CajaIconContainer *container,
                                  gboolean               all_icons_added)
 {
+    if (all_icons_added)
+    {
+        char *statistics;
+
+        statistics = caja_icon_container_get_layout_statistics (container);
+        caja_debug_log (FALSE, CAJA_DEBUG_LOG_DOMAIN_ASYNC, "%s", statistics);
+        g_free (statistics);
+    }
+
     if (all_icons_added &&
             caja_icon_container_get_store_layout_timestamps (container))
     {
@@ -10219,6 +10853,34 @@ caja_icon_container_end_loading (CajaIconContainer *container,
     }
 }
 
+/**
+ * caja_icon_container_get_layout_statistics:
+ * @container: A CajaIconContainer
+ *
+ * Returns a description of how many times the icons were laid down,
+ * all of them or only the changed rows, and how long that took, for
+ * debugging.
+ *
+ * Return value: A newly allocated string.
+ **/
+char *
+caja_icon_container_get_layout_statistics (CajaIconContainer *container)
+{
+    CajaIconContainerDetails *details;
+
+    g_return_val_if_fail (CAJA_IS_ICON_CONTAINER (container), NULL);
+
+    details = container->details;
+
+    return g_strdup_printf ("icon layout: %u full in %.3f s, %u incremental in %.3f s, "
+                            "%" G_GUINT64_FORMAT " icons laid down",
+                            details->n_full_layouts,
+                            details->full_layout_time / (double) G_USEC_PER_SEC,
+                            details->n_incremental_layouts,
+                            details->incremental_layout_time / (double) G_USEC_PER_SEC,
+                            details->icons_laid_out);
+}
+
 gboolean
 caja_icon_container_get_store_layout_timestamps (CajaIconContainer *container)
 {
@@ -273,6 +273,7 @@ void              caja_icon_container_scroll_to_icon                (CajaIconCon
 void              caja_icon_container_begin_loading                 (CajaIconContainer  *container);
 void              caja_icon_container_end_loading                   (CajaIconContainer  *container,
         gboolean                all_icons_added);
+char *            caja_icon_container_get_layout_statistics         (CajaIconContainer  *container);
 
 /* control the layout */
 gboolean          caja_icon_container_is_auto_layout                (CajaIconContainer  *container);
@@ -560,7 +560,8 @@ static CajaIcon *
 caja_icon_container_item_at (CajaIconContainer *container,
                              int x, int y)
 {
-    GList *p;
+    GList *candidates, *p;
+    CajaIcon *hit;
     int size;
     EelDRect point;
     EelIRect canvas_point;
@@ -575,28 +576,39 @@ caja_icon_container_item_at (CajaIconContainer *container,
     point.x1 = x + size;
     point.y1 = y + size;
 
-    for (p = container->details->icons; p != NULL; p = p->next)
+    eel_canvas_w2c (EEL_CANVAS (container),
+                    point.x0,
+                    point.y0,
+                    &canvas_point.x0,
+                    &canvas_point.y0);
+    eel_canvas_w2c (EEL_CANVAS (container),
+                    point.x1,
+                    point.y1,
+                    &canvas_point.x1,
+                    &canvas_point.y1);
+
+    candidates = caja_icon_container_get_icons_in_area (container, &point);
+
+    hit = NULL;
+    for (p = candidates; p != NULL; p = p->next)
     {
         CajaIcon *icon;
         icon = p->data;
 
-        eel_canvas_w2c (EEL_CANVAS (container),
-                        point.x0,
-                        point.y0,
-                        &canvas_point.x0,
-                        &canvas_point.y0);
-        eel_canvas_w2c (EEL_CANVAS (container),
-                        point.x1,
-                        point.y1,
-                        &canvas_point.x1,
-                        &canvas_point.y1);
-        if (caja_icon_canvas_item_hit_test_rectangle (icon->item, canvas_point))
+        if (!caja_icon_canvas_item_hit_test_rectangle (icon->item, canvas_point))
+        {
+            continue;
+        }
+
+        /* Where icons overlap, the first one in the list wins */
+        if (hit == NULL || icon->stack_order < hit->stack_order)
         {
-            return icon;
+            hit = icon;
         }
     }
+    g_list_free (candidates);
 
-    return NULL;
+    return hit;
 }
 
 static char *
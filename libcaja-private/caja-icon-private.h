@@ -30,6 +30,7 @@
 #include "caja-icon-canvas-item.h"
 #include "caja-icon-container.h"
 #include "caja-icon-dnd.h"
+#include "caja-icon-spatial-index.h"
 
 /* An Icon. */
 
@@ -61,13 +62,27 @@ typedef struct
     /* Whether this item was selected before rubberbanding. */
     eel_boolean_bit was_selected_before_rubberband : 1;
 
-    /* Whether this item is visible in the view. */
+    /* Whether this item is visible in the view, i.e. in visible_icons. */
     eel_boolean_bit is_visible : 1;
 
+    /* Whether this item is close enough to the visible part of the view
+     * to keep its image, i.e. in near_icons. */
+    eel_boolean_bit is_near : 1;
+
     /* Whether a monitor was set on this icon. */
     eel_boolean_bit is_monitored : 1;
 
     eel_boolean_bit has_lazy_position : 1;
+
+    /* Whether the icon is new or changed since the last layout. */
+    eel_boolean_bit needs_layout : 1;
+
+    /* Whether the icon has a place in the rows of the last layout. */
+    eel_boolean_bit is_laid_out : 1;
+
+    /* Orders the icons as in the icons list, without walking it: where
+     * icons overlap, the lowest one is hit. */
+    int stack_order;
 } CajaIcon;
 
 /* Private CajaIconContainer members. */
@@ -130,6 +145,15 @@ struct CajaIconContainerDetails
     GList *icons;
     GList *new_icons;
     GHashTable *icon_set;
+    /* The stack order of the first icon, lowered as icons are
+     * prepended to the list */
+    int front_stack_order;
+
+    /* Positioned icons by the area they cover, the icons currently
+     * marked visible and the ones near enough to keep their images. */
+    CajaIconSpatialIndex *spatial_index;
+    GList *visible_icons;
+    GList *near_icons;
 
     /* Current icon for keyboard navigation. */
     CajaIcon *keyboard_focus;
@@ -192,6 +216,20 @@ struct CajaIconContainerDetails
     /* Idle ID. */
     guint idle_id;
 
+    /* The rows of the last horizontal auto layout, empty when the next
+     * layout has to start over. Changes after layout_dirty_index (a
+     * position in icons) only need the rows from there on redone. */
+    GArray *layout_rows;
+    double layout_width;
+    guint layout_dirty_index;
+
+    /* Layout statistics, see caja_icon_container_get_layout_statistics() */
+    guint n_full_layouts;
+    guint n_incremental_layouts;
+    gint64 full_layout_time;
+    gint64 incremental_layout_time;
+    guint64 icons_laid_out;
+
     /* Idle handler for stretch code */
     guint stretch_idle_id;
 
@@ -320,5 +358,7 @@ gboolean      caja_icon_container_scroll                      (CajaIconContainer
         int                    delta_x,
         int                    delta_y);
 void          caja_icon_container_update_scroll_region        (CajaIconContainer *container);
+GList *       caja_icon_container_get_icons_in_area           (CajaIconContainer *container,
+        const EelDRect        *area);
 
 #endif /* CAJA_ICON_CONTAINER_PRIVATE_H */
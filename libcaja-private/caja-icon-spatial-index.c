@@ -0,0 +1,323 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*-
+
+   caja-icon-spatial-index.c: finding the icons in an area of the icon container
+
+   Copyright (C) 2026 MATE developers
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include <config.h>
+#include <math.h>
+
+#include "caja-icon-spatial-index.h"
+
+typedef struct
+{
+    gpointer item;
+
+    /* The cells the item is listed in */
+    int cell_x0, cell_y0, cell_x1, cell_y1;
+
+    /* The query that last returned the item */
+    guint query_stamp;
+} SpatialEntry;
+
+typedef struct
+{
+    gint64 key;
+    GPtrArray *entries;
+} SpatialCell;
+
+struct CajaIconSpatialIndex
+{
+    double cell_size;
+
+    /* Maps items to their SpatialEntry */
+    GHashTable *entries;
+    /* Maps cell keys to SpatialCells */
+    GHashTable *cells;
+
+    /* The cells that have been used, to bound unbounded queries */
+    int min_cell_x, min_cell_y, max_cell_x, max_cell_y;
+
+    guint query_stamp;
+};
+
+static gint64
+cell_key (int x, int y)
+{
+    return (gint64) (((guint64) (guint32) x << 32) | (guint32) y);
+}
+
+static int
+cell_coordinate (CajaIconSpatialIndex *index, double value)
+{
+    return (int) floor (CLAMP (value / index->cell_size, G_MININT / 2, G_MAXINT / 2));
+}
+
+static void
+spatial_cell_free (gpointer data)
+{
+    SpatialCell *cell;
+
+    cell = data;
+    g_ptr_array_free (cell->entries, TRUE);
+    g_free (cell);
+}
+
+CajaIconSpatialIndex *
+caja_icon_spatial_index_new (double cell_size)
+{
+    CajaIconSpatialIndex *index;
+
+    g_return_val_if_fail (cell_size > 0, NULL);
+
+    index = g_new0 (CajaIconSpatialIndex, 1);
+    index->cell_size = cell_size;
+    index->entries = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+    index->cells = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+                                          NULL, spatial_cell_free);
+    index->min_cell_x = index->min_cell_y = G_MAXINT;
+    index->max_cell_x = index->max_cell_y = G_MININT;
+
+    return index;
+}
+
+void
+caja_icon_spatial_index_free (CajaIconSpatialIndex *index)
+{
+    if (index == NULL)
+    {
+        return;
+    }
+
+    g_hash_table_destroy (index->cells);
+    g_hash_table_destroy (index->entries);
+    g_free (index);
+}
+
+void
+caja_icon_spatial_index_clear (CajaIconSpatialIndex *index)
+{
+    g_hash_table_remove_all (index->cells);
+    g_hash_table_remove_all (index->entries);
+    index->min_cell_x = index->min_cell_y = G_MAXINT;
+    index->max_cell_x = index->max_cell_y = G_MININT;
+}
+
+static void
+unlist_entry (CajaIconSpatialIndex *index, SpatialEntry *entry)
+{
+    SpatialCell *cell;
+    gint64 key;
+    int x, y;
+
+    for (x = entry->cell_x0; x <= entry->cell_x1; x++)
+    {
+        for (y = entry->cell_y0; y <= entry->cell_y1; y++)
+        {
+            key = cell_key (x, y);
+            cell = g_hash_table_lookup (index->cells, &key);
+            if (cell == NULL)
+            {
+                continue;
+            }
+
+            g_ptr_array_remove_fast (cell->entries, entry);
+            if (cell->entries->len == 0)
+            {
+                g_hash_table_remove (index->cells, &key);
+            }
+        }
+    }
+}
+
+static void
+list_entry (CajaIconSpatialIndex *index, SpatialEntry *entry)
+{
+    SpatialCell *cell;
+    gint64 key;
+    int x, y;
+
+    for (x = entry->cell_x0; x <= entry->cell_x1; x++)
+    {
+        for (y = entry->cell_y0; y <= entry->cell_y1; y++)
+        {
+            key = cell_key (x, y);
+            cell = g_hash_table_lookup (index->cells, &key);
+            if (cell == NULL)
+            {
+                cell = g_new (SpatialCell, 1);
+                cell->key = key;
+                cell->entries = g_ptr_array_new ();
+                g_hash_table_insert (index->cells, &cell->key, cell);
+            }
+
+            g_ptr_array_add (cell->entries, entry);
+        }
+    }
+
+    index->min_cell_x = MIN (index->min_cell_x, entry->cell_x0);
+    index->min_cell_y = MIN (index->min_cell_y, entry->cell_y0);
+    index->max_cell_x = MAX (index->max_cell_x, entry->cell_x1);
+    index->max_cell_y = MAX (index->max_cell_y, entry->cell_y1);
+}
+
+void
+caja_icon_spatial_index_set (CajaIconSpatialIndex *index,
+                             gpointer item,
+                             const EelDRect *bounds)
+{
+    SpatialEntry *entry;
+    int cell_x0, cell_y0, cell_x1, cell_y1;
+
+    cell_x0 = cell_coordinate (index, MIN (bounds->x0, bounds->x1));
+    cell_y0 = cell_coordinate (index, MIN (bounds->y0, bounds->y1));
+    cell_x1 = cell_coordinate (index, MAX (bounds->x0, bounds->x1));
+    cell_y1 = cell_coordinate (index, MAX (bounds->y0, bounds->y1));
+
+    entry = g_hash_table_lookup (index->entries, item);
+    if (entry == NULL)
+    {
+        entry = g_new0 (SpatialEntry, 1);
+        entry->item = item;
+        g_hash_table_insert (index->entries, item, entry);
+    }
+    else if (entry->cell_x0 == cell_x0 && entry->cell_y0 == cell_y0 &&
+             entry->cell_x1 == cell_x1 && entry->cell_y1 == cell_y1)
+    {
+        return;
+    }
+    else
+    {
+        unlist_entry (index, entry);
+    }
+
+    entry->cell_x0 = cell_x0;
+    entry->cell_y0 = cell_y0;
+    entry->cell_x1 = cell_x1;
+    entry->cell_y1 = cell_y1;
+    list_entry (index, entry);
+}
+
+void
+caja_icon_spatial_index_remove (CajaIconSpatialIndex *index,
+                                gpointer item)
+{
+    SpatialEntry *entry;
+
+    entry = g_hash_table_lookup (index->entries, item);
+    if (entry == NULL)
+    {
+        return;
+    }
+
+    unlist_entry (index, entry);
+    g_hash_table_remove (index->entries, item);
+}
+
+static GList *
+add_cell_items (CajaIconSpatialIndex *index, SpatialCell *cell, GList *items)
+{
+    SpatialEntry *entry;
+    guint i;
+
+    for (i = 0; i < cell->entries->len; i++)
+    {
+        entry = g_ptr_array_index (cell->entries, i);
+        if (entry->query_stamp != index->query_stamp)
+        {
+            entry->query_stamp = index->query_stamp;
+            items = g_list_prepend (items, entry->item);
+        }
+    }
+
+    return items;
+}
+
+GList *
+caja_icon_spatial_index_query (CajaIconSpatialIndex *index,
+                               const EelDRect *area)
+{
+    SpatialCell *cell;
+    GList *items;
+    gint64 key;
+    int cell_x0, cell_y0, cell_x1, cell_y1;
+    int x, y;
+
+    if (g_hash_table_size (index->entries) == 0)
+    {
+        return NULL;
+    }
+
+    /* Areas can extend far past the icons on one axis, only look
+     * at cells that were ever used */
+    cell_x0 = MAX (cell_coordinate (index, MIN (area->x0, area->x1)), index->min_cell_x);
+    cell_y0 = MAX (cell_coordinate (index, MIN (area->y0, area->y1)), index->min_cell_y);
+    cell_x1 = MIN (cell_coordinate (index, MAX (area->x0, area->x1)), index->max_cell_x);
+    cell_y1 = MIN (cell_coordinate (index, MAX (area->y0, area->y1)), index->max_cell_y);
+
+    if (cell_x0 > cell_x1 || cell_y0 > cell_y1)
+    {
+        return NULL;
+    }
+
+    index->query_stamp++;
+    items = NULL;
+
+    /* With icons spread far apart most cells of the area are empty,
+     * then it is cheaper to go through the cells there are */
+    if ((gint64) (cell_x1 - cell_x0 + 1) * (cell_y1 - cell_y0 + 1) >
+            g_hash_table_size (index->cells))
+    {
+        GHashTableIter iter;
+
+        g_hash_table_iter_init (&iter, index->cells);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &cell))
+        {
+            x = (int) (gint32) ((guint64) cell->key >> 32);
+            y = (int) (gint32) (cell->key & 0xffffffff);
+            if (x >= cell_x0 && x <= cell_x1 && y >= cell_y0 && y <= cell_y1)
+            {
+                items = add_cell_items (index, cell, items);
+            }
+        }
+
+        return items;
+    }
+
+    for (x = cell_x0; x <= cell_x1; x++)
+    {
+        for (y = cell_y0; y <= cell_y1; y++)
+        {
+            key = cell_key (x, y);
+            cell = g_hash_table_lookup (index->cells, &key);
+            if (cell != NULL)
+            {
+                items = add_cell_items (index, cell, items);
+            }
+        }
+    }
+
+    return items;
+}
+
+guint
+caja_icon_spatial_index_size (CajaIconSpatialIndex *index)
+{
+    return g_hash_table_size (index->entries);
+}
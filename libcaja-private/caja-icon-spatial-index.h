@@ -0,0 +1,53 @@
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4; tab-width: 4 -*-
+
+   caja-icon-spatial-index.h: finding the icons in an area of the icon container
+
+   Copyright (C) 2026 MATE developers
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CAJA_ICON_SPATIAL_INDEX_H
+#define CAJA_ICON_SPATIAL_INDEX_H
+
+#include <glib.h>
+#include <eel/eel-art-extensions.h>
+
+/* A uniform grid of cells, each listing the items whose bounds overlap
+ * it, so that the items in an area can be found without looking at
+ * all of them. Bounds are in world coordinates.
+ */
+typedef struct CajaIconSpatialIndex CajaIconSpatialIndex;
+
+CajaIconSpatialIndex *caja_icon_spatial_index_new    (double                cell_size);
+void                  caja_icon_spatial_index_free   (CajaIconSpatialIndex *index);
+void                  caja_icon_spatial_index_clear  (CajaIconSpatialIndex *index);
+
+/* Adds the item, or moves it if it is already in the index */
+void                  caja_icon_spatial_index_set    (CajaIconSpatialIndex *index,
+                                                      gpointer              item,
+                                                      const EelDRect       *bounds);
+void                  caja_icon_spatial_index_remove (CajaIconSpatialIndex *index,
+                                                      gpointer              item);
+
+/* Returns the items whose bounds may intersect the area. Each item is
+ * listed once; the order is unspecified. Free the list with g_list_free().
+ */
+GList *               caja_icon_spatial_index_query  (CajaIconSpatialIndex *index,
+                                                      const EelDRect       *area);
+guint                 caja_icon_spatial_index_size   (CajaIconSpatialIndex *index);
+
+#endif /* CAJA_ICON_SPATIAL_INDEX_H */
@@ -28,6 +28,7 @@
 #include "caja-monitor.h"
 #include "caja-file-changes-queue.h"
 #include "caja-file-utilities.h"
+#include "caja-global-preferences.h"
 
 #include <gio/gio.h>
 
@@ -37,8 +38,77 @@ struct CajaMonitor
     GVolumeMonitor *volume_monitor;
     GMount *mount;
     GFile *location;
+
+    /* Events collected for batch_latency milliseconds before they
+     * are all handled at once, oldest first. */
+    guint batch_latency;
+    GQueue batched_events;
+    guint batch_timeout_id;
 };
 
+typedef struct
+{
+    GFile *child;
+    GFileMonitorEvent event_type;
+} MonitorEvent;
+
+typedef struct
+{
+    CajaMonitorCallback callback;
+    gpointer callback_data;
+} MonitorCallback;
+
+static GList *monitor_callbacks = NULL;
+
+void
+caja_monitor_add_callback (CajaMonitorCallback callback,
+                           gpointer callback_data)
+{
+    MonitorCallback *monitor_callback;
+
+    monitor_callback = g_new (MonitorCallback, 1);
+    monitor_callback->callback = callback;
+    monitor_callback->callback_data = callback_data;
+
+    monitor_callbacks = g_list_append (monitor_callbacks, monitor_callback);
+}
+
+void
+caja_monitor_remove_callback (CajaMonitorCallback callback,
+                              gpointer callback_data)
+{
+    GList *l;
+
+    for (l = monitor_callbacks; l != NULL; l = l->next)
+    {
+        MonitorCallback *monitor_callback = l->data;
+
+        if (monitor_callback->callback == callback &&
+            monitor_callback->callback_data == callback_data)
+        {
+            monitor_callbacks = g_list_delete_link (monitor_callbacks, l);
+            g_free (monitor_callback);
+            return;
+        }
+    }
+}
+
+static void
+call_monitor_callbacks (GFile *file,
+                        GFileMonitorEvent event_type)
+{
+    GList *l, *next;
+
+    for (l = monitor_callbacks; l != NULL; l = next)
+    {
+        MonitorCallback *monitor_callback = l->data;
+
+        next = l->next;
+        (* monitor_callback->callback) (file, event_type,
+                                        monitor_callback->callback_data);
+    }
+}
+
 gboolean
 caja_monitor_active (void)
 {
@@ -98,21 +168,9 @@ mount_removed (GVolumeMonitor *volume_monitor,
 }
 
 static void
-dir_changed (GFileMonitor* monitor,
-             GFile *child,
-             GFile *other_file,
-             GFileMonitorEvent event_type,
-             gpointer user_data)
+queue_event (GFile *child,
+             GFileMonitorEvent event_type)
 {
-    char *uri, *to_uri;
-
-    uri = g_file_get_uri (child);
-    to_uri = NULL;
-    if (other_file)
-    {
-        to_uri = g_file_get_uri (other_file);
-    }
-
     switch (event_type)
     {
     default:
@@ -138,9 +196,68 @@ dir_changed (GFileMonitor* monitor,
         break;
     }
 
-    g_free (uri);
-    g_free (to_uri);
-    schedule_call_consume_changes ();
+    call_monitor_callbacks (child, event_type);
+}
+
+static void
+monitor_event_free (MonitorEvent *event)
+{
+    g_object_unref (event->child);
+    g_free (event);
+}
+
+static gboolean
+batch_timeout_callback (gpointer callback_data)
+{
+    CajaMonitor *monitor;
+    MonitorEvent *event;
+
+    monitor = callback_data;
+    monitor->batch_timeout_id = 0;
+
+    while ((event = g_queue_pop_head (&monitor->batched_events)) != NULL)
+    {
+        queue_event (event->child, event->event_type);
+        monitor_event_free (event);
+    }
+
+    /* One go for everything that happened in the directory since
+     * the last time */
+    caja_file_changes_consume_changes (TRUE);
+
+    return FALSE;
+}
+
+static void
+dir_changed (GFileMonitor* file_monitor,
+             GFile *child,
+             GFile *other_file,
+             GFileMonitorEvent event_type,
+             gpointer user_data)
+{
+    CajaMonitor *monitor;
+    MonitorEvent *event;
+
+    monitor = user_data;
+
+    if (monitor->batch_latency == 0)
+    {
+        queue_event (child, event_type);
+        schedule_call_consume_changes ();
+        return;
+    }
+
+    event = g_new (MonitorEvent, 1);
+    event->child = g_object_ref (child);
+    event->event_type = event_type;
+    g_queue_push_tail (&monitor->batched_events, event);
+
+    if (monitor->batch_timeout_id == 0)
+    {
+        monitor->batch_timeout_id = g_timeout_add (monitor->batch_latency,
+                                    batch_timeout_callback,
+                                    monitor);
+    }
 }
 
 CajaMonitor *
@@ -154,6 +271,13 @@ caja_monitor_directory (GFile *location)
 
     if (dir_monitor != NULL) {
         ret->monitor = dir_monitor;
+
+        ret->batch_latency = MAX (g_settings_get_int (caja_preferences,
+                                                      CAJA_PREFERENCES_MONITOR_BATCH_LATENCY), 0);
+        if (ret->batch_latency > 0) {
+            /* No point in changed events more often than they are handled */
+            g_file_monitor_set_rate_limit (dir_monitor, ret->batch_latency);
+        }
     }
     /*This caused a crash on umounting remote shares
     else if (!g_file_is_native (location)) {
@@ -167,10 +291,6 @@ caja_monitor_directory (GFile *location)
                   G_CALLBACK (dir_changed), ret);
     }
 
-    if (ret->monitor) {
-        g_signal_connect (ret->monitor, "changed", (GCallback)dir_changed, ret);
-    }
-
     if (ret->volume_monitor != NULL) {
         g_signal_connect (ret->volume_monitor, "mount-removed",
                     G_CALLBACK (mount_removed), ret);
@@ -190,6 +310,15 @@ caja_monitor_cancel (CajaMonitor *monitor)
         g_object_unref (monitor->monitor);
     }
 
+    if (monitor->batch_timeout_id != 0)
+    {
+        g_source_remove (monitor->batch_timeout_id);
+    }
+    while (!g_queue_is_empty (&monitor->batched_events))
+    {
+        monitor_event_free (g_queue_pop_head (&monitor->batched_events));
+    }
+
     if (monitor->volume_monitor != NULL) {
         g_signal_handlers_disconnect_by_func (monitor->volume_monitor, mount_removed, monitor);
         g_object_unref (monitor->volume_monitor);
@@ -31,8 +31,19 @@
 
 typedef struct CajaMonitor CajaMonitor;
 
+typedef void (* CajaMonitorCallback) (GFile             *file,
+                                      GFileMonitorEvent  event_type,
+                                      gpointer           callback_data);
+
 gboolean         caja_monitor_active    (void);
 CajaMonitor *caja_monitor_directory (GFile *location);
 void             caja_monitor_cancel    (CajaMonitor *monitor);
 
+/* Observe every change reported by the directory monitors, e.g. to keep
+ * a cache outside of CajaDirectory in sync. */
+void             caja_monitor_add_callback    (CajaMonitorCallback callback,
+                                               gpointer            callback_data);
+void             caja_monitor_remove_callback (CajaMonitorCallback callback,
+                                               gpointer            callback_data);
+
 #endif /* CAJA_MONITOR_H */
@@ -0,0 +1,1493 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Copyright (C) 2026 MATE developers
+ *
+ * Caja is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * Caja is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; see the file COPYING.  If not,
+ * write to the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ */
+
+/* A local filename index used when neither Tracker nor Beagle are
+ * available. For every folder listed in the search-index-roots preference
+ * the whole tree is crawled once in a thread and written to a cache file,
+ * which is then memory mapped and scanned linearly by searches.
+ *
+ * Changes seen by the directory monitors of open folders are recorded in
+ * an in-memory journal that overrides the mapped records, and the index
+ * is rebuilt in the background when it gets old or the journal gets big.
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <eel/eel-gtk-macros.h>
+
+#include "caja-search-engine-index.h"
+#include "caja-search-engine-simple.h"
+#include "caja-search-matcher.h"
+#include "caja-global-preferences.h"
+#include "caja-monitor.h"
+
+#define BATCH_SIZE 500
+
+/* Rebuild the index in the background when it is older than this */
+#define INDEX_MAX_AGE (6 * G_TIME_SPAN_HOUR)
+
+/* Don't retry a failed or recent build more often than this */
+#define INDEX_MIN_BUILD_INTERVAL (10 * G_TIME_SPAN_MINUTE)
+
+/* Rebuild the index when the journal holds more changes than this */
+#define JOURNAL_MAX_ENTRIES 10000
+
+#define INDEX_MAGIC "CAJAIDX"
+#define INDEX_VERSION 1
+
+#define INDEX_NO_PARENT G_MAXUINT32
+
+#define G_FILE_ATTRIBUTE_XATTR_XDG_TAGS "xattr::xdg.tags"
+
+#define INDEX_ATTRIBUTES \
+	G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," \
+	G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+	G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE "," \
+	G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+	G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+	G_FILE_ATTRIBUTE_ID_FILE "," \
+	G_FILE_ATTRIBUTE_XATTR_XDG_TAGS
+
+typedef enum
+{
+    INDEX_FLAG_DIRECTORY = 1 << 0,
+    /* The file is hidden or lives below a hidden folder */
+    INDEX_FLAG_HIDDEN = 1 << 1,
+    /* Journal only: the file was removed */
+    INDEX_FLAG_DELETED = 1 << 2
+} IndexFlags;
+
+/* On-disk layout, in host byte order:
+ *
+ *   IndexHeader
+ *   IndexRecord[n_records]   records of a folder come after the folder
+ *   string pool              NUL terminated strings, offset 0 is ""
+ */
+typedef struct
+{
+    char magic[8];
+    guint32 version;
+    guint32 n_records;
+    gint64 build_time;
+    guint64 pool_offset;
+    guint64 pool_size;
+} IndexHeader;
+
+typedef struct
+{
+    guint32 parent;     /* record index of the folder, or INDEX_NO_PARENT */
+    guint32 path;       /* path relative to the root */
+    guint32 name;       /* display name, normalized and lowercased */
+    guint32 mime;
+    guint32 tags;       /* lowercased, comma separated */
+    guint32 flags;
+    gint64 mtime;
+    gint64 size;
+} IndexRecord;
+
+typedef struct
+{
+    char *path;
+    char *name;
+    char *mime;
+    char *tags;
+    gint64 mtime;
+    gint64 size;
+    guint32 flags;
+    gint64 time;        /* when the change was recorded */
+} IndexJournalEntry;
+
+typedef struct
+{
+    int ref_count;
+
+    GFile *root;
+    char *index_path;
+
+    GMappedFile *mapped;        /* NULL until an index was loaded */
+    GHashTable *journal;        /* relative path -> IndexJournalEntry */
+
+    GCancellable *build_cancellable;
+    gboolean is_building;
+    gint64 last_build_start;
+} CajaSearchIndex;
+
+typedef struct
+{
+    CajaSearchEngineIndex *engine;
+    GCancellable *cancellable;
+
+    GMappedFile *mapped;
+    GFile *root;
+    char *prefix;               /* query location relative to root, or NULL */
+    GPtrArray *journal;         /* IndexJournalEntry, copied */
+    GHashTable *journal_paths;  /* path -> IndexJournalEntry, in journal */
+
+    CajaSearchMatcher *matcher;
+    GList *tags;
+    gint64 timestamp;
+    gint64 size;
+    gboolean search_hidden_files;
+
+    gint n_processed_files;
+    GList *uri_hits;
+} IndexQueryData;
+
+struct CajaSearchEngineIndexDetails
+{
+    CajaQuery *query;
+
+    IndexQueryData *active_search;
+    CajaSearchEngine *fallback;
+
+    gboolean show_hidden_files;
+};
+
+G_DEFINE_TYPE (CajaSearchEngineIndex,
+               caja_search_engine_index,
+               CAJA_TYPE_SEARCH_ENGINE);
+
+static CajaSearchEngineClass *parent_class = NULL;
+
+static GList *search_indexes = NULL;
+static gboolean search_indexes_initialized = FALSE;
+
+static void search_index_start_build (CajaSearchIndex *index);
+
+/* String helpers, shared by the builder and the journal */
+
+/* GIO escapes non-printable bytes in xattr values as \xNN */
+static char *
+fold_tags (const char *escaped)
+{
+    GString *unescaped;
+    const char *p;
+    char *result;
+
+    if (escaped == NULL || escaped[0] == '\0')
+    {
+        return NULL;
+    }
+
+    unescaped = g_string_sized_new (strlen (escaped));
+    for (p = escaped; *p != '\0'; p++)
+    {
+        if (p[0] == '\\' && p[1] == 'x' &&
+            g_ascii_isxdigit (p[2]) && g_ascii_isxdigit (p[3]))
+        {
+            g_string_append_c (unescaped,
+                               (g_ascii_xdigit_value (p[2]) << 4) |
+                               g_ascii_xdigit_value (p[3]));
+            p += 3;
+        }
+        else
+        {
+            g_string_append_c (unescaped, *p);
+        }
+    }
+
+    result = caja_search_matcher_fold (unescaped->str);
+    g_string_free (unescaped, TRUE);
+
+    return result;
+}
+
+static gboolean
+path_has_hidden_component (const char *path)
+{
+    const char *p;
+
+    for (p = path; p != NULL; p = strchr (p, '/'))
+    {
+        if (*p == '/')
+        {
+            p++;
+        }
+        if (*p == '.')
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void
+index_journal_entry_free (IndexJournalEntry *entry)
+{
+    g_free (entry->path);
+    g_free (entry->name);
+    g_free (entry->mime);
+    g_free (entry->tags);
+    g_free (entry);
+}
+
+static IndexJournalEntry *
+index_journal_entry_copy (IndexJournalEntry *entry)
+{
+    IndexJournalEntry *copy;
+
+    copy = g_new (IndexJournalEntry, 1);
+    *copy = *entry;
+    copy->path = g_strdup (entry->path);
+    copy->name = g_strdup (entry->name);
+    copy->mime = g_strdup (entry->mime);
+    copy->tags = g_strdup (entry->tags);
+
+    return copy;
+}
+
+/* Mapped index access */
+
+static const IndexHeader *
+index_get_header (GMappedFile *mapped)
+{
+    return (const IndexHeader *) g_mapped_file_get_contents (mapped);
+}
+
+static const IndexRecord *
+index_get_records (GMappedFile *mapped)
+{
+    return (const IndexRecord *) (g_mapped_file_get_contents (mapped) + sizeof (IndexHeader));
+}
+
+static const char *
+index_get_string (GMappedFile *mapped, guint32 offset)
+{
+    const IndexHeader *header;
+
+    header = index_get_header (mapped);
+    if (offset >= header->pool_size)
+    {
+        return "";
+    }
+
+    return g_mapped_file_get_contents (mapped) + header->pool_offset + offset;
+}
+
+static gboolean
+index_is_valid (GMappedFile *mapped)
+{
+    const IndexHeader *header;
+    const char *contents;
+    gsize length;
+
+    length = g_mapped_file_get_length (mapped);
+    if (length < sizeof (IndexHeader))
+    {
+        return FALSE;
+    }
+
+    contents = g_mapped_file_get_contents (mapped);
+    header = (const IndexHeader *) contents;
+
+    return memcmp (header->magic, INDEX_MAGIC, sizeof (INDEX_MAGIC)) == 0 &&
+           header->version == INDEX_VERSION &&
+           header->pool_offset >= sizeof (IndexHeader) +
+                                  (guint64) header->n_records * sizeof (IndexRecord) &&
+           header->pool_size > 0 &&
+           header->pool_offset + header->pool_size == length &&
+           contents[length - 1] == '\0';
+}
+
+static GMappedFile *
+index_load (const char *index_path)
+{
+    GMappedFile *mapped;
+
+    mapped = g_mapped_file_new (index_path, FALSE, NULL);
+    if (mapped == NULL)
+    {
+        return NULL;
+    }
+
+    if (!index_is_valid (mapped))
+    {
+        g_mapped_file_unref (mapped);
+        return NULL;
+    }
+
+    return mapped;
+}
+
+/* Building the index */
+
+typedef struct
+{
+    CajaSearchIndex *index;
+    GFile *root;
+    char *index_path;
+    GCancellable *cancellable;
+    gint64 start_time;
+    gboolean success;
+} IndexBuildData;
+
+typedef struct
+{
+    GFile *dir;
+    char *path;
+    guint32 record;
+    gboolean hidden;
+} IndexBuildDir;
+
+static guint32
+pool_add (GString *pool, const char *str)
+{
+    guint32 offset;
+
+    if (str == NULL || str[0] == '\0')
+    {
+        return 0;
+    }
+
+    offset = pool->len;
+    g_string_append_len (pool, str, strlen (str) + 1);
+
+    return offset;
+}
+
+static void
+index_build_dir_free (IndexBuildDir *build_dir)
+{
+    g_object_unref (build_dir->dir);
+    g_free (build_dir->path);
+    g_free (build_dir);
+}
+
+static void
+index_build_visit_directory (IndexBuildData *data,
+                             IndexBuildDir *build_dir,
+                             GArray *records,
+                             GString *pool,
+                             GHashTable *visited,
+                             GQueue *queue)
+{
+    GFileEnumerator *enumerator;
+    GFileInfo *info;
+
+    enumerator = g_file_enumerate_children (build_dir->dir, INDEX_ATTRIBUTES,
+                                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                            data->cancellable, NULL);
+    if (enumerator == NULL)
+    {
+        return;
+    }
+
+    while ((info = g_file_enumerator_next_file (enumerator, data->cancellable, NULL)) != NULL)
+    {
+        IndexRecord record = { 0 };
+        const char *name, *display_name, *id;
+        char *path, *folded;
+        gboolean hidden;
+
+        name = g_file_info_get_name (info);
+        display_name = g_file_info_get_display_name (info);
+        if (name == NULL || display_name == NULL)
+        {
+            g_object_unref (info);
+            continue;
+        }
+
+        if (build_dir->path[0] == '\0')
+        {
+            path = g_strdup (name);
+        }
+        else
+        {
+            path = g_build_filename (build_dir->path, name, NULL);
+        }
+
+        hidden = build_dir->hidden || g_file_info_get_is_hidden (info);
+
+        record.parent = build_dir->record;
+        record.path = pool_add (pool, path);
+        folded = caja_search_matcher_fold (display_name);
+        record.name = pool_add (pool, folded);
+        g_free (folded);
+        record.mime = pool_add (pool, g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE));
+        folded = fold_tags (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_XATTR_XDG_TAGS));
+        record.tags = pool_add (pool, folded);
+        g_free (folded);
+        record.mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+        record.size = g_file_info_get_size (info);
+        record.flags = hidden ? INDEX_FLAG_HIDDEN : 0;
+
+        if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+        {
+            record.flags |= INDEX_FLAG_DIRECTORY;
+
+            id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
+            if (id == NULL || !g_hash_table_contains (visited, id))
+            {
+                IndexBuildDir *child;
+
+                if (id != NULL)
+                {
+                    g_hash_table_add (visited, g_strdup (id));
+                }
+
+                child = g_new0 (IndexBuildDir, 1);
+                child->dir = g_file_get_child (build_dir->dir, name);
+                child->path = path;
+                child->record = records->len;
+                child->hidden = hidden;
+                g_queue_push_tail (queue, child);
+                path = NULL;
+            }
+        }
+
+        g_array_append_val (records, record);
+
+        g_free (path);
+        g_object_unref (info);
+    }
+
+    g_object_unref (enumerator);
+}
+
+static gboolean
+index_build_write (IndexBuildData *data,
+                   GArray *records,
+                   GString *pool)
+{
+    IndexHeader header = { { 0 } };
+    GFile *file, *parent;
+    GFileOutputStream *stream;
+    gboolean success;
+
+    memcpy (header.magic, INDEX_MAGIC, sizeof (INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.n_records = records->len;
+    header.build_time = data->start_time;
+    header.pool_offset = sizeof (IndexHeader) + (guint64) records->len * sizeof (IndexRecord);
+    header.pool_size = pool->len;
+
+    file = g_file_new_for_path (data->index_path);
+    parent = g_file_get_parent (file);
+    g_file_make_directory_with_parents (parent, NULL, NULL);
+    g_object_unref (parent);
+
+    stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_PRIVATE,
+                             data->cancellable, NULL);
+    g_object_unref (file);
+    if (stream == NULL)
+    {
+        return FALSE;
+    }
+
+    success =
+        g_output_stream_write_all (G_OUTPUT_STREAM (stream), &header, sizeof (header),
+                                   NULL, data->cancellable, NULL) &&
+        g_output_stream_write_all (G_OUTPUT_STREAM (stream), records->data,
+                                   (gsize) records->len * sizeof (IndexRecord),
+                                   NULL, data->cancellable, NULL) &&
+        g_output_stream_write_all (G_OUTPUT_STREAM (stream), pool->str, pool->len,
+                                   NULL, data->cancellable, NULL);
+
+    /* Closing a cancelled replace stream leaves the old index in place */
+    if (!success)
+    {
+        g_cancellable_cancel (data->cancellable);
+    }
+    success = g_output_stream_close (G_OUTPUT_STREAM (stream), data->cancellable, NULL) && success;
+    g_object_unref (stream);
+
+    return success;
+}
+
+static void search_index_unref (CajaSearchIndex *index);
+
+static gboolean
+journal_entry_is_older (gpointer key,
+                        gpointer value,
+                        gpointer user_data)
+{
+    IndexJournalEntry *entry = value;
+    gint64 *time = user_data;
+
+    return entry->time < *time;
+}
+
+static void
+index_build_data_free (IndexBuildData *data)
+{
+    g_object_unref (data->root);
+    g_free (data->index_path);
+    g_object_unref (data->cancellable);
+    g_free (data);
+}
+
+static gboolean
+index_build_done_idle (gpointer user_data)
+{
+    IndexBuildData *data;
+    CajaSearchIndex *index;
+
+    data = user_data;
+    index = data->index;
+
+    index->is_building = FALSE;
+    g_clear_object (&index->build_cancellable);
+
+    if (data->success)
+    {
+        GMappedFile *mapped;
+
+        mapped = index_load (data->index_path);
+        if (mapped != NULL)
+        {
+            if (index->mapped != NULL)
+            {
+                g_mapped_file_unref (index->mapped);
+            }
+            index->mapped = mapped;
+
+            /* Everything recorded before the crawl started is in the index now */
+            g_hash_table_foreach_remove (index->journal,
+                                         journal_entry_is_older,
+                                         &data->start_time);
+        }
+    }
+
+    search_index_unref (index);
+    index_build_data_free (data);
+
+    return FALSE;
+}
+
+static gpointer
+index_build_thread_func (gpointer user_data)
+{
+    IndexBuildData *data;
+    GArray *records;
+    GString *pool;
+    GHashTable *visited;
+    GQueue *queue;
+    IndexBuildDir *build_dir;
+
+    data = user_data;
+
+    records = g_array_new (FALSE, FALSE, sizeof (IndexRecord));
+    pool = g_string_new (NULL);
+    g_string_append_c (pool, '\0');
+    visited = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    queue = g_queue_new ();
+
+    build_dir = g_new0 (IndexBuildDir, 1);
+    build_dir->dir = g_object_ref (data->root);
+    build_dir->path = g_strdup ("");
+    build_dir->record = INDEX_NO_PARENT;
+    g_queue_push_tail (queue, build_dir);
+
+    while (!g_cancellable_is_cancelled (data->cancellable) &&
+            (build_dir = g_queue_pop_head (queue)) != NULL)
+    {
+        index_build_visit_directory (data, build_dir, records, pool, visited, queue);
+        index_build_dir_free (build_dir);
+
+        /* Offsets into the pool are 32 bit */
+        if (pool->len > G_MAXUINT32 - 4096 || records->len >= INDEX_NO_PARENT)
+        {
+            g_warning ("Search index for too many files, giving up");
+            g_cancellable_cancel (data->cancellable);
+        }
+    }
+
+    if (!g_cancellable_is_cancelled (data->cancellable))
+    {
+        data->success = index_build_write (data, records, pool);
+    }
+
+    g_queue_free_full (queue, (GDestroyNotify) index_build_dir_free);
+    g_hash_table_destroy (visited);
+    g_string_free (pool, TRUE);
+    g_array_free (records, TRUE);
+
+    g_idle_add (index_build_done_idle, data);
+
+    return NULL;
+}
+
+static void
+search_index_start_build (CajaSearchIndex *index)
+{
+    IndexBuildData *data;
+    GThread *thread;
+
+    if (index->is_building)
+    {
+        return;
+    }
+
+    index->is_building = TRUE;
+    index->build_cancellable = g_cancellable_new ();
+    index->ref_count++;
+
+    data = g_new0 (IndexBuildData, 1);
+    data->index = index;
+    data->root = g_object_ref (index->root);
+    data->index_path = g_strdup (index->index_path);
+    data->cancellable = g_object_ref (index->build_cancellable);
+    data->start_time = g_get_real_time ();
+    index->last_build_start = data->start_time;
+
+    thread = g_thread_new ("caja-search-index-build", index_build_thread_func, data);
+    g_thread_unref (thread);
+}
+
+static void
+search_index_ensure_fresh (CajaSearchIndex *index)
+{
+    if (index->last_build_start != 0 &&
+        g_get_real_time () - index->last_build_start < INDEX_MIN_BUILD_INTERVAL)
+    {
+        return;
+    }
+
+    if (index->mapped == NULL ||
+        g_hash_table_size (index->journal) > JOURNAL_MAX_ENTRIES ||
+        g_get_real_time () - index_get_header (index->mapped)->build_time > INDEX_MAX_AGE)
+    {
+        search_index_start_build (index);
+    }
+}
+
+/* Index registry */
+
+static CajaSearchIndex *
+search_index_new (const char *root_path_or_uri)
+{
+    CajaSearchIndex *index;
+    char *uri, *checksum, *basename;
+
+    index = g_new0 (CajaSearchIndex, 1);
+    index->ref_count = 1;
+    index->root = g_file_new_for_commandline_arg (root_path_or_uri);
+    index->journal = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                            (GDestroyNotify) index_journal_entry_free);
+
+    uri = g_file_get_uri (index->root);
+    checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+    basename = g_strconcat (checksum, ".idx", NULL);
+    index->index_path = g_build_filename (g_get_user_cache_dir (), "caja",
+                                          "search-index", basename, NULL);
+    g_free (basename);
+    g_free (checksum);
+    g_free (uri);
+
+    index->mapped = index_load (index->index_path);
+
+    return index;
+}
+
+static void
+search_index_unref (CajaSearchIndex *index)
+{
+    if (--index->ref_count > 0)
+    {
+        return;
+    }
+
+    if (index->mapped != NULL)
+    {
+        g_mapped_file_unref (index->mapped);
+    }
+    g_hash_table_destroy (index->journal);
+    g_object_unref (index->root);
+    g_free (index->index_path);
+    g_free (index);
+}
+
+static void
+search_index_cancel_and_unref (CajaSearchIndex *index)
+{
+    if (index->build_cancellable != NULL)
+    {
+        g_cancellable_cancel (index->build_cancellable);
+    }
+    search_index_unref (index);
+}
+
+static void
+search_index_add_journal_entry (CajaSearchIndex *index,
+                                IndexJournalEntry *entry)
+{
+    g_hash_table_replace (index->journal, entry->path, entry);
+
+    if (g_hash_table_size (index->journal) > JOURNAL_MAX_ENTRIES)
+    {
+        search_index_start_build (index);
+    }
+}
+
+typedef struct
+{
+    CajaSearchIndex *index;
+    char *path;
+} IndexQueryInfoData;
+
+static void
+file_changed_query_info_done (GObject *source_object,
+                              GAsyncResult *res,
+                              gpointer user_data)
+{
+    IndexQueryInfoData *data;
+    IndexJournalEntry *entry;
+    GFileInfo *info;
+    const char *display_name;
+
+    data = user_data;
+
+    info = g_file_query_info_finish (G_FILE (source_object), res, NULL);
+    if (info != NULL &&
+        (display_name = g_file_info_get_display_name (info)) != NULL)
+    {
+        entry = g_new0 (IndexJournalEntry, 1);
+        entry->path = data->path;
+        entry->name = caja_search_matcher_fold (display_name);
+        entry->mime = g_strdup (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE));
+        entry->tags = fold_tags (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_XATTR_XDG_TAGS));
+        entry->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+        entry->size = g_file_info_get_size (info);
+        entry->time = g_get_real_time ();
+        if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+        {
+            entry->flags |= INDEX_FLAG_DIRECTORY;
+        }
+        if (g_file_info_get_is_hidden (info) ||
+            path_has_hidden_component (entry->path))
+        {
+            entry->flags |= INDEX_FLAG_HIDDEN;
+        }
+
+        data->path = NULL;
+        search_index_add_journal_entry (data->index, entry);
+    }
+
+    if (info != NULL)
+    {
+        g_object_unref (info);
+    }
+    search_index_unref (data->index);
+    g_free (data->path);
+    g_free (data);
+}
+
+static void
+search_index_file_changed (GFile *file,
+                           GFileMonitorEvent event_type,
+                           gpointer callback_data)
+{
+    GList *l;
+
+    for (l = search_indexes; l != NULL; l = l->next)
+    {
+        CajaSearchIndex *index;
+        char *path;
+
+        index = l->data;
+
+        path = g_file_get_relative_path (index->root, file);
+        if (path == NULL)
+        {
+            continue;
+        }
+
+        switch (event_type)
+        {
+        case G_FILE_MONITOR_EVENT_DELETED:
+            {
+                IndexJournalEntry *entry;
+
+                entry = g_new0 (IndexJournalEntry, 1);
+                entry->path = path;
+                entry->flags = INDEX_FLAG_DELETED;
+                entry->time = g_get_real_time ();
+                search_index_add_journal_entry (index, entry);
+                break;
+            }
+        case G_FILE_MONITOR_EVENT_CREATED:
+        case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+        case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+            {
+                IndexQueryInfoData *data;
+
+                data = g_new0 (IndexQueryInfoData, 1);
+                data->index = index;
+                data->path = path;
+                index->ref_count++;
+
+                g_file_query_info_async (file, INDEX_ATTRIBUTES,
+                                         G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                         G_PRIORITY_LOW, NULL,
+                                         file_changed_query_info_done, data);
+                break;
+            }
+        default:
+            g_free (path);
+            break;
+        }
+    }
+}
+
+static void
+search_index_roots_changed (GSettings *settings,
+                            const char *key,
+                            gpointer user_data)
+{
+    char **roots;
+    int i;
+
+    g_list_free_full (search_indexes, (GDestroyNotify) search_index_cancel_and_unref);
+    search_indexes = NULL;
+
+    roots = g_settings_get_strv (caja_preferences, CAJA_PREFERENCES_SEARCH_INDEX_ROOTS);
+    for (i = 0; roots[i] != NULL; i++)
+    {
+        if (roots[i][0] != '\0')
+        {
+            search_indexes = g_list_prepend (search_indexes, search_index_new (roots[i]));
+        }
+    }
+    search_indexes = g_list_reverse (search_indexes);
+    g_strfreev (roots);
+
+    g_list_foreach (search_indexes, (GFunc) search_index_ensure_fresh, NULL);
+}
+
+static void
+search_indexes_ensure_initialized (void)
+{
+    if (search_indexes_initialized)
+    {
+        return;
+    }
+    search_indexes_initialized = TRUE;
+
+    g_signal_connect (caja_preferences,
+                      "changed::" CAJA_PREFERENCES_SEARCH_INDEX_ROOTS,
+                      G_CALLBACK (search_index_roots_changed), NULL);
+    search_index_roots_changed (caja_preferences, NULL, NULL);
+
+    caja_monitor_add_callback (search_index_file_changed, NULL);
+}
+
+/* Returns the index that can answer query, if any, and the location of
+ * the query relative to its root */
+static CajaSearchIndex *
+search_index_for_query (CajaQuery *query, char **prefix)
+{
+    CajaSearchIndex *result;
+    GFile *location;
+    char *uri, *text;
+    GList *l;
+
+    *prefix = NULL;
+
+    text = caja_query_get_contained_text (query);
+    if (text != NULL && text[0] != '\0')
+    {
+        g_free (text);
+        return NULL;
+    }
+    g_free (text);
+
+    uri = caja_query_get_location (query);
+    location = uri != NULL ? g_file_new_for_uri (uri) : g_file_new_for_path ("/");
+    g_free (uri);
+
+    result = NULL;
+    for (l = search_indexes; l != NULL; l = l->next)
+    {
+        CajaSearchIndex *index = l->data;
+
+        if (index->mapped == NULL)
+        {
+            continue;
+        }
+
+        if (g_file_equal (index->root, location))
+        {
+            result = index;
+            break;
+        }
+
+        *prefix = g_file_get_relative_path (index->root, location);
+        if (*prefix != NULL)
+        {
+            result = index;
+            break;
+        }
+    }
+    g_object_unref (location);
+
+    return result;
+}
+
+/* Query matching */
+
+static gboolean
+tags_contain_all (const char *file_tags, GList *tags)
+{
+    char **split;
+    GList *l;
+    gboolean result;
+
+    if (tags == NULL)
+    {
+        return TRUE;
+    }
+    if (file_tags == NULL || file_tags[0] == '\0')
+    {
+        return FALSE;
+    }
+
+    split = g_strsplit (file_tags, ",", -1);
+    result = TRUE;
+    for (l = tags; l != NULL && result; l = l->next)
+    {
+        result = g_strv_contains ((const char * const *) split, l->data);
+    }
+    g_strfreev (split);
+
+    return result;
+}
+
+static gboolean
+index_query_matches (IndexQueryData *data,
+                     const char *path,
+                     const char *name,
+                     const char *mime,
+                     const char *tags,
+                     gint64 mtime,
+                     gint64 size,
+                     guint32 flags)
+{
+    if ((flags & INDEX_FLAG_HIDDEN) && !data->search_hidden_files)
+    {
+        return FALSE;
+    }
+
+    if (data->prefix != NULL &&
+        !(g_str_has_prefix (path, data->prefix) &&
+          path[strlen (data->prefix)] == '/'))
+    {
+        return FALSE;
+    }
+
+    if (!caja_search_matcher_match_folded_name (data->matcher, name) ||
+        !caja_search_matcher_match_mime_type (data->matcher, mime))
+    {
+        return FALSE;
+    }
+
+    if (!tags_contain_all (tags, data->tags))
+    {
+        return FALSE;
+    }
+
+    if (data->timestamp > 0 && data->timestamp < mtime)
+    {
+        return FALSE;
+    }
+    if (data->timestamp < 0 && mtime < ABS (data->timestamp))
+    {
+        return FALSE;
+    }
+
+    if (data->size > 0 && size < data->size)
+    {
+        return FALSE;
+    }
+    if (data->size < 0 && ABS (data->size) < size)
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static IndexQueryData *
+index_query_data_new (CajaSearchEngineIndex *engine,
+                      CajaQuery *query,
+                      CajaSearchIndex *index,
+                      char *prefix)
+{
+    IndexQueryData *data;
+    GHashTableIter iter;
+    IndexJournalEntry *entry;
+
+    data = g_new0 (IndexQueryData, 1);
+
+    data->engine = engine;
+    data->cancellable = g_cancellable_new ();
+    data->mapped = g_mapped_file_ref (index->mapped);
+    data->root = g_object_ref (index->root);
+    data->prefix = prefix;
+
+    /* Snapshot the journal, it is only touched on the main thread */
+    data->journal = g_ptr_array_new_with_free_func ((GDestroyNotify) index_journal_entry_free);
+    data->journal_paths = g_hash_table_new (g_str_hash, g_str_equal);
+    g_hash_table_iter_init (&iter, index->journal);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+        entry = index_journal_entry_copy (entry);
+        g_ptr_array_add (data->journal, entry);
+        g_hash_table_insert (data->journal_paths, entry->path, entry);
+    }
+
+    data->matcher = caja_search_matcher_new (query);
+    data->tags = caja_query_get_tags (query);
+    data->timestamp = caja_query_get_timestamp (query);
+    data->size = caja_query_get_size (query);
+    data->search_hidden_files = engine->details->show_hidden_files;
+
+    return data;
+}
+
+static void
+index_query_data_free (IndexQueryData *data)
+{
+    g_object_unref (data->cancellable);
+    g_mapped_file_unref (data->mapped);
+    g_object_unref (data->root);
+    g_free (data->prefix);
+    g_hash_table_destroy (data->journal_paths);
+    g_ptr_array_free (data->journal, TRUE);
+    caja_search_matcher_free (data->matcher);
+    g_list_free_full (data->tags, g_free);
+    g_list_free_full (data->uri_hits, g_free);
+    g_free (data);
+}
+
+static gboolean
+index_query_done_idle (gpointer user_data)
+{
+    IndexQueryData *data;
+
+    data = user_data;
+
+    if (!g_cancellable_is_cancelled (data->cancellable))
+    {
+        caja_search_engine_finished (CAJA_SEARCH_ENGINE (data->engine));
+        data->engine->details->active_search = NULL;
+    }
+
+    index_query_data_free (data);
+
+    return FALSE;
+}
+
+typedef struct
+{
+    GList *uris;
+    IndexQueryData *query_data;
+} IndexHits;
+
+static gboolean
+index_query_add_hits_idle (gpointer user_data)
+{
+    IndexHits *hits;
+
+    hits = user_data;
+
+    if (!g_cancellable_is_cancelled (hits->query_data->cancellable))
+    {
+        caja_search_engine_hits_added (CAJA_SEARCH_ENGINE (hits->query_data->engine),
+                                       hits->uris);
+    }
+
+    g_list_free_full (hits->uris, g_free);
+    g_free (hits);
+
+    return FALSE;
+}
+
+static void
+send_batch (IndexQueryData *data)
+{
+    data->n_processed_files = 0;
+
+    if (data->uri_hits)
+    {
+        IndexHits *hits;
+
+        hits = g_new (IndexHits, 1);
+        hits->uris = data->uri_hits;
+        hits->query_data = data;
+        g_idle_add (index_query_add_hits_idle, hits);
+    }
+    data->uri_hits = NULL;
+}
+
+static void
+add_hit (IndexQueryData *data, const char *path)
+{
+    GFile *file;
+
+    file = g_file_resolve_relative_path (data->root, path);
+    data->uri_hits = g_list_prepend (data->uri_hits, g_file_get_uri (file));
+    g_object_unref (file);
+
+    if (++data->n_processed_files > BATCH_SIZE)
+    {
+        send_batch (data);
+    }
+}
+
+enum
+{
+    RECORD_SUPERSEDED = 1 << 0,
+    RECORD_REMOVED = 1 << 1
+};
+
+static gpointer
+index_query_thread_func (gpointer user_data)
+{
+    IndexQueryData *data;
+    const IndexHeader *header;
+    const IndexRecord *records;
+    guint8 *state;
+    guint32 i;
+
+    data = user_data;
+
+    header = index_get_header (data->mapped);
+    records = index_get_records (data->mapped);
+
+    /* Records always follow their folder, so removal of a folder can be
+     * propagated to its contents in the same pass */
+    state = g_new0 (guint8, header->n_records);
+
+    for (i = 0; i < header->n_records; i++)
+    {
+        const IndexRecord *record = &records[i];
+        const char *path;
+        IndexJournalEntry *entry;
+
+        if ((i & 0xfff) == 0 && g_cancellable_is_cancelled (data->cancellable))
+        {
+            break;
+        }
+
+        if (record->parent < i && (state[record->parent] & RECORD_REMOVED))
+        {
+            state[i] = RECORD_REMOVED;
+            continue;
+        }
+
+        path = index_get_string (data->mapped, record->path);
+
+        if (data->journal->len > 0 &&
+            (entry = g_hash_table_lookup (data->journal_paths, path)) != NULL)
+        {
+            state[i] = (entry->flags & INDEX_FLAG_DELETED) ? RECORD_REMOVED : RECORD_SUPERSEDED;
+            continue;
+        }
+
+        if (index_query_matches (data, path,
+                                 index_get_string (data->mapped, record->name),
+                                 index_get_string (data->mapped, record->mime),
+                                 index_get_string (data->mapped, record->tags),
+                                 record->mtime, record->size, record->flags))
+        {
+            add_hit (data, path);
+        }
+    }
+
+    for (i = 0; i < data->journal->len; i++)
+    {
+        IndexJournalEntry *entry;
+
+        entry = g_ptr_array_index (data->journal, i);
+        if ((entry->flags & INDEX_FLAG_DELETED) == 0 &&
+            entry->name != NULL &&
+            index_query_matches (data, entry->path, entry->name, entry->mime,
+                                 entry->tags, entry->mtime, entry->size,
+                                 entry->flags))
+        {
+            add_hit (data, entry->path);
+        }
+    }
+
+    g_free (state);
+
+    send_batch (data);
+    g_idle_add (index_query_done_idle, data);
+
+    return NULL;
+}
+
+/* The engine */
+
+static void
+fallback_hits_added (CajaSearchEngine *fallback,
+                     GList *hits,
+                     CajaSearchEngineIndex *engine)
+{
+    caja_search_engine_hits_added (CAJA_SEARCH_ENGINE (engine), hits);
+}
+
+static void
+fallback_hits_subtracted (CajaSearchEngine *fallback,
+                          GList *hits,
+                          CajaSearchEngineIndex *engine)
+{
+    caja_search_engine_hits_subtracted (CAJA_SEARCH_ENGINE (engine), hits);
+}
+
+static void
+fallback_finished (CajaSearchEngine *fallback,
+                   CajaSearchEngineIndex *engine)
+{
+    caja_search_engine_finished (CAJA_SEARCH_ENGINE (engine));
+}
+
+static void
+fallback_error (CajaSearchEngine *fallback,
+                const char *error_message,
+                CajaSearchEngineIndex *engine)
+{
+    caja_search_engine_error (CAJA_SEARCH_ENGINE (engine), error_message);
+}
+
+static CajaSearchEngine *
+get_fallback (CajaSearchEngineIndex *index)
+{
+    CajaSearchEngine *fallback;
+
+    if (index->details->fallback != NULL)
+    {
+        return index->details->fallback;
+    }
+
+    fallback = caja_search_engine_simple_new ();
+    caja_search_engine_set_show_hidden_files (fallback, index->details->show_hidden_files);
+    g_signal_connect (fallback, "hits-added",
+                      G_CALLBACK (fallback_hits_added), index);
+    g_signal_connect (fallback, "hits-subtracted",
+                      G_CALLBACK (fallback_hits_subtracted), index);
+    g_signal_connect (fallback, "finished",
+                      G_CALLBACK (fallback_finished), index);
+    g_signal_connect (fallback, "error",
+                      G_CALLBACK (fallback_error), index);
+
+    index->details->fallback = fallback;
+
+    return fallback;
+}
+
+static void
+finalize (GObject *object)
+{
+    CajaSearchEngineIndex *index;
+
+    index = CAJA_SEARCH_ENGINE_INDEX (object);
+
+    if (index->details->query)
+    {
+        g_object_unref (index->details->query);
+        index->details->query = NULL;
+    }
+
+    if (index->details->fallback)
+    {
+        g_signal_handlers_disconnect_by_data (index->details->fallback, index);
+        g_object_unref (index->details->fallback);
+        index->details->fallback = NULL;
+    }
+
+    g_free (index->details);
+
+    EEL_CALL_PARENT (G_OBJECT_CLASS, finalize, (object));
+}
+
+static void
+caja_search_engine_index_start (CajaSearchEngine *engine)
+{
+    CajaSearchEngineIndex *index;
+    CajaSearchIndex *search_index;
+    IndexQueryData *data;
+    GThread *thread;
+    char *prefix;
+
+    index = CAJA_SEARCH_ENGINE_INDEX (engine);
+
+    if (index->details->active_search != NULL)
+    {
+        return;
+    }
+
+    if (index->details->query == NULL)
+    {
+        return;
+    }
+
+    search_index = search_index_for_query (index->details->query, &prefix);
+    if (search_index == NULL)
+    {
+        CajaSearchEngine *fallback;
+
+        fallback = get_fallback (index);
+        caja_search_engine_set_query (fallback, index->details->query);
+        caja_search_engine_start (fallback);
+        return;
+    }
+
+    search_index_ensure_fresh (search_index);
+
+    data = index_query_data_new (index, index->details->query, search_index, prefix);
+
+    thread = g_thread_new ("caja-search-index", index_query_thread_func, data);
+    index->details->active_search = data;
+
+    g_thread_unref (thread);
+}
+
+static void
+caja_search_engine_index_stop (CajaSearchEngine *engine)
+{
+    CajaSearchEngineIndex *index;
+
+    index = CAJA_SEARCH_ENGINE_INDEX (engine);
+
+    if (index->details->active_search != NULL)
+    {
+        g_cancellable_cancel (index->details->active_search->cancellable);
+        index->details->active_search = NULL;
+    }
+
+    if (index->details->fallback != NULL)
+    {
+        caja_search_engine_stop (index->details->fallback);
+    }
+}
+
+static gboolean
+caja_search_engine_index_is_indexed (CajaSearchEngine *engine)
+{
+    CajaSearchEngineIndex *index;
+    char *prefix;
+    gboolean is_indexed;
+    GList *l;
+
+    index = CAJA_SEARCH_ENGINE_INDEX (engine);
+
+    if (index->details->query != NULL)
+    {
+        is_indexed = search_index_for_query (index->details->query, &prefix) != NULL;
+        g_free (prefix);
+        return is_indexed;
+    }
+
+    for (l = search_indexes; l != NULL; l = l->next)
+    {
+        if (((CajaSearchIndex *) l->data)->mapped != NULL)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void
+caja_search_engine_index_set_query (CajaSearchEngine *engine, CajaQuery *query)
+{
+    CajaSearchEngineIndex *index;
+
+    index = CAJA_SEARCH_ENGINE_INDEX (engine);
+
+    if (query)
+    {
+        g_object_ref (query);
+    }
+
+    if (index->details->query)
+    {
+        g_object_unref (index->details->query);
+    }
+
+    index->details->query = query;
+}
+
+static void
+caja_search_engine_index_set_show_hidden_files (CajaSearchEngine *engine, gboolean show_hidden_files)
+{
+    CajaSearchEngineIndex *index;
+
+    index = CAJA_SEARCH_ENGINE_INDEX (engine);
+    index->details->show_hidden_files = show_hidden_files;
+
+    if (index->details->fallback != NULL)
+    {
+        caja_search_engine_set_show_hidden_files (index->details->fallback, show_hidden_files);
+    }
+}
+
+static void
+caja_search_engine_index_class_init (CajaSearchEngineIndexClass *class)
+{
+    GObjectClass *gobject_class;
+    CajaSearchEngineClass *engine_class;
+
+    parent_class = g_type_class_peek_parent (class);
+
+    gobject_class = G_OBJECT_CLASS (class);
+    gobject_class->finalize = finalize;
+
+    engine_class = CAJA_SEARCH_ENGINE_CLASS (class);
+    engine_class->set_query = caja_search_engine_index_set_query;
+    engine_class->set_show_hidden_files = caja_search_engine_index_set_show_hidden_files;
+    engine_class->start = caja_search_engine_index_start;
+    engine_class->stop = caja_search_engine_index_stop;
+    engine_class->is_indexed = caja_search_engine_index_is_indexed;
+}
+
+static void
+caja_search_engine_index_init (CajaSearchEngineIndex *engine)
+{
+    engine->details = g_new0 (CajaSearchEngineIndexDetails, 1);
+    engine->details->show_hidden_files = g_settings_get_boolean (caja_preferences, CAJA_PREFERENCES_SHOW_HIDDEN_FILES);
+}
+
+CajaSearchEngine *
+caja_search_engine_index_new (void)
+{
+    CajaSearchEngine *engine;
+
+    search_indexes_ensure_initialized ();
+
+    if (search_indexes == NULL)
+    {
+        return NULL;
+    }
+
+    engine = g_object_new (CAJA_TYPE_SEARCH_ENGINE_INDEX, NULL);
+
+    return engine;
+}
@@ -24,39 +24,54 @@
 #include <config.h>
 #include <string.h>
 #include <glib.h>
-#include <fnmatch.h>
 
 #include <gio/gio.h>
 
 #include <eel/eel-gtk-macros.h>
 
 #include "caja-search-engine-simple.h"
+#include "caja-search-matcher.h"
 #include "caja-global-preferences.h"
 
 #define BATCH_SIZE 500
 
+/* Upper bound for the number of search workers; more than this mostly
+ * adds contention on the directory queue without speeding up the walk. */
+#define MAX_SEARCH_THREADS 8
+
 typedef struct
 {
     CajaSearchEngineSimple *engine;
     GCancellable *cancellable;
 
     char *contained_text;
-    GList *mime_types;
+    CajaSearchMatcher *matcher;
     GList *tags;
-    char **words;
-    gboolean use_globs;
 
-    GQueue *directories; /* GFiles */
+    GFile *root;
 
+    /* Shared between all workers, protected by lock */
+    GMutex lock;
+    GCond cond;
+    GQueue *directories; /* GFiles */
     GHashTable *visited;
+    int n_busy_workers;
+
+    int n_running_workers; /* atomic */
 
-    gint n_processed_files;
-    GList *uri_hits;
     gint64 timestamp;
     gint64 size;
     gboolean search_hidden_files;
 } SearchThreadData;
 
+/* Per worker state, hits are batched locally and sent without locking */
+typedef struct
+{
+    SearchThreadData *data;
+    gint n_processed_files;
+    GList *uri_hits;
+} SearchWorker;
+
 struct CajaSearchEngineSimpleDetails
 {
     CajaQuery *query;
@@ -73,16 +88,17 @@ G_DEFINE_TYPE (CajaSearchEngineSimple,
 
 static CajaSearchEngineClass *parent_class = NULL;
 
-static gboolean
-text_has_glob (const char *text)
-{
-    if (!text)
-        return FALSE;
+static inline gchar *
+utf8_normalize_strdown (const char *str, gssize len) {
+    gchar* lower = NULL;
+    gchar *normalized = g_utf8_normalize (str, len, G_NORMALIZE_DEFAULT);
 
-    return (strchr (text, '*') != NULL ||
-            strchr (text, '?') != NULL ||
-            strchr (text, '[') != NULL ||
-            strchr (text, ']') != NULL);
+    if (normalized)
+        lower = g_utf8_strdown (normalized, -1);
+
+    g_free (normalized);
+
+    return lower;
 }
 
 static void
@@ -108,12 +124,14 @@ search_thread_data_new (CajaSearchEngineSimple *engine,
                         CajaQuery *query)
 {
     SearchThreadData *data;
-    char *text, *lower, *normalized, *uri;
+    char *text, *uri;
     GFile *location;
 
     data = g_new0 (SearchThreadData, 1);
 
     data->engine = engine;
+    g_mutex_init (&data->lock);
+    g_cond_init (&data->cond);
     data->directories = g_queue_new ();
     data->visited = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
     uri = caja_query_get_location (query);
@@ -127,32 +145,20 @@ search_thread_data_new (CajaSearchEngineSimple *engine,
     {
         location = g_file_new_for_path ("/");
     }
+    data->root = g_object_ref (location);
     g_queue_push_tail (data->directories, location);
 
-    text = caja_query_get_text (query);
-    data->use_globs = text && text_has_glob (text);
-
-    if (data->use_globs)
-    {
-        /* For globs, keep original case and don't normalize */
-        data->words = g_strsplit (text, " ", -1);
-    }
-    else
-    {
-        /* For substring matching, normalize and lowercase */
-        normalized = g_utf8_normalize (text, -1, G_NORMALIZE_NFD);
-        lower = g_utf8_strdown (normalized, -1);
-        data->words = g_strsplit (lower, " ", -1);
-        g_free (lower);
-        g_free (normalized);
-    }
-    g_free (text);
-
+    data->matcher = caja_search_matcher_new (query);
     data->tags = caja_query_get_tags (query);
-    data->mime_types = caja_query_get_mime_types (query);
     data->timestamp = caja_query_get_timestamp (query);
     data->size = caja_query_get_size (query);
-    data->contained_text = caja_query_get_contained_text (query);
+    text = caja_query_get_contained_text (query);
+    if (text != NULL)
+    {
+        /* Fold once here instead of for every file searched */
+        data->contained_text = utf8_normalize_strdown (text, -1);
+        g_free (text);
+    }
 
     data->search_hidden_files = engine->details->show_hidden_files;
 
@@ -167,12 +173,13 @@ search_thread_data_free (SearchThreadData *data)
     g_queue_foreach (data->directories,
                      (GFunc)g_object_unref, NULL);
     g_queue_free (data->directories);
+    g_object_unref (data->root);
     g_hash_table_destroy (data->visited);
+    g_mutex_clear (&data->lock);
+    g_cond_clear (&data->cond);
     g_object_unref (data->cancellable);
-    g_strfreev (data->words);
+    caja_search_matcher_free (data->matcher);
     g_list_free_full (data->tags, g_free);
-    g_list_free_full (data->mime_types, g_free);
-    g_list_free_full (data->uri_hits, g_free);
     g_free (data->contained_text);
     g_free (data);
 }
@@ -221,20 +228,20 @@ search_thread_add_hits_idle (gpointer user_data)
 }
 
 static void
-send_batch (SearchThreadData *data)
+send_batch (SearchWorker *worker)
 {
-    data->n_processed_files = 0;
+    worker->n_processed_files = 0;
 
-    if (data->uri_hits)
+    if (worker->uri_hits)
     {
         SearchHits *hits;
 
         hits = g_new (SearchHits, 1);
-        hits->uris = data->uri_hits;
-        hits->thread_data = data;
+        hits->uris = worker->uri_hits;
+        hits->thread_data = worker->data;
         g_idle_add (search_thread_add_hits_idle, hits);
     }
-    data->uri_hits = NULL;
+    worker->uri_hits = NULL;
 }
 
 #define G_FILE_ATTRIBUTE_XATTR_XDG_TAGS "xattr::xdg.tags"
@@ -367,123 +374,647 @@ file_has_all_tags (GFileInfo *info, GList *tags)
     return TRUE;
 }
 
-static inline gboolean
-check_odt2txt (void) {
-    gboolean rc = TRUE;
-    int exit = 0;
-    gchar *output = NULL;
+/* Size of the buffers file contents are read and matched in */
+#define CONTENT_CHUNK_SIZE (64 * 1024)
+
+/* Case insensitive matcher fed with chunks of UTF-8 text. Only the current
+ * chunk plus the last needle_len - 1 bytes of folded text are kept. */
+typedef struct
+{
+    const char *needle; /* normalized and lowercased */
+    gsize needle_len;
+    GString *pending;   /* input not yet folded, e.g. a split character */
+    GString *window;    /* folded text still to be searched */
+    gboolean found;
+} ContentMatcher;
+
+static void
+content_matcher_init (ContentMatcher *matcher, const char *needle)
+{
+    matcher->needle = needle;
+    matcher->needle_len = strlen (needle);
+    matcher->pending = g_string_sized_new (CONTENT_CHUNK_SIZE);
+    matcher->window = g_string_sized_new (CONTENT_CHUNK_SIZE);
+    matcher->found = FALSE;
+}
+
+static void
+content_matcher_clear (ContentMatcher *matcher)
+{
+    g_string_free (matcher->pending, TRUE);
+    g_string_free (matcher->window, TRUE);
+}
+
+static gboolean
+find_folded (const char *haystack, gsize len,
+             const char *needle, gsize needle_len)
+{
+    const char *p, *end;
 
-    gboolean cmd_rc = g_spawn_command_line_sync ("odt2txt --version", &output, NULL, &exit, NULL);
+    if (needle_len > len)
+    {
+        return FALSE;
+    }
 
-    if (!cmd_rc || exit != 0 ||
-        !output || !g_str_has_prefix (output, "odt2txt"))
+    /* memchr is vectorized, so scan for the first byte before comparing */
+    end = haystack + len - needle_len + 1;
+    for (p = haystack; (p = memchr (p, needle[0], end - p)) != NULL; p++)
     {
-        rc = FALSE;
+        if (memcmp (p, needle, needle_len) == 0)
+        {
+            return TRUE;
+        }
     }
 
-    g_free (output);
-    return rc;
+    return FALSE;
 }
 
-static inline gchar *
-read_odt (const char *filepath) {
-    gchar *command = g_strdup_printf ("odt2txt \"%s\"", filepath);
-    gchar *output  = NULL;
-    int exit = 0;
-
-    gboolean rc = g_spawn_command_line_sync (command, &output, NULL, &exit, NULL);
-    if (!rc || exit != 0) {
-        g_free (output);
-        g_free (command);
+static gboolean
+is_ascii (const char *str, gsize len)
+{
+    gsize i;
+    guchar bits;
+
+    bits = 0;
+    for (i = 0; i < len; i++)
+    {
+        bits |= (guchar) str[i];
+    }
+
+    return (bits & 0x80) == 0;
+}
+
+static void
+content_matcher_fold (ContentMatcher *matcher, const char *text, gsize len)
+{
+    if (is_ascii (text, len))
+    {
+        gsize i, old_len;
+
+        old_len = matcher->window->len;
+        g_string_set_size (matcher->window, old_len + len);
+        for (i = 0; i < len; i++)
+        {
+            matcher->window->str[old_len + i] = g_ascii_tolower (text[i]);
+        }
+    }
+    else
+    {
+        char *valid, *lower;
+
+        valid = NULL;
+        if (!g_utf8_validate (text, len, NULL))
+        {
+            valid = g_utf8_make_valid (text, len);
+        }
+
+        lower = utf8_normalize_strdown (valid ? valid : text, valid ? -1 : (gssize) len);
+        if (lower != NULL)
+        {
+            g_string_append (matcher->window, lower);
+        }
+
+        g_free (lower);
+        g_free (valid);
+    }
+}
+
+/* Returns the length of the part of text that ends on a character boundary */
+static gsize
+utf8_complete_length (const char *text, gsize len)
+{
+    gsize i;
+
+    for (i = len; i > 0 && len - i < 4; i--)
+    {
+        guchar c = text[i - 1];
+
+        if (c < 0x80)
+        {
+            return len;
+        }
+        if (c >= 0xc0)
+        {
+            gsize needed;
+
+            needed = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : 2;
+            return (len - (i - 1) >= needed) ? len : i - 1;
+        }
+    }
+
+    return len;
+}
+
+static gboolean
+content_matcher_feed (ContentMatcher *matcher, const char *data, gsize len)
+{
+    gsize complete, keep;
+
+    if (matcher->found)
+    {
+        return TRUE;
+    }
+
+    g_string_append_len (matcher->pending, data, len);
+    complete = utf8_complete_length (matcher->pending->str, matcher->pending->len);
+
+    content_matcher_fold (matcher, matcher->pending->str, complete);
+    g_string_erase (matcher->pending, 0, complete);
+
+    if (find_folded (matcher->window->str, matcher->window->len,
+                     matcher->needle, matcher->needle_len))
+    {
+        matcher->found = TRUE;
+        return TRUE;
+    }
+
+    /* Keep enough of the folded text to find matches across chunks */
+    keep = MIN (matcher->needle_len - 1, matcher->window->len);
+    while (keep < matcher->window->len &&
+           (matcher->window->str[matcher->window->len - keep] & 0xc0) == 0x80)
+    {
+        keep++;
+    }
+    g_string_erase (matcher->window, 0, matcher->window->len - keep);
+
+    return FALSE;
+}
+
+static gboolean
+content_matcher_finish (ContentMatcher *matcher)
+{
+    if (!matcher->found && matcher->pending->len > 0)
+    {
+        content_matcher_fold (matcher, matcher->pending->str, matcher->pending->len);
+        g_string_truncate (matcher->pending, 0);
+        matcher->found = find_folded (matcher->window->str, matcher->window->len,
+                                      matcher->needle, matcher->needle_len);
+    }
+
+    return matcher->found;
+}
+
+/* OpenDocument files are zip archives with the text in content.xml. Find
+ * that member and return a stream of its uncompressed contents, without
+ * reading anything else from the archive. */
+
+#define ZIP_EOCD_SIZE 22
+#define ZIP_MAX_COMMENT_SIZE 65535
+#define ZIP_CENTRAL_HEADER_SIZE 46
+#define ZIP_LOCAL_HEADER_SIZE 30
+#define ZIP_MAX_CENTRAL_DIRECTORY_SIZE (16 * 1024 * 1024)
+
+static guint16
+read_le16 (const guchar *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static guint32
+read_le32 (const guchar *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32) p[3] << 24);
+}
+
+static gboolean
+read_at (GInputStream *stream, goffset offset, guchar *buffer, gsize size,
+         GCancellable *cancellable)
+{
+    gsize bytes_read;
+
+    return g_seekable_seek (G_SEEKABLE (stream), offset, G_SEEK_SET, cancellable, NULL) &&
+           g_input_stream_read_all (stream, buffer, size, &bytes_read, cancellable, NULL) &&
+           bytes_read == size;
+}
+
+static GInputStream *
+odf_open_content_xml (GFile *file, goffset *stored_size, GCancellable *cancellable)
+{
+    GFileInputStream *file_stream;
+    GInputStream *stream, *result;
+    guchar *buffer, *p, *end;
+    guchar local_header[ZIP_LOCAL_HEADER_SIZE];
+    goffset file_size, tail_offset, data_offset;
+    gsize tail_size;
+    guint32 cd_offset, cd_size;
+    guint16 method;
+    gsize i;
+
+    file_stream = g_file_read (file, cancellable, NULL);
+    if (file_stream == NULL)
+    {
         return NULL;
     }
+    stream = G_INPUT_STREAM (file_stream);
+    buffer = NULL;
+    result = NULL;
+
+    if (!g_seekable_can_seek (G_SEEKABLE (stream)) ||
+        !g_seekable_seek (G_SEEKABLE (stream), 0, G_SEEK_END, cancellable, NULL))
+    {
+        goto out;
+    }
+    file_size = g_seekable_tell (G_SEEKABLE (stream));
+    if (file_size < ZIP_EOCD_SIZE)
+    {
+        goto out;
+    }
+
+    /* Find the end of central directory record, followed by a comment */
+    tail_size = MIN (file_size, ZIP_EOCD_SIZE + ZIP_MAX_COMMENT_SIZE);
+    tail_offset = file_size - tail_size;
+    buffer = g_malloc (tail_size);
+    if (!read_at (stream, tail_offset, buffer, tail_size, cancellable))
+    {
+        goto out;
+    }
+
+    for (i = tail_size - ZIP_EOCD_SIZE + 1; i > 0; i--)
+    {
+        if (memcmp (buffer + i - 1, "PK\5\6", 4) == 0)
+        {
+            break;
+        }
+    }
+    if (i == 0)
+    {
+        goto out;
+    }
+    cd_size = read_le32 (buffer + i - 1 + 12);
+    cd_offset = read_le32 (buffer + i - 1 + 16);
+    g_free (buffer);
+    buffer = NULL;
+
+    if (cd_size > ZIP_MAX_CENTRAL_DIRECTORY_SIZE ||
+        (goffset) cd_offset + cd_size > file_size)
+    {
+        goto out;
+    }
+
+    buffer = g_malloc (cd_size);
+    if (!read_at (stream, cd_offset, buffer, cd_size, cancellable))
+    {
+        goto out;
+    }
+
+    /* Walk the central directory looking for content.xml */
+    end = buffer + cd_size;
+    for (p = buffer; p + ZIP_CENTRAL_HEADER_SIZE <= end; )
+    {
+        guint16 name_len, extra_len, comment_len;
+        guint32 compressed_size, local_offset;
+
+        if (memcmp (p, "PK\1\2", 4) != 0)
+        {
+            goto out;
+        }
+
+        method = read_le16 (p + 10);
+        compressed_size = read_le32 (p + 20);
+        name_len = read_le16 (p + 28);
+        extra_len = read_le16 (p + 30);
+        comment_len = read_le16 (p + 32);
+        local_offset = read_le32 (p + 42);
+
+        if (p + ZIP_CENTRAL_HEADER_SIZE + name_len > end)
+        {
+            goto out;
+        }
+
+        if (name_len == strlen ("content.xml") &&
+            memcmp (p + ZIP_CENTRAL_HEADER_SIZE, "content.xml", name_len) == 0)
+        {
+            if ((method != 0 && method != 8) ||
+                !read_at (stream, local_offset, local_header,
+                          ZIP_LOCAL_HEADER_SIZE, cancellable) ||
+                memcmp (local_header, "PK\3\4", 4) != 0)
+            {
+                goto out;
+            }
+
+            data_offset = (goffset) local_offset + ZIP_LOCAL_HEADER_SIZE +
+                          read_le16 (local_header + 26) +
+                          read_le16 (local_header + 28);
+            if (!g_seekable_seek (G_SEEKABLE (stream), data_offset,
+                                  G_SEEK_SET, cancellable, NULL))
+            {
+                goto out;
+            }
+
+            if (method == 0)
+            {
+                *stored_size = compressed_size;
+                result = g_object_ref (stream);
+            }
+            else
+            {
+                GZlibDecompressor *decompressor;
+
+                *stored_size = -1;
+                decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW);
+                result = g_converter_input_stream_new (stream, G_CONVERTER (decompressor));
+                g_object_unref (decompressor);
+            }
+            goto out;
+        }
+
+        p += ZIP_CENTRAL_HEADER_SIZE + name_len + extra_len + comment_len;
+    }
 
-    g_free (command);
-    return output;
+out:
+    g_free (buffer);
+    g_object_unref (stream);
+
+    return result;
 }
 
-static inline gchar *
-utf8_normalize_strdown (const char *str) {
-    gchar* lower = NULL;
-    gchar *normalized = g_utf8_normalize (str, -1, G_NORMALIZE_DEFAULT);
+/* Turns the XML of content.xml into plain text while streaming it into a
+ * matcher. Paragraph and cell boundaries become line breaks and spaces
+ * so that words of adjacent paragraphs don't run together. */
 
-    if (normalized)
-        lower = g_utf8_strdown (normalized, -1);
+typedef enum
+{
+    ODF_TEXT,
+    ODF_TAG,
+    ODF_ENTITY
+} OdfTextState;
 
-    g_free (normalized);
+typedef struct
+{
+    ContentMatcher *matcher;
+    OdfTextState state;
+    GString *text;
+    char name[32];
+    gsize name_len;
+    gboolean name_done;
+} OdfTextExtractor;
 
-    return lower;
+static void
+odf_text_flush (OdfTextExtractor *extractor)
+{
+    content_matcher_feed (extractor->matcher, extractor->text->str, extractor->text->len);
+    g_string_truncate (extractor->text, 0);
 }
 
-static inline gboolean
-is_file_has_str (
-    const char *filepath,
-    const char *str,
-    const char *mime_type,
-    gboolean odt2txt_available)
+static void
+odf_text_end_tag (OdfTextExtractor *extractor)
+{
+    const char *name;
+
+    extractor->name[extractor->name_len] = '\0';
+    name = extractor->name[0] == '/' ? extractor->name + 1 : extractor->name;
+
+    if (strcmp (name, "text:p") == 0 ||
+        strcmp (name, "text:h") == 0 ||
+        strcmp (name, "text:line-break") == 0)
+    {
+        g_string_append_c (extractor->text, '\n');
+    }
+    else if (strcmp (name, "text:s") == 0 ||
+             strcmp (name, "text:tab") == 0 ||
+             strcmp (name, "table:table-cell") == 0)
+    {
+        g_string_append_c (extractor->text, ' ');
+    }
+}
+
+static void
+odf_text_end_entity (OdfTextExtractor *extractor)
+{
+    const char *entity;
+    gunichar c;
+
+    extractor->name[extractor->name_len] = '\0';
+    entity = extractor->name;
+    c = 0;
+
+    if (strcmp (entity, "amp") == 0)
+        c = '&';
+    else if (strcmp (entity, "lt") == 0)
+        c = '<';
+    else if (strcmp (entity, "gt") == 0)
+        c = '>';
+    else if (strcmp (entity, "quot") == 0)
+        c = '"';
+    else if (strcmp (entity, "apos") == 0)
+        c = '\'';
+    else if (entity[0] == '#' && (entity[1] == 'x' || entity[1] == 'X'))
+        c = g_ascii_strtoull (entity + 2, NULL, 16);
+    else if (entity[0] == '#')
+        c = g_ascii_strtoull (entity + 1, NULL, 10);
+
+    if (c != 0 && g_unichar_validate (c))
+    {
+        g_string_append_unichar (extractor->text, c);
+    }
+}
+
+static void
+odf_text_feed (OdfTextExtractor *extractor, const char *data, gsize len)
+{
+    gsize i;
+
+    for (i = 0; i < len; i++)
+    {
+        char c = data[i];
+
+        switch (extractor->state)
+        {
+        case ODF_TEXT:
+            if (c == '<' || c == '&')
+            {
+                extractor->state = c == '<' ? ODF_TAG : ODF_ENTITY;
+                extractor->name_len = 0;
+                extractor->name_done = FALSE;
+            }
+            else
+            {
+                g_string_append_c (extractor->text, c);
+            }
+            break;
+        case ODF_TAG:
+            if (c == '>')
+            {
+                odf_text_end_tag (extractor);
+                extractor->state = ODF_TEXT;
+            }
+            else if (c == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+                     (c == '/' && extractor->name_len > 0))
+            {
+                extractor->name_done = TRUE;
+            }
+            else if (!extractor->name_done &&
+                     extractor->name_len < sizeof (extractor->name) - 1)
+            {
+                extractor->name[extractor->name_len++] = c;
+            }
+            break;
+        case ODF_ENTITY:
+            if (c == ';' || extractor->name_len >= sizeof (extractor->name) - 1)
+            {
+                odf_text_end_entity (extractor);
+                extractor->state = ODF_TEXT;
+            }
+            else
+            {
+                extractor->name[extractor->name_len++] = c;
+            }
+            break;
+        }
+    }
+
+    odf_text_flush (extractor);
+}
+
+static gboolean
+is_odf_mime_type (const char *mime_type)
 {
-    gboolean rc = TRUE;
-    gchar *contents = NULL;
-    gchar *lower_contents = NULL;
-    gchar *lower_str = NULL;
+    return g_content_type_equals (mime_type, "application/vnd.oasis.opendocument.text") ||
+           g_content_type_equals (mime_type, "application/vnd.oasis.opendocument.text-template") ||
+           g_content_type_equals (mime_type, "application/vnd.oasis.opendocument.spreadsheet") ||
+           g_content_type_equals (mime_type, "application/vnd.oasis.opendocument.spreadsheet-template") ||
+           g_content_type_equals (mime_type, "application/vnd.oasis.opendocument.presentation") ||
+           g_content_type_equals (mime_type, "application/vnd.oasis.opendocument.presentation-template");
+}
+
+/* str must already be normalized and lowercased */
+static gboolean
+is_file_has_str (GFile *file,
+                 const char *str,
+                 const char *mime_type,
+                 GCancellable *cancellable)
+{
+    ContentMatcher matcher;
+    OdfTextExtractor extractor;
+    GInputStream *stream;
+    gboolean is_odf;
+    goffset remaining;
+    char *buffer;
+    gssize n;
 
     if (str[0] == '\0') {
         return TRUE;
     }
 
-    if (g_content_type_is_mime_type (mime_type, "text/plain")) {
-        rc = g_file_get_contents (filepath, &contents, NULL, NULL);
+    is_odf = !g_content_type_is_mime_type (mime_type, "text/plain");
+    remaining = -1;
+
+    if (is_odf) {
+        stream = odf_open_content_xml (file, &remaining, cancellable);
     }
     else {
-        if (!odt2txt_available) {
-            g_warning ("Can't search in file '%s'. odt2txt not found.", filepath);
-            rc = FALSE;
+        stream = G_INPUT_STREAM (g_file_read (file, cancellable, NULL));
+    }
+
+    if (stream == NULL) {
+        return FALSE;
+    }
+
+    content_matcher_init (&matcher, str);
+    if (is_odf) {
+        memset (&extractor, 0, sizeof (extractor));
+        extractor.matcher = &matcher;
+        extractor.state = ODF_TEXT;
+        extractor.text = g_string_sized_new (CONTENT_CHUNK_SIZE);
+    }
+
+    buffer = g_malloc (CONTENT_CHUNK_SIZE);
+    while (!matcher.found && remaining != 0 &&
+           (n = g_input_stream_read (stream, buffer,
+                                     remaining < 0 ? CONTENT_CHUNK_SIZE : MIN (remaining, CONTENT_CHUNK_SIZE),
+                                     cancellable, NULL)) > 0) {
+        if (remaining > 0) {
+            remaining -= n;
+        }
+
+        if (is_odf) {
+            odf_text_feed (&extractor, buffer, n);
         }
         else {
-            contents = read_odt (filepath);
-            if (!contents)
-                rc = FALSE;
+            content_matcher_feed (&matcher, buffer, n);
         }
     }
+    g_free (buffer);
 
-    if (rc) {
-        lower_str = utf8_normalize_strdown (str);
-        lower_contents = utf8_normalize_strdown (contents);
+    content_matcher_finish (&matcher);
 
-        if (lower_str && lower_contents && strstr (lower_contents, lower_str))
-            rc = TRUE;
-        else
-            rc = FALSE;
+    if (is_odf) {
+        g_string_free (extractor.text, TRUE);
+    }
+    content_matcher_clear (&matcher);
+    g_object_unref (stream);
+
+    return matcher.found;
+}
+
+/* Takes ownership of subdirs and of the matching ids (which may be NULL) */
+static void
+queue_subdirectories (SearchThreadData *data, GList *subdirs, GList *ids)
+{
+    GList *l, *id_l;
+    gboolean queued;
+
+    if (subdirs == NULL)
+    {
+        return;
     }
 
-    g_free (contents);
-    g_free (lower_str);
-    g_free (lower_contents);
+    queued = FALSE;
+
+    g_mutex_lock (&data->lock);
+    for (l = subdirs, id_l = ids; l != NULL; l = l->next, id_l = id_l->next)
+    {
+        GFile *child;
+        char *id;
+
+        child = l->data;
+        id = id_l->data;
 
-    return rc;
+        if (id != NULL)
+        {
+            if (g_hash_table_contains (data->visited, id))
+            {
+                g_free (id);
+                g_object_unref (child);
+                continue;
+            }
+            g_hash_table_add (data->visited, id);
+        }
+
+        g_queue_push_tail (data->directories, child);
+        queued = TRUE;
+    }
+    if (queued)
+    {
+        g_cond_broadcast (&data->cond);
+    }
+    g_mutex_unlock (&data->lock);
+
+    g_list_free (subdirs);
+    g_list_free (ids);
 }
 
 static void
-visit_directory (GFile *dir, SearchThreadData *data)
+visit_directory (GFile *dir, SearchWorker *worker)
 {
+    SearchThreadData *data;
     GFileEnumerator *enumerator;
     GFileInfo *info;
     GFile *child;
     const char *mime_type, *display_name;
-    char *lower_name, *normalized;
     gboolean hit;
-    int i;
-    GList *l;
     const char *id;
-    gboolean visited;
+    GList *subdirs, *subdir_ids;
     GTimeVal result;
     gchar *attributes;
     GString *attr_string;
-    gchar *filepath = NULL;
-    gboolean odt2txt_available = FALSE;
+
+    data = worker->data;
+    subdirs = NULL;
+    subdir_ids = NULL;
 
     attr_string = g_string_new (STD_ATTRIBUTES);
-    if (data->mime_types != NULL || data->contained_text != NULL) {
+    if (caja_search_matcher_has_mime_types (data->matcher) || data->contained_text != NULL) {
         g_string_append (attr_string, "," G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE);
     }
     if (data->tags != NULL) {
@@ -497,10 +1028,6 @@ visit_directory (GFile *dir, SearchThreadData *data)
         g_string_append (attr_string, "," G_FILE_ATTRIBUTE_STANDARD_SIZE);
     }
 
-    if (data->contained_text != NULL) {
-        odt2txt_available = check_odt2txt();
-    }
-
     attributes = g_string_free (attr_string, FALSE);
     enumerator = g_file_enumerate_children (dir, (const char*)attributes, 0,
                                             data->cancellable, NULL);
@@ -524,53 +1051,12 @@ visit_directory (GFile *dir, SearchThreadData *data)
             goto next;
         }
 
-        normalized = g_utf8_normalize (display_name, -1, G_NORMALIZE_NFD);
-        lower_name = g_utf8_strdown (normalized, -1);
-        g_free (normalized);
+        hit = caja_search_matcher_match_name (data->matcher, display_name);
 
-        hit = TRUE;
-        if (data->use_globs)
-        {
-            /* Use glob pattern matching with case-insensitive comparison */
-            for (i = 0; data->words[i] != NULL; i++)
-            {
-                char *lower_pattern = g_utf8_strdown (data->words[i], -1);
-                if (fnmatch (lower_pattern, lower_name, 0) != 0)
-                {
-                    hit = FALSE;
-                    g_free (lower_pattern);
-                    break;
-                }
-                g_free (lower_pattern);
-            }
-        }
-        else
-        {
-            /* Use substring matching */
-            for (i = 0; data->words[i] != NULL; i++)
-            {
-                if (strstr (lower_name, data->words[i]) == NULL)
-                {
-                    hit = FALSE;
-                    break;
-                }
-            }
-        }
-        g_free (lower_name);
-
-        if (hit && data->mime_types)
+        if (hit)
         {
-            mime_type = g_file_info_get_content_type (info);
-            hit = FALSE;
-
-            for (l = data->mime_types; mime_type != NULL && l != NULL; l = l->next)
-            {
-                if (g_content_type_equals (mime_type, l->data))
-                {
-                    hit = TRUE;
-                    break;
-                }
-            }
+            hit = caja_search_matcher_match_mime_type (data->matcher,
+                                                       g_file_info_get_content_type (info));
         }
 
         if (hit && data->tags)
@@ -605,17 +1091,11 @@ visit_directory (GFile *dir, SearchThreadData *data)
         if (hit && data->contained_text) {
             mime_type = g_file_info_get_content_type (info);
 
-            if (g_content_type_is_mime_type (mime_type, "text/plain") ||
-                g_content_type_equals (mime_type, "application/vnd.oasis.opendocument.text") ||
-                g_content_type_equals (mime_type, "application/vnd.oasis.opendocument.text-template") ||
-                g_content_type_equals (mime_type, "application/vnd.oasis.opendocument.spreadsheet") ||
-                g_content_type_equals (mime_type, "application/vnd.oasis.opendocument.spreadsheet-template") ||
-                g_content_type_equals (mime_type, "application/vnd.oasis.opendocument.presentation") ||
-                g_content_type_equals (mime_type, "application/vnd.oasis.opendocument.presentation-template")
+            if (mime_type != NULL &&
+                (g_content_type_is_mime_type (mime_type, "text/plain") ||
+                 is_odf_mime_type (mime_type))
             ) {
-                g_free (filepath);
-                filepath = g_file_get_path (child);
-                hit = is_file_has_str (filepath, data->contained_text, mime_type, odt2txt_available);
+                hit = is_file_has_str (child, data->contained_text, mime_type, data->cancellable);
             }
             else {
                 hit = FALSE;
@@ -624,36 +1104,22 @@ visit_directory (GFile *dir, SearchThreadData *data)
 
         if (hit)
         {
-            data->uri_hits = g_list_prepend (data->uri_hits, g_file_get_uri (child));
+            worker->uri_hits = g_list_prepend (worker->uri_hits, g_file_get_uri (child));
         }
 
-        data->n_processed_files++;
-        if (data->n_processed_files > BATCH_SIZE)
+        worker->n_processed_files++;
+        if (worker->n_processed_files > BATCH_SIZE)
         {
-            send_batch (data);
+            send_batch (worker);
         }
 
         if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
         {
+            /* The visited check is done in queue_subdirectories so that
+             * the shared lock is taken once per directory, not per child */
             id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
-            visited = FALSE;
-            if (id)
-            {
-                if (g_hash_table_lookup_extended (data->visited,
-                                                  id, NULL, NULL))
-                {
-                    visited = TRUE;
-                }
-                else
-                {
-                    g_hash_table_insert (data->visited, g_strdup (id), NULL);
-                }
-            }
-
-            if (!visited)
-            {
-                g_queue_push_tail (data->directories, g_object_ref (child));
-            }
+            subdirs = g_list_prepend (subdirs, g_object_ref (child));
+            subdir_ids = g_list_prepend (subdir_ids, g_strdup (id));
         }
 
         g_object_unref (child);
@@ -661,22 +1127,67 @@ next:
         g_object_unref (info);
     }
 
-    g_free (filepath);
     g_object_unref (enumerator);
+
+    queue_subdirectories (data,
+                          g_list_reverse (subdirs),
+                          g_list_reverse (subdir_ids));
 }
 
-static gpointer
-search_thread_func (gpointer user_data)
+/* Returns the next directory to visit, waiting while other workers may
+ * still produce more. Returns NULL once the walk is complete or cancelled. */
+static GFile *
+search_thread_next_directory (SearchThreadData *data)
 {
-    SearchThreadData *data;
     GFile *dir;
-    GFileInfo *info;
 
-    data = user_data;
+    g_mutex_lock (&data->lock);
+    while (g_queue_is_empty (data->directories) &&
+            data->n_busy_workers > 0 &&
+            !g_cancellable_is_cancelled (data->cancellable))
+    {
+        g_cond_wait (&data->cond, &data->lock);
+    }
 
-    /* Insert id for toplevel directory into visited */
-    dir = g_queue_peek_head (data->directories);
-    info = g_file_query_info (dir, G_FILE_ATTRIBUTE_ID_FILE, 0, data->cancellable, NULL);
+    dir = NULL;
+    if (!g_cancellable_is_cancelled (data->cancellable))
+    {
+        dir = g_queue_pop_head (data->directories);
+    }
+
+    if (dir != NULL)
+    {
+        data->n_busy_workers++;
+    }
+    else
+    {
+        /* Wake up the other workers so they can notice we are done */
+        g_cond_broadcast (&data->cond);
+    }
+    g_mutex_unlock (&data->lock);
+
+    return dir;
+}
+
+static void
+search_thread_directory_done (SearchThreadData *data)
+{
+    g_mutex_lock (&data->lock);
+    data->n_busy_workers--;
+    if (data->n_busy_workers == 0 ||
+            g_cancellable_is_cancelled (data->cancellable))
+    {
+        g_cond_broadcast (&data->cond);
+    }
+    g_mutex_unlock (&data->lock);
+}
+
+static void
+search_thread_add_toplevel_to_visited (SearchThreadData *data)
+{
+    GFileInfo *info;
+
+    info = g_file_query_info (data->root, G_FILE_ATTRIBUTE_ID_FILE, 0, data->cancellable, NULL);
     if (info)
     {
         const char *id;
@@ -684,30 +1195,60 @@ search_thread_func (gpointer user_data)
         id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILE);
         if (id)
         {
-            g_hash_table_insert (data->visited, g_strdup (id), NULL);
+            g_mutex_lock (&data->lock);
+            g_hash_table_add (data->visited, g_strdup (id));
+            g_mutex_unlock (&data->lock);
         }
         g_object_unref (info);
     }
+}
 
-    while (!g_cancellable_is_cancelled (data->cancellable) &&
-            (dir = g_queue_pop_head (data->directories)) != NULL)
+static gpointer
+search_thread_func (gpointer user_data)
+{
+    SearchWorker *worker;
+    SearchThreadData *data;
+    GFile *dir;
+
+    worker = user_data;
+    data = worker->data;
+
+    while ((dir = search_thread_next_directory (data)) != NULL)
     {
-        visit_directory (dir, data);
+        if (dir == data->root)
+        {
+            /* Insert id for toplevel directory into visited */
+            search_thread_add_toplevel_to_visited (data);
+        }
+        visit_directory (dir, worker);
         g_object_unref (dir);
+        search_thread_directory_done (data);
     }
-    send_batch (data);
+    send_batch (worker);
+    g_free (worker);
 
-    g_idle_add (search_thread_done_idle, data);
+    /* The last worker to leave reports the search as finished */
+    if (g_atomic_int_dec_and_test (&data->n_running_workers))
+    {
+        g_idle_add (search_thread_done_idle, data);
+    }
 
     return NULL;
 }
 
+static int
+get_n_search_threads (void)
+{
+    return CLAMP ((int) g_get_num_processors (), 2, MAX_SEARCH_THREADS);
+}
+
 static void
 caja_search_engine_simple_start (CajaSearchEngine *engine)
 {
     CajaSearchEngineSimple *simple;
     SearchThreadData *data;
     GThread *thread;
+    int i, n_threads;
 
     simple = CAJA_SEARCH_ENGINE_SIMPLE (engine);
 
@@ -723,10 +1264,21 @@ caja_search_engine_simple_start (CajaSearchEngine *engine)
 
     data = search_thread_data_new (simple, simple->details->query);
 
-    thread = g_thread_new ("caja-search-simple", search_thread_func, data);
-    simple->details->active_search = data;
+    n_threads = get_n_search_threads ();
+    data->n_running_workers = n_threads;
 
-    g_thread_unref (thread);
+    for (i = 0; i < n_threads; i++)
+    {
+        SearchWorker *worker;
+
+        worker = g_new0 (SearchWorker, 1);
+        worker->data = data;
+
+        thread = g_thread_new ("caja-search-simple", search_thread_func, worker);
+        g_thread_unref (thread);
+    }
+
+    simple->details->active_search = data;
 }
 
 static void
@@ -27,6 +27,7 @@
 
 #include "caja-search-engine.h"
 #include "caja-search-engine-beagle.h"
+#include "caja-search-engine-index.h"
 #include "caja-search-engine-simple.h"
 #include "caja-search-engine-tracker.h"
 
@@ -111,6 +112,12 @@ caja_search_engine_new (void)
         return engine;
     }
 
+    engine = caja_search_engine_index_new ();
+    if (engine)
+    {
+        return engine;
+    }
+
     engine = caja_search_engine_simple_new ();
     return engine;
 }
@@ -0,0 +1,242 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   caja-search-matcher.c: query matching shared by the search engines
+
+   Copyright (C) 2026 MATE developers
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include <config.h>
+#include "caja-search-matcher.h"
+
+#include <string.h>
+#include <fnmatch.h>
+
+#include <gio/gio.h>
+
+/* Names shorter than this are folded on the stack */
+#define FOLD_BUFFER_SIZE 256
+
+enum
+{
+    MIME_TYPE_UNKNOWN,
+    MIME_TYPE_MATCH,
+    MIME_TYPE_NO_MATCH
+};
+
+struct CajaSearchMatcher
+{
+    char **words;           /* folded */
+    gboolean use_globs;
+
+    GList *mime_types;
+    GMutex mime_cache_lock;
+    GHashTable *mime_cache; /* file mime type -> MIME_TYPE_MATCH/NO_MATCH */
+};
+
+static gboolean
+text_has_glob (const char *text)
+{
+    if (!text)
+        return FALSE;
+
+    return (strchr (text, '*') != NULL ||
+            strchr (text, '?') != NULL ||
+            strchr (text, '[') != NULL ||
+            strchr (text, ']') != NULL);
+}
+
+char *
+caja_search_matcher_fold (const char *name)
+{
+    char *normalized, *lower;
+
+    normalized = g_utf8_normalize (name, -1, G_NORMALIZE_NFD);
+    if (normalized == NULL)
+    {
+        return NULL;
+    }
+    lower = g_utf8_strdown (normalized, -1);
+    g_free (normalized);
+
+    return lower;
+}
+
+CajaSearchMatcher *
+caja_search_matcher_new (CajaQuery *query)
+{
+    CajaSearchMatcher *matcher;
+    GPtrArray *words;
+    char *text, *folded;
+    char **split;
+    int i;
+
+    matcher = g_new0 (CajaSearchMatcher, 1);
+
+    text = caja_query_get_text (query);
+    matcher->use_globs = text_has_glob (text);
+
+    folded = text != NULL ? caja_search_matcher_fold (text) : NULL;
+    split = g_strsplit (folded != NULL ? folded : "", " ", -1);
+    g_free (folded);
+    g_free (text);
+
+    words = g_ptr_array_new ();
+    for (i = 0; split[i] != NULL; i++)
+    {
+        /* An empty substring matches every name */
+        if (!matcher->use_globs && split[i][0] == '\0')
+        {
+            g_free (split[i]);
+            continue;
+        }
+        g_ptr_array_add (words, split[i]);
+    }
+    g_ptr_array_add (words, NULL);
+    g_free (split);
+    matcher->words = (char **) g_ptr_array_free (words, FALSE);
+
+    matcher->mime_types = caja_query_get_mime_types (query);
+    g_mutex_init (&matcher->mime_cache_lock);
+    matcher->mime_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    return matcher;
+}
+
+void
+caja_search_matcher_free (CajaSearchMatcher *matcher)
+{
+    g_strfreev (matcher->words);
+    g_list_free_full (matcher->mime_types, g_free);
+    g_mutex_clear (&matcher->mime_cache_lock);
+    g_hash_table_destroy (matcher->mime_cache);
+    g_free (matcher);
+}
+
+gboolean
+caja_search_matcher_match_folded_name (CajaSearchMatcher *matcher,
+                                       const char *folded_name)
+{
+    int i;
+
+    for (i = 0; matcher->words[i] != NULL; i++)
+    {
+        if (matcher->use_globs)
+        {
+            if (fnmatch (matcher->words[i], folded_name, 0) != 0)
+            {
+                return FALSE;
+            }
+        }
+        else if (strstr (folded_name, matcher->words[i]) == NULL)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+gboolean
+caja_search_matcher_match_name (CajaSearchMatcher *matcher,
+                                const char *display_name)
+{
+    char buffer[FOLD_BUFFER_SIZE];
+    char *folded;
+    gboolean result;
+    gsize i;
+
+    if (matcher->words[0] == NULL)
+    {
+        return TRUE;
+    }
+
+    /* NFD normalization doesn't change ASCII, so plain ASCII names only
+     * need lowercasing, which can be done without allocating */
+    for (i = 0; display_name[i] != '\0' && i < FOLD_BUFFER_SIZE - 1; i++)
+    {
+        if ((guchar) display_name[i] >= 0x80)
+        {
+            break;
+        }
+        buffer[i] = g_ascii_tolower (display_name[i]);
+    }
+
+    if (display_name[i] == '\0')
+    {
+        buffer[i] = '\0';
+        return caja_search_matcher_match_folded_name (matcher, buffer);
+    }
+
+    folded = caja_search_matcher_fold (display_name);
+    result = folded != NULL && caja_search_matcher_match_folded_name (matcher, folded);
+    g_free (folded);
+
+    return result;
+}
+
+gboolean
+caja_search_matcher_has_mime_types (CajaSearchMatcher *matcher)
+{
+    return matcher->mime_types != NULL;
+}
+
+gboolean
+caja_search_matcher_match_mime_type (CajaSearchMatcher *matcher,
+                                     const char *mime_type)
+{
+    GList *l;
+    int cached;
+
+    if (matcher->mime_types == NULL)
+    {
+        return TRUE;
+    }
+
+    if (mime_type == NULL || mime_type[0] == '\0')
+    {
+        return FALSE;
+    }
+
+    /* g_content_type_equals() resolves aliases, so rather than comparing
+     * strings, remember the answer for each mime type seen. There are few
+     * distinct types in a tree compared to the number of files. */
+    g_mutex_lock (&matcher->mime_cache_lock);
+    cached = GPOINTER_TO_INT (g_hash_table_lookup (matcher->mime_cache, mime_type));
+    g_mutex_unlock (&matcher->mime_cache_lock);
+
+    if (cached != MIME_TYPE_UNKNOWN)
+    {
+        return cached == MIME_TYPE_MATCH;
+    }
+
+    cached = MIME_TYPE_NO_MATCH;
+    for (l = matcher->mime_types; l != NULL; l = l->next)
+    {
+        if (g_content_type_equals (mime_type, l->data))
+        {
+            cached = MIME_TYPE_MATCH;
+            break;
+        }
+    }
+
+    g_mutex_lock (&matcher->mime_cache_lock);
+    g_hash_table_insert (matcher->mime_cache, g_strdup (mime_type), GINT_TO_POINTER (cached));
+    g_mutex_unlock (&matcher->mime_cache_lock);
+
+    return cached == MIME_TYPE_MATCH;
+}
@@ -0,0 +1,50 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*-
+
+   caja-search-matcher.h: query matching shared by the search engines
+
+   Copyright (C) 2026 MATE developers
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, write to the
+   Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CAJA_SEARCH_MATCHER_H
+#define CAJA_SEARCH_MATCHER_H
+
+#include <glib.h>
+
+#include "caja-query.h"
+
+/* The name and mime type parts of a CajaQuery, compiled once so that
+ * matching a file does not allocate. A matcher can be shared between
+ * threads.
+ */
+typedef struct CajaSearchMatcher CajaSearchMatcher;
+
+CajaSearchMatcher *caja_search_matcher_new               (CajaQuery         *query);
+void               caja_search_matcher_free              (CajaSearchMatcher *matcher);
+
+/* Fold a name the way the matcher expects it: NFD normalized and lowercased */
+char *             caja_search_matcher_fold              (const char        *name);
+
+gboolean           caja_search_matcher_match_name        (CajaSearchMatcher *matcher,
+                                                          const char        *display_name);
+gboolean           caja_search_matcher_match_folded_name (CajaSearchMatcher *matcher,
+                                                          const char        *folded_name);
+gboolean           caja_search_matcher_has_mime_types    (CajaSearchMatcher *matcher);
+gboolean           caja_search_matcher_match_mime_type   (CajaSearchMatcher *matcher,
+                                                          const char        *mime_type);
+
+#endif /* CAJA_SEARCH_MATCHER_H */
@@ -44,6 +44,7 @@
 #include <eel/eel-vfs-extensions.h>
 
 #include "caja-thumbnails.h"
+#include "caja-debug-log.h"
 #include "caja-directory-notify.h"
 #include "caja-global-preferences.h"
 #include "caja-file-utilities.h"
@@ -60,10 +61,8 @@
 /* Cool-off period between last file modification time and thumbnail creation */
 #define THUMBNAIL_CREATION_DELAY_SECS 3
 
-static void thumbnail_thread_func (GTask        *task,
-                                   gpointer      source_object,
-                                   gpointer      task_data,
-                                   GCancellable *cancellable);
+static void thumbnail_thread_func (gpointer data,
+                                   gpointer user_data);
 
 /* structure used for making thumbnails, associating a uri with where the thumbnail is to be stored */
 
@@ -72,35 +71,48 @@ typedef struct
     char *image_uri;
     char *mime_type;
     time_t original_file_mtime;
+    /* The link in thumbnails_to_make, NULL while a thread is making
+       the thumbnail */
+    GList *node;
 } CajaThumbnailInfo;
 
 /*
  * Thumbnail thread state.
  */
 
-/* The id of the idle handler used to start the thumbnail thread, or 0 if no
+/* The id of the idle handler used to start thumbnail threads, or 0 if no
    idle handler is currently registered. */
 static guint thumbnail_thread_starter_id = 0;
 
 /* Our mutex used when accessing data shared between the main thread and the
-   thumbnail thread, i.e. the thumbnail_thread_is_running flag and the
-   thumbnails_to_make list. */
+   thumbnail threads, i.e. the thumbnail_threads_running count, the
+   thumbnails_to_make list and the statistics. */
 static GMutex thumbnails_mutex;
 
-/* A flag to indicate whether a thumbnail thread is running, so we don't
-   start more than one. Lock thumbnails_mutex when accessing this. */
-static volatile gboolean thumbnail_thread_is_running = FALSE;
+/* The pool the thumbnail threads run in, and the number of threads in it
+   that are making thumbnails. Lock thumbnails_mutex when accessing the
+   count. */
+static GThreadPool *thumbnail_thread_pool = NULL;
+static guint thumbnail_threads_running = 0;
 
 /* The list of CajaThumbnailInfo structs containing information about the
-   thumbnails we are making. Lock thumbnails_mutex when accessing this. */
-static volatile GQueue thumbnails_to_make = G_QUEUE_INIT;
+   thumbnails still to make, most wanted first. Lock thumbnails_mutex when
+   accessing this. */
+static GQueue thumbnails_to_make = G_QUEUE_INIT;
 
-/* Quickly check if uri is in thumbnails_to_make list */
+/* Maps uris to the CajaThumbnailInfo of every thumbnail that is queued or
+   being made, so the main thread doesn't add it again while a thread is
+   creating it. Lock thumbnails_mutex when accessing this. */
 static GHashTable *thumbnails_to_make_hash = NULL;
 
-/* The currently thumbnailed icon. it also exists in the thumbnails_to_make list
- * to avoid adding it again. Lock thumbnails_mutex when accessing this. */
-static CajaThumbnailInfo *currently_thumbnailing = NULL;
+/* Statistics, see caja_thumbnail_get_statistics(). Lock thumbnails_mutex
+   when accessing these. */
+static guint64 thumbnails_made = 0;
+static guint64 thumbnails_failed = 0;
+static guint64 thumbnails_postponed = 0;
+static guint64 thumbnails_removed = 0;
+static gint64 thumbnails_time = 0;
+static guint thumbnail_threads_max_running = 0;
 
 static MateDesktopThumbnailFactory *thumbnail_factory = NULL;
 
@@ -152,14 +164,29 @@ get_thumbnail_factory (void)
     return thumbnail_factory;
 }
 
+static guint
+get_max_thumbnail_threads (void)
+{
+    int threads;
+
+    threads = g_settings_get_int (caja_preferences,
+                                  CAJA_PREFERENCES_THUMBNAIL_THREADS);
+    if (threads <= 0)
+    {
+        threads = g_get_num_processors ();
+    }
+
+    return threads;
+}
+
 /* This function is added as a very low priority idle function to start the
-   thread to create any needed thumbnails. It is added with a very low priority
+   threads to create any needed thumbnails. It is added with a very low priority
    so that it doesn't delay showing the directory in the icon/list views.
    We want to show the files in the directory as quickly as possible. */
 static gboolean
 thumbnail_thread_starter_cb (gpointer data)
 {
-    GTask *task;
+    guint max_threads;
 
     /* Don't do this in thread, since g_object_ref is not threadsafe */
     if (thumbnail_factory == NULL)
@@ -167,21 +194,36 @@ thumbnail_thread_starter_cb (gpointer data)
         thumbnail_factory = get_thumbnail_factory ();
     }
 
+    max_threads = get_max_thumbnail_threads ();
+    if (thumbnail_thread_pool == NULL)
+    {
+        thumbnail_thread_pool = g_thread_pool_new (thumbnail_thread_func, NULL,
+                                max_threads, FALSE, NULL);
+    }
+    else
+    {
+        g_thread_pool_set_max_threads (thumbnail_thread_pool, max_threads, NULL);
+    }
+
+    g_mutex_lock (&thumbnails_mutex);
+
+    /* Don't start more threads than there are thumbnails to make. A
+       thread exits once the queue is empty. */
+    while (thumbnail_threads_running < max_threads &&
+            thumbnail_threads_running < g_queue_get_length (&thumbnails_to_make))
+    {
 #ifdef DEBUG_THUMBNAILS
-    g_message ("(Main Thread) Creating thumbnails thread\n");
+        g_message ("(Main Thread) Creating thumbnails thread\n");
 #endif
-    /* We set a flag to indicate the thread is running, so we don't create
-       a new one. We don't need to lock a mutex here, as the thumbnail
-       thread isn't running yet. And we know we won't create the thread
-       twice, as we also check thumbnail_thread_starter_id before
-       scheduling this idle function. */
-    thumbnail_thread_is_running = TRUE;
-    task = g_task_new (NULL, NULL, NULL, NULL);
-    g_task_run_in_thread (task, thumbnail_thread_func);
+        thumbnail_threads_running++;
+        g_thread_pool_push (thumbnail_thread_pool, GUINT_TO_POINTER (1), NULL);
+    }
+    thumbnail_threads_max_running = MAX (thumbnail_threads_max_running,
+                                         thumbnail_threads_running);
 
     thumbnail_thread_starter_id = 0;
 
-    g_object_unref (task);
+    g_mutex_unlock (&thumbnails_mutex);
 
     return FALSE;
 }
@@ -200,15 +242,17 @@ caja_thumbnail_remove_from_queue (const char *file_uri)
 
     if (thumbnails_to_make_hash)
     {
-        GList *node;
+        CajaThumbnailInfo *info;
 
-        node = g_hash_table_lookup (thumbnails_to_make_hash, file_uri);
+        info = g_hash_table_lookup (thumbnails_to_make_hash, file_uri);
 
-        if (node && node->data != currently_thumbnailing)
+        /* Thumbnails being made can't be stopped */
+        if (info && info->node != NULL)
         {
             g_hash_table_remove (thumbnails_to_make_hash, file_uri);
-            free_thumbnail_info (node->data);
-            g_queue_delete_link ((GQueue *)&thumbnails_to_make, node);
+            g_queue_delete_link (&thumbnails_to_make, info->node);
+            free_thumbnail_info (info);
+            thumbnails_removed++;
         }
     }
 
@@ -236,14 +280,16 @@ caja_thumbnail_prioritize (const char *file_uri)
 
     if (thumbnails_to_make_hash)
     {
-        GList *node;
+        CajaThumbnailInfo *info;
 
-        node = g_hash_table_lookup (thumbnails_to_make_hash, file_uri);
+        info = g_hash_table_lookup (thumbnails_to_make_hash, file_uri);
 
-        if (node && node->data != currently_thumbnailing)
+        /* The next free thread takes it; icons that scrolled out of view
+           fall behind the ones prioritized after them */
+        if (info && info->node != NULL)
         {
-            g_queue_unlink ((GQueue *)&thumbnails_to_make, node);
-            g_queue_push_head_link ((GQueue *)&thumbnails_to_make, node);
+            g_queue_unlink (&thumbnails_to_make, info->node);
+            g_queue_push_head_link (&thumbnails_to_make, info->node);
         }
     }
 
@@ -257,6 +303,37 @@ caja_thumbnail_prioritize (const char *file_uri)
     g_mutex_unlock (&thumbnails_mutex);
 }
 
+/**
+ * caja_thumbnail_get_statistics:
+ *
+ * Returns a description of how many thumbnails have been made, how long
+ * that took and how many threads made them, for debugging.
+ *
+ * Return value: A newly allocated string.
+ **/
+char *
+caja_thumbnail_get_statistics (void)
+{
+    char *statistics;
+
+    g_mutex_lock (&thumbnails_mutex);
+    statistics = g_strdup_printf ("thumbnails: %" G_GUINT64_FORMAT " made, %" G_GUINT64_FORMAT " failed, "
+                                  "%" G_GUINT64_FORMAT " postponed, %" G_GUINT64_FORMAT " removed from queue, "
+                                  "%u queued, %.1f ms each, %u of at most %u threads running (%u at once)\n",
+                                  thumbnails_made, thumbnails_failed,
+                                  thumbnails_postponed, thumbnails_removed,
+                                  g_queue_get_length (&thumbnails_to_make),
+                                  thumbnails_made + thumbnails_failed > 0 ?
+                                  (double) thumbnails_time / (thumbnails_made + thumbnails_failed) / 1000.0 : 0.0,
+                                  thumbnail_threads_running,
+                                  thumbnail_thread_pool != NULL ?
+                                  (guint) g_thread_pool_get_max_threads (thumbnail_thread_pool) : 0,
+                                  thumbnail_threads_max_running);
+    g_mutex_unlock (&thumbnails_mutex);
+
+    return statistics;
+}
+
 /***************************************************************************
  * Thumbnail Thread Functions.
  ***************************************************************************/
@@ -384,8 +461,7 @@ void
 caja_create_thumbnail (CajaFile *file)
 {
     time_t file_mtime = 0;
-    CajaThumbnailInfo *info;
-    GList *existing;
+    CajaThumbnailInfo *info, *existing;
 
     caja_file_set_is_thumbnailing (file, TRUE);
 
@@ -427,39 +503,35 @@ caja_create_thumbnail (CajaFile *file)
     existing = g_hash_table_lookup (thumbnails_to_make_hash, info->image_uri);
     if (existing == NULL)
     {
-        GList *node;
-
         /* Add the thumbnail to the list. */
 #ifdef DEBUG_THUMBNAILS
         g_message ("(Main Thread) Adding thumbnail: %s\n",
                    info->image_uri);
 #endif
-        g_queue_push_tail ((GQueue *)&thumbnails_to_make, info);
-        node = g_queue_peek_tail_link ((GQueue *)&thumbnails_to_make);
+        g_queue_push_tail (&thumbnails_to_make, info);
+        info->node = g_queue_peek_tail_link (&thumbnails_to_make);
         g_hash_table_insert (thumbnails_to_make_hash,
                              info->image_uri,
-                             node);
-        /* If the thumbnail thread isn't running, and we haven't
-           scheduled an idle function to start it up, do that now.
-           We don't want to start it until all the other work is done,
-           so the GUI will be updated as quickly as possible.*/
-        if (thumbnail_thread_is_running == FALSE &&
-                thumbnail_thread_starter_id == 0)
+                             info);
+        /* If there could be more threads making thumbnails, and we
+           haven't scheduled an idle function to start them up, do that
+           now. We don't want to start them until all the other work is
+           done, so the GUI will be updated as quickly as possible.*/
+        if (thumbnail_thread_starter_id == 0 &&
+                (thumbnail_thread_pool == NULL ||
+                 thumbnail_threads_running < (guint) g_thread_pool_get_max_threads (thumbnail_thread_pool)))
         {
             thumbnail_thread_starter_id = g_idle_add_full (G_PRIORITY_LOW, thumbnail_thread_starter_cb, NULL, NULL);
         }
     }
     else
     {
-        CajaThumbnailInfo *existing_info;
-
 #ifdef DEBUG_THUMBNAILS
         g_message ("(Main Thread) Updating non-current mtime: %s\n",
                    info->image_uri);
 #endif
         /* The file in the queue might need a new original mtime */
-        existing_info = existing->data;
-        existing_info->original_file_mtime = info->original_file_mtime;
+        existing->original_file_mtime = info->original_file_mtime;
         free_thumbnail_info (info);
     }
 
@@ -473,18 +545,18 @@ caja_create_thumbnail (CajaFile *file)
     g_mutex_unlock (&thumbnails_mutex);
 }
 
-/* thumbnail_thread is invoked as a separate thread to to make thumbnails. */
+/* thumbnail_thread is invoked in the thread pool to make thumbnails, possibly
+   in several threads at once. */
 static void
-thumbnail_thread_func (GTask        *task,
-                       gpointer      source_object,
-                       gpointer      task_data,
-                       GCancellable *cancellable)
+thumbnail_thread_func (gpointer data,
+                       gpointer user_data)
 {
     CajaThumbnailInfo *info = NULL;
     GdkPixbuf *pixbuf;
     time_t current_orig_mtime = 0;
     time_t current_time;
-    GList *node;
+    gint64 start_time;
+    gboolean made, last_thread;
 
     /* We loop until there are no more thumbails to make, at which point
        we exit the thread. */
@@ -499,43 +571,56 @@ thumbnail_thread_func (GTask        *task,
          * MUTEX LOCKED
          *********************************/
 
-        /* Pop the last thumbnail we just made off the head of the
-           list and free it. I did this here so we only have to lock
-           the mutex once per thumbnail, rather than once before
-           creating it and once after.
-           Don't pop the thumbnail off the queue if the original file
-           mtime of the request changed. Then we need to redo the thumbnail.
+        /* Forget the last thumbnail we just made and free it. I did
+           this here so we only have to lock the mutex once per
+           thumbnail, rather than once before creating it and once after.
+           Don't drop the thumbnail if the original file mtime of the
+           request changed. Then we need to redo the thumbnail, so put it
+           back at the head of the queue.
         */
-        if (currently_thumbnailing &&
-                currently_thumbnailing->original_file_mtime == current_orig_mtime)
+        if (info != NULL)
         {
-            g_assert (info == currently_thumbnailing);
-            node = g_hash_table_lookup (thumbnails_to_make_hash, info->image_uri);
-            g_assert (node != NULL);
-            g_hash_table_remove (thumbnails_to_make_hash, info->image_uri);
-            free_thumbnail_info (info);
-            g_queue_delete_link ((GQueue *)&thumbnails_to_make, node);
+            g_assert (info->node == NULL);
+            if (info->original_file_mtime == current_orig_mtime)
+            {
+                g_hash_table_remove (thumbnails_to_make_hash, info->image_uri);
+                free_thumbnail_info (info);
+            }
+            else
+            {
+                g_queue_push_head (&thumbnails_to_make, info);
+                info->node = g_queue_peek_head_link (&thumbnails_to_make);
+            }
         }
-        currently_thumbnailing = NULL;
 
-        /* If there are no more thumbnails to make, reset the
-           thumbnail_thread_is_running flag, unlock the mutex, and
+        /* If there are no more thumbnails to make, unlock the mutex, and
            exit the thread. */
-        if (g_queue_is_empty ((GQueue *)&thumbnails_to_make))
+        if (g_queue_is_empty (&thumbnails_to_make))
         {
 #ifdef DEBUG_THUMBNAILS
             g_message ("(Thumbnail Thread) Exiting\n");
 #endif
-            thumbnail_thread_is_running = FALSE;
+            thumbnail_threads_running--;
+            last_thread = thumbnail_threads_running == 0;
             g_mutex_unlock (&thumbnails_mutex);
+
+            if (last_thread)
+            {
+                char *statistics;
+
+                statistics = caja_thumbnail_get_statistics ();
+                caja_debug_log (FALSE, CAJA_DEBUG_LOG_DOMAIN_ASYNC, "%s", statistics);
+                g_free (statistics);
+            }
             return;
         }
 
-        /* Get the next one to make. We leave it on the list until it
-           is created so the main thread doesn't add it again while we
-           are creating it. */
-        info = g_queue_peek_head ((GQueue *)&thumbnails_to_make);
-        currently_thumbnailing = info;
+        /* Get the next one to make. It stays in the hash table until
+           it is created so the main thread doesn't add it again while
+           we are creating it, but leaves the queue so that no other
+           thread makes it too. */
+        info = g_queue_pop_head (&thumbnails_to_make);
+        info->node = NULL;
         current_orig_mtime = info->original_file_mtime;
         /*********************************
          * MUTEX UNLOCKED
@@ -557,6 +642,10 @@ thumbnail_thread_func (GTask        *task,
             g_message ("(Thumbnail Thread) Skipping: %s\n",
                        info->image_uri);
 #endif
+            g_mutex_lock (&thumbnails_mutex);
+            thumbnails_postponed++;
+            g_mutex_unlock (&thumbnails_mutex);
+
             /* Reschedule thumbnailing via a change notification */
             g_timeout_add_seconds (1, thumbnail_thread_notify_file_changed,
                                    g_strdup (info->image_uri));
@@ -568,11 +657,13 @@ thumbnail_thread_func (GTask        *task,
         g_message ("(Thumbnail Thread) Creating thumbnail: %s\n",
                    info->image_uri);
 #endif
+        start_time = g_get_monotonic_time ();
 
         pixbuf = mate_desktop_thumbnail_factory_generate_thumbnail (thumbnail_factory,
                  info->image_uri,
                  info->mime_type);
 
+        made = pixbuf != NULL;
         if (pixbuf)
         {
 #ifdef DEBUG_THUMBNAILS
@@ -595,6 +686,19 @@ thumbnail_thread_func (GTask        *task,
                     info->image_uri,
                     current_orig_mtime);
         }
+
+        g_mutex_lock (&thumbnails_mutex);
+        if (made)
+        {
+            thumbnails_made++;
+        }
+        else
+        {
+            thumbnails_failed++;
+        }
+        thumbnails_time += g_get_monotonic_time () - start_time;
+        g_mutex_unlock (&thumbnails_mutex);
+
         /* We need to call caja_file_changed(), but I don't think that is
            thread safe. So add an idle handler and do it from the main loop. */
         g_idle_add_full (G_PRIORITY_HIGH_IDLE,
@@ -40,4 +40,7 @@ gboolean   caja_thumbnail_is_mimetype_limited_by_size
 void       caja_thumbnail_remove_from_queue     (const char   *file_uri);
 void       caja_thumbnail_prioritize            (const char   *file_uri);
 
+/* Debugging */
+char *     caja_thumbnail_get_statistics        (void);
+
 #endif /* CAJA_THUMBNAILS_H */
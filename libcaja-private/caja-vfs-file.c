@@ -279,25 +279,28 @@ vfs_file_get_deep_counts (CajaFile *file,
 
     if (file->details->deep_counts_status != CAJA_REQUEST_NOT_STARTED)
     {
+        const CajaFileDeepCounts *deep_counts;
+
+        deep_counts = caja_file_peek_deep_counts (file);
         if (directory_count != NULL)
         {
-            *directory_count = file->details->deep_directory_count;
+            *directory_count = deep_counts->deep_directory_count;
         }
         if (file_count != NULL)
         {
-            *file_count = file->details->deep_file_count;
+            *file_count = deep_counts->deep_file_count;
         }
         if (unreadable_directory_count != NULL)
         {
-            *unreadable_directory_count = file->details->deep_unreadable_count;
+            *unreadable_directory_count = deep_counts->deep_unreadable_count;
         }
         if (total_size != NULL)
         {
-            *total_size = file->details->deep_size;
+            *total_size = deep_counts->deep_size;
         }
         if (total_size_on_disk != NULL)
         {
-            *total_size_on_disk = file->details->deep_size_on_disk;
+            *total_size_on_disk = deep_counts->deep_size_on_disk;
         }
         return file->details->deep_counts_status;
     }
@@ -367,13 +370,13 @@ vfs_file_get_date (CajaFile *file,
         return TRUE;
     case CAJA_DATE_TYPE_TRASHED:
         /* Before we have info on a file, the date is unknown. */
-        if (file->details->trash_time == 0)
+        if (caja_file_peek_extras (file)->trash_time == 0)
         {
             return FALSE;
         }
         if (date != NULL)
         {
-            *date = file->details->trash_time;
+            *date = file->details->extras->trash_time;
         }
         return TRUE;
     case CAJA_DATE_TYPE_PERMISSIONS_CHANGED:
@@ -2809,28 +2809,91 @@ ready_to_load (CajaFile *file)
 }
 
 static int
-compare_files_cover (gconstpointer a, gconstpointer b, gpointer callback_data)
+compare_directories (gconstpointer a, gconstpointer b)
 {
 	const FileAndDirectory *fad1, *fad2;
-	FMDirectoryView *view;
 
-	view = callback_data;
 	fad1 = a; fad2 = b;
 
 	if (fad1->directory < fad2->directory) {
 		return -1;
 	} else if (fad1->directory > fad2->directory) {
 		return 1;
-	} else {
-		return EEL_INVOKE_METHOD (FM_DIRECTORY_VIEW_CLASS, view, compare_files,
-					  (view, fad1->file, fad2->file));
 	}
+	return 0;
+}
+
+static int
+compare_files_cover (gconstpointer a, gconstpointer b, gpointer callback_data)
+{
+	const FileAndDirectory *fad1, *fad2;
+	FMDirectoryView *view;
+	int result;
+
+	view = callback_data;
+	fad1 = a; fad2 = b;
+
+	result = compare_directories (fad1, fad2);
+	if (result == 0) {
+		result = EEL_INVOKE_METHOD (FM_DIRECTORY_VIEW_CLASS, view, compare_files,
+					    (view, fad1->file, fad2->file));
+	}
+	return result;
 }
+
+/* Sorts the files of each directory in one go with
+ * caja_file_sort_items(), which is the same order compare_files_cover()
+ * gives but takes the sort keys from each file only once.
+ */
+static gboolean
+sort_files_by_key (FMDirectoryView *view, GList **list)
+{
+	CajaFileSortType sort_type;
+	CajaFileSortItem *items;
+	gboolean directories_first, reversed;
+	GList *node, *run;
+	guint n_items, i;
+
+	if (!EEL_CALL_METHOD_WITH_RETURN_VALUE
+	    (FM_DIRECTORY_VIEW_CLASS, view,
+	     get_sort_type, (view, &sort_type, &directories_first, &reversed))) {
+		return FALSE;
+	}
+
+	/* Stable, so files of the same directory stay in their order */
+	*list = g_list_sort (*list, compare_directories);
+
+	items = g_new (CajaFileSortItem, g_list_length (*list));
+	for (run = *list; run != NULL; run = node) {
+		FileAndDirectory *fad;
+
+		n_items = 0;
+		for (node = run;
+		     node != NULL && compare_directories (node->data, run->data) == 0;
+		     node = node->next) {
+			fad = node->data;
+			items[n_items].file = fad->file;
+			items[n_items].data = fad;
+			n_items++;
+		}
+
+		caja_file_sort_items (items, n_items, sort_type, directories_first, reversed);
+
+		for (node = run, i = 0; i < n_items; node = node->next, i++) {
+			node->data = items[i].data;
+		}
+	}
+	g_free (items);
+
+	return TRUE;
+}
+
 static void
 sort_files (FMDirectoryView *view, GList **list)
 {
-	*list = g_list_sort_with_data (*list, compare_files_cover, view);
-
+	if (!sort_files_by_key (view, list)) {
+		*list = g_list_sort_with_data (*list, compare_files_cover, view);
+	}
 }
 
 /* Go through all the new added and changed files.
@@ -2920,6 +2983,49 @@ process_new_files (FMDirectoryView *view)
 
 }
 
+static void
+add_files_to_view (FMDirectoryView *view, GList *files_added)
+{
+	FileAndDirectory *pending;
+	CajaDirectory *directory;
+	GList *node, *files;
+
+	/* Handlers connected to 'add_file' expect to see each file
+	 * in the view right after it was added. */
+	if (FM_DIRECTORY_VIEW_CLASS (G_OBJECT_GET_CLASS (view))->add_files == NULL ||
+	    g_signal_has_handler_pending (view, signals[ADD_FILE], 0, TRUE)) {
+		for (node = files_added; node != NULL; node = node->next) {
+			pending = node->data;
+			g_signal_emit (view,
+				       signals[ADD_FILE], 0, pending->file, pending->directory);
+		}
+		return;
+	}
+
+	/* The files are sorted by directory */
+	files = NULL;
+	directory = NULL;
+	for (node = files_added; node != NULL; node = node->next) {
+		pending = node->data;
+		if (files != NULL && pending->directory != directory) {
+			files = g_list_reverse (files);
+			EEL_INVOKE_METHOD (FM_DIRECTORY_VIEW_CLASS, view, add_files,
+					   (view, files, directory));
+			g_list_free (files);
+			files = NULL;
+		}
+		directory = pending->directory;
+		files = g_list_prepend (files, pending->file);
+	}
+
+	if (files != NULL) {
+		files = g_list_reverse (files);
+		EEL_INVOKE_METHOD (FM_DIRECTORY_VIEW_CLASS, view, add_files,
+				   (view, files, directory));
+		g_list_free (files);
+	}
+}
+
 static void
 process_old_files (FMDirectoryView *view)
 {
@@ -2937,11 +3043,7 @@ process_old_files (FMDirectoryView *view)
 
 		g_signal_emit (view, signals[BEGIN_FILE_CHANGES], 0);
 
-		for (node = files_added; node != NULL; node = node->next) {
-			pending = node->data;
-			g_signal_emit (view,
-				       signals[ADD_FILE], 0, pending->file, pending->directory);
-		}
+		add_files_to_view (view, files_added);
 
 		for (node = files_changed; node != NULL; node = node->next) {
 			pending = node->data;
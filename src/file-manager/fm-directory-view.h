@@ -86,6 +86,15 @@ struct FMDirectoryViewClass
     void    (* add_file) 		 (FMDirectoryView *view,
                                   CajaFile *file,
                                   CajaDirectory *directory);
+
+    /* add_files is a function pointer that subclasses may override to
+     * add several files of one directory at once, in the order given.
+     * It is used instead of emitting 'add_file' for each file when
+     * nothing else is connected to that signal. The default is NULL.
+     */
+    void    (* add_files)		 (FMDirectoryView *view,
+                                  GList *files,
+                                  CajaDirectory *directory);
     void    (* remove_file)		 (FMDirectoryView *view,
                                   CajaFile *file,
                                   CajaDirectory *directory);
@@ -242,6 +251,17 @@ struct FMDirectoryViewClass
                                             CajaFile    *a,
                                             CajaFile    *b);
 
+    /* get_sort_type is a function pointer that subclasses may override
+     * when compare_files is the same as caja_file_compare_for_sort() for
+     * some sort type, so that large lists of files can be sorted with
+     * caja_file_sort_items(). Returns FALSE if compare_files has to be
+     * used. The default is NULL.
+     */
+    gboolean (* get_sort_type)             (FMDirectoryView *view,
+                                            CajaFileSortType *sort_type,
+                                            gboolean *directories_first,
+                                            gboolean *reversed);
+
     /* get_emblem_names_to_exclude is a function pointer that subclasses
      * may override to specify a set of emblem names that should not
      * be displayed with each file. By default, all emblems returned by
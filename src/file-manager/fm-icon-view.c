@@ -2572,6 +2572,23 @@ compare_files (FMDirectoryView   *icon_view,
     return fm_icon_view_compare_files ((FMIconView *)icon_view, a, b);
 }
 
+static gboolean
+fm_icon_view_get_sort_type (FMDirectoryView  *view,
+                            CajaFileSortType *sort_type,
+                            gboolean         *directories_first,
+                            gboolean         *reversed)
+{
+    FMIconView *icon_view;
+
+    icon_view = FM_ICON_VIEW (view);
+
+    *sort_type = icon_view->details->sort->sort_type;
+    *directories_first = fm_directory_view_should_sort_directories_first (view);
+    *reversed = icon_view->details->sort_reversed;
+
+    return TRUE;
+}
+
 void
 fm_icon_view_filter_by_screen (FMIconView *icon_view,
                                gboolean filter)
@@ -3391,6 +3408,7 @@ fm_icon_view_class_init (FMIconViewClass *klass)
     fm_directory_view_class->set_selection = fm_icon_view_set_selection;
     fm_directory_view_class->invert_selection = fm_icon_view_invert_selection;
     fm_directory_view_class->compare_files = compare_files;
+    fm_directory_view_class->get_sort_type = fm_icon_view_get_sort_type;
     fm_directory_view_class->zoom_to_level = fm_icon_view_zoom_to_level;
     fm_directory_view_class->get_zoom_level = fm_icon_view_get_zoom_level;
     fm_directory_view_class->click_policy_changed = fm_icon_view_click_policy_changed;
@@ -81,6 +81,12 @@ struct FMListModelDetails
     GPtrArray *columns;
 
     GList *highlight_files;
+
+    gboolean show_icons;
+    cairo_surface_t *blank_icons[CAJA_ZOOM_LEVEL_N_ENTRIES];
+
+    /* Rows with a rendered icon, most recently drawn first */
+    GQueue icon_cache;
 };
 
 typedef struct
@@ -100,6 +106,13 @@ struct FileEntry
     FileEntry *parent;
     GSequence *files;
     GSequenceIter *ptr;
+    cairo_surface_t *icon_surface;
+    GQueue *icon_cache;
+    GList icon_link;
+    CajaZoomLevel icon_zoom_level;
+    int icon_scale;
+    CajaFileIconFlags icon_flags;
+    guint icon_highlighted : 1;
     guint loaded : 1;
 };
 
@@ -119,6 +132,38 @@ static const GtkTargetEntry drag_types [] =
 
 static GtkTargetList *drag_target_list = NULL;
 
+static void
+file_entry_clear_icon (FileEntry *file_entry)
+{
+    if (file_entry->icon_surface != NULL)
+    {
+        g_queue_unlink (file_entry->icon_cache, &file_entry->icon_link);
+        file_entry->icon_cache = NULL;
+        cairo_surface_destroy (file_entry->icon_surface);
+        file_entry->icon_surface = NULL;
+    }
+}
+
+/* The icons of the rows in an expanded folder show emblems relative to
+ * the folder, like whether it can be written to */
+static void
+file_entry_clear_child_icons (FileEntry *file_entry)
+{
+    GSequenceIter *ptr;
+
+    if (file_entry->files == NULL)
+    {
+        return;
+    }
+
+    for (ptr = g_sequence_get_begin_iter (file_entry->files);
+            !g_sequence_iter_is_end (ptr);
+            ptr = g_sequence_iter_next (ptr))
+    {
+        file_entry_clear_icon (g_sequence_get (ptr));
+    }
+}
+
 static void
 file_entry_free (FileEntry *file_entry)
 {
@@ -136,6 +181,7 @@ file_entry_free (FileEntry *file_entry)
     {
         g_sequence_free (file_entry->files);
     }
+    file_entry_clear_icon (file_entry);
     g_free (file_entry);
 }
 
@@ -279,17 +325,187 @@ fm_list_model_get_icon_scale (FMListModel *model)
     return retval;
 }
 
+static cairo_surface_t *
+create_icon_surface (FMListModel *model,
+                     CajaFile *file,
+                     CajaZoomLevel zoom_level,
+                     int icon_scale,
+                     CajaFileIconFlags flags,
+                     gboolean highlighted)
+{
+    GdkPixbuf *icon, *rendered_icon;
+    GIcon *gicon, *emblemed_icon;
+    GList *emblem_icons, *l;
+    CajaIconInfo *icon_info;
+    GEmblem *emblem;
+    int icon_size;
+    CajaFile *parent_file;
+    char *emblems_to_ignore[3];
+    int i;
+    cairo_surface_t *surface;
+    const char *icon_name;
+
+    icon_size = caja_get_icon_size_for_zoom_level (zoom_level);
+
+    gicon = caja_file_get_gicon (file, flags);
+
+    /* render emblems with GEmblemedIcon */
+    parent_file = caja_file_get_parent (file);
+    i = 0;
+    emblems_to_ignore[i++] = CAJA_FILE_EMBLEM_NAME_TRASH;
+    if (parent_file) {
+    	if (!caja_file_can_write (parent_file)) {
+            emblems_to_ignore[i++] = CAJA_FILE_EMBLEM_NAME_CANT_WRITE;
+    	}
+    	caja_file_unref (parent_file);
+    }
+    emblems_to_ignore[i++] = NULL;
+
+    emblem = NULL;
+    emblem_icons = caja_file_get_emblem_icons (file,
+    					       emblems_to_ignore);
+
+    if (emblem_icons != NULL) {
+        GIcon *emblem_icon;
+
+        emblem_icon = emblem_icons->data;
+        emblem = g_emblem_new (emblem_icon);
+        emblemed_icon = g_emblemed_icon_new (gicon, emblem);
+
+        g_object_unref (emblem);
+
+    	for (l = emblem_icons->next; l != NULL; l = l->next) {
+    	    emblem_icon = l->data;
+    	    emblem = g_emblem_new (emblem_icon);
+    	    g_emblemed_icon_add_emblem
+    	        (G_EMBLEMED_ICON (emblemed_icon), emblem);
+
+            g_object_unref (emblem);
+    	}
+
+        g_list_free_full (emblem_icons, g_object_unref);
+
+    	g_object_unref (gicon);
+    	gicon = emblemed_icon;
+    }
+
+    icon_info = caja_file_get_icon (file, icon_size, icon_scale, flags);
+    icon_name = caja_icon_info_get_used_name (icon_info);
+
+    if (icon_name != NULL) {
+        g_object_unref (icon_info);
+        icon_info = caja_icon_info_lookup (gicon, icon_size, icon_scale);
+    }
+    icon = caja_icon_info_get_pixbuf_at_size (icon_info, icon_size);
+
+    g_object_unref (icon_info);
+    g_object_unref (gicon);
+
+    if (highlighted)
+    {
+        rendered_icon = eel_create_spotlight_pixbuf (icon);
+
+        if (rendered_icon != NULL)
+        {
+            g_object_unref (icon);
+            icon = rendered_icon;
+        }
+    }
+
+    surface = gdk_cairo_surface_create_from_pixbuf (icon, icon_scale, NULL);
+    g_object_unref (icon);
+
+    return surface;
+}
+
+/* Rendering the icon of a row is by far the most expensive part of
+ * drawing it, and the tree view asks for it on every redraw. A row keeps
+ * the last surface it rendered, until the file or its folder changes or
+ * the icon is wanted at another size, scale or state. Only the rows
+ * drawn last keep theirs, which is more than a window can show.
+ */
+#define ICON_CACHE_SIZE 512
+
+static cairo_surface_t *
+get_icon_surface (FMListModel *model,
+                  GtkTreeIter *iter,
+                  FileEntry *file_entry,
+                  CajaZoomLevel zoom_level)
+{
+    CajaFileIconFlags flags;
+    gboolean highlighted;
+    int icon_scale;
+
+    icon_scale = fm_list_model_get_icon_scale (model);
+
+    flags = CAJA_FILE_ICON_FLAGS_USE_THUMBNAILS |
+            CAJA_FILE_ICON_FLAGS_FORCE_THUMBNAIL_SIZE |
+            CAJA_FILE_ICON_FLAGS_USE_MOUNT_ICON_AS_EMBLEM;
+    if (model->details->drag_view != NULL)
+    {
+        GtkTreePath *path_a;
+
+        gtk_tree_view_get_drag_dest_row (model->details->drag_view,
+                                         &path_a,
+                                         NULL);
+        if (path_a != NULL)
+        {
+            GtkTreePath *path_b;
+
+            path_b = gtk_tree_model_get_path (GTK_TREE_MODEL (model), iter);
+
+            if (gtk_tree_path_compare (path_a, path_b) == 0)
+            {
+                flags |= CAJA_FILE_ICON_FLAGS_FOR_DRAG_ACCEPT;
+            }
+
+            gtk_tree_path_free (path_a);
+            gtk_tree_path_free (path_b);
+        }
+    }
+
+    highlighted = model->details->highlight_files != NULL &&
+                  g_list_find_custom (model->details->highlight_files,
+                                      file_entry->file, (GCompareFunc) caja_file_compare_location) != NULL;
+
+    if (file_entry->icon_surface != NULL &&
+            file_entry->icon_zoom_level == zoom_level &&
+            file_entry->icon_scale == icon_scale &&
+            file_entry->icon_flags == flags &&
+            file_entry->icon_highlighted == highlighted)
+    {
+        g_queue_unlink (&model->details->icon_cache, &file_entry->icon_link);
+        g_queue_push_head_link (&model->details->icon_cache, &file_entry->icon_link);
+        return file_entry->icon_surface;
+    }
+
+    file_entry_clear_icon (file_entry);
+    if (model->details->icon_cache.length >= ICON_CACHE_SIZE)
+    {
+        file_entry_clear_icon (model->details->icon_cache.tail->data);
+    }
+
+    file_entry->icon_surface = create_icon_surface (model, file_entry->file,
+                               zoom_level, icon_scale,
+                               flags, highlighted);
+    file_entry->icon_zoom_level = zoom_level;
+    file_entry->icon_scale = icon_scale;
+    file_entry->icon_flags = flags;
+    file_entry->icon_highlighted = highlighted;
+    file_entry->icon_cache = &model->details->icon_cache;
+    file_entry->icon_link.data = file_entry;
+    g_queue_push_head_link (&model->details->icon_cache, &file_entry->icon_link);
+
+    return file_entry->icon_surface;
+}
+
 static void
 fm_list_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter, int column, GValue *value)
 {
     FMListModel *model;
     FileEntry *file_entry;
     CajaFile *file;
-    GdkPixbuf *rendered_icon;
-    GIcon *emblemed_icon;
-    GList *emblem_icons, *l;
     CajaZoomLevel zoom_level;
-    CajaFileIconFlags flags;
 
     model = (FMListModel *)tree_model;
 
@@ -318,134 +534,26 @@ fm_list_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter, int column
     case FM_LIST_MODEL_LARGE_ICON_COLUMN:
     case FM_LIST_MODEL_LARGER_ICON_COLUMN:
     case FM_LIST_MODEL_LARGEST_ICON_COLUMN:
-        if (!g_settings_get_boolean (caja_preferences, CAJA_PREFERENCES_SHOW_ICONS_IN_LIST_VIEW)) {
-            cairo_surface_t *surface;
-            int icon_size;
+        g_value_init (value, CAIRO_GOBJECT_TYPE_SURFACE);
 
-            g_value_init (value, CAIRO_GOBJECT_TYPE_SURFACE);
+        zoom_level = fm_list_model_get_zoom_level_from_column_id (column);
 
-            zoom_level = fm_list_model_get_zoom_level_from_column_id (column);
-            icon_size = caja_get_icon_size_for_zoom_level (zoom_level);
+        if (!model->details->show_icons) {
+            /* All rows share one blank surface per size */
+            if (model->details->blank_icons[zoom_level] == NULL) {
+                int icon_size;
 
-            surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, icon_size, icon_size);
-            g_value_take_boxed (value, surface);
+                icon_size = caja_get_icon_size_for_zoom_level (zoom_level);
+                model->details->blank_icons[zoom_level] =
+                    cairo_image_surface_create (CAIRO_FORMAT_ARGB32, icon_size, icon_size);
+            }
+            g_value_set_boxed (value, model->details->blank_icons[zoom_level]);
             break;
         }
-        g_value_init (value, CAIRO_GOBJECT_TYPE_SURFACE);
 
         if (file != NULL)
         {
-            GdkPixbuf *icon;
-            GIcon *gicon;
-            CajaIconInfo *icon_info;
-            GEmblem *emblem;
-            int icon_size, icon_scale;
-            CajaFile *parent_file;
-            char *emblems_to_ignore[3];
-            int i;
-            cairo_surface_t *surface;
-            const char *icon_name;
-
-            zoom_level = fm_list_model_get_zoom_level_from_column_id (column);
-            icon_size = caja_get_icon_size_for_zoom_level (zoom_level);
-            icon_scale = fm_list_model_get_icon_scale (model);
-
-            flags = CAJA_FILE_ICON_FLAGS_USE_THUMBNAILS |
-                    CAJA_FILE_ICON_FLAGS_FORCE_THUMBNAIL_SIZE |
-                    CAJA_FILE_ICON_FLAGS_USE_MOUNT_ICON_AS_EMBLEM;
-            if (model->details->drag_view != NULL)
-            {
-                GtkTreePath *path_a;
-
-                gtk_tree_view_get_drag_dest_row (model->details->drag_view,
-                                                 &path_a,
-                                                 NULL);
-                if (path_a != NULL)
-                {
-                    GtkTreePath *path_b;
-
-                    path_b = gtk_tree_model_get_path (tree_model, iter);
-
-                    if (gtk_tree_path_compare (path_a, path_b) == 0)
-                    {
-                        flags |= CAJA_FILE_ICON_FLAGS_FOR_DRAG_ACCEPT;
-                    }
-
-                    gtk_tree_path_free (path_a);
-                    gtk_tree_path_free (path_b);
-                }
-            }
-
-            gicon = caja_file_get_gicon (file, flags);
-
-            /* render emblems with GEmblemedIcon */
-            parent_file = caja_file_get_parent (file);
-            i = 0;
-            emblems_to_ignore[i++] = CAJA_FILE_EMBLEM_NAME_TRASH;
-            if (parent_file) {
-            	if (!caja_file_can_write (parent_file)) {
-                    emblems_to_ignore[i++] = CAJA_FILE_EMBLEM_NAME_CANT_WRITE;
-            	}
-            	caja_file_unref (parent_file);
-            }
-            emblems_to_ignore[i++] = NULL;
-
-            emblem = NULL;
-            emblem_icons = caja_file_get_emblem_icons (file,
-            					       emblems_to_ignore);
-
-            if (emblem_icons != NULL) {
-                GIcon *emblem_icon;
-
-                emblem_icon = emblem_icons->data;
-                emblem = g_emblem_new (emblem_icon);
-                emblemed_icon = g_emblemed_icon_new (gicon, emblem);
-
-                g_object_unref (emblem);
-
-            	for (l = emblem_icons->next; l != NULL; l = l->next) {
-            	    emblem_icon = l->data;
-            	    emblem = g_emblem_new (emblem_icon);
-            	    g_emblemed_icon_add_emblem
-            	        (G_EMBLEMED_ICON (emblemed_icon), emblem);
-
-                    g_object_unref (emblem);
-            	}
-
-                g_list_free_full (emblem_icons, g_object_unref);
-
-            	g_object_unref (gicon);
-            	gicon = emblemed_icon;
-            }
-
-            icon_info = caja_file_get_icon (file, icon_size, icon_scale, flags);
-            icon_name = caja_icon_info_get_used_name (icon_info);
-
-            if (icon_name != NULL) {
-                g_object_unref (icon_info);
-                icon_info = caja_icon_info_lookup (gicon, icon_size, icon_scale);
-            }
-            icon = caja_icon_info_get_pixbuf_at_size (icon_info, icon_size);
-
-            g_object_unref (icon_info);
-            g_object_unref (gicon);
-
-            if (model->details->highlight_files != NULL &&
-                    g_list_find_custom (model->details->highlight_files,
-                                        file, (GCompareFunc) caja_file_compare_location))
-            {
-                rendered_icon = eel_create_spotlight_pixbuf (icon);
-
-                if (rendered_icon != NULL)
-                {
-                    g_object_unref (icon);
-                    icon = rendered_icon;
-                }
-            }
-
-            surface = gdk_cairo_surface_create_from_pixbuf (icon, icon_scale, NULL);
-            g_value_take_boxed (value, surface);
-            g_object_unref (icon);
+            g_value_set_boxed (value, get_icon_surface (model, iter, file_entry, zoom_level));
         }
         break;
     case FM_LIST_MODEL_FILE_NAME_IS_EDITABLE_COLUMN:
@@ -799,6 +907,85 @@ fm_list_model_compare_func (FMListModel *model,
     return result;
 }
 
+gboolean
+fm_list_model_get_sort_type (FMListModel      *model,
+                             CajaFileSortType *sort_type,
+                             gboolean         *directories_first,
+                             gboolean         *reversed)
+{
+    if (!caja_file_get_sort_type_for_attribute_q (model->details->sort_attribute, sort_type))
+    {
+        return FALSE;
+    }
+
+    *directories_first = model->details->sort_directories_first;
+    *reversed = model->details->order == GTK_SORT_DESCENDING;
+
+    return TRUE;
+}
+
+/* Sorts the entries of one level with caja_file_sort_items(), which
+ * takes the sort keys from each file once instead of on every
+ * comparison. Entries without a file stay first, as
+ * fm_list_model_file_entry_compare_func() would put them.
+ */
+static gboolean
+fm_list_model_sort_file_entries_by_key (FMListModel *model, GSequence *files)
+{
+    CajaFileSortType sort_type;
+    CajaFileSortItem *items;
+    GSequenceIter *ptr, *end;
+    GList *no_file_entries, *l;
+    gboolean directories_first, reversed;
+    guint n_items, i;
+
+    if (!fm_list_model_get_sort_type (model, &sort_type, &directories_first, &reversed))
+    {
+        return FALSE;
+    }
+
+    items = g_new (CajaFileSortItem, g_sequence_get_length (files));
+    n_items = 0;
+    no_file_entries = NULL;
+    for (ptr = g_sequence_get_begin_iter (files);
+            !g_sequence_iter_is_end (ptr);
+            ptr = g_sequence_iter_next (ptr))
+    {
+        FileEntry *file_entry;
+
+        file_entry = g_sequence_get (ptr);
+        if (file_entry->file == NULL)
+        {
+            no_file_entries = g_list_prepend (no_file_entries, ptr);
+        }
+        else
+        {
+            items[n_items].file = file_entry->file;
+            items[n_items].data = ptr;
+            n_items++;
+        }
+    }
+
+    caja_file_sort_items (items, n_items, sort_type, directories_first, reversed);
+
+    /* Moving every entry to the end, in order, leaves them sorted */
+    end = g_sequence_get_end_iter (files);
+    no_file_entries = g_list_reverse (no_file_entries);
+    for (l = no_file_entries; l != NULL; l = l->next)
+    {
+        g_sequence_move (l->data, end);
+    }
+    for (i = 0; i < n_items; i++)
+    {
+        g_sequence_move (items[i].data, end);
+    }
+
+    g_list_free (no_file_entries);
+    g_free (items);
+
+    return TRUE;
+}
+
 static void
 fm_list_model_sort_file_entries (FMListModel *model, GSequence *files, GtkTreePath *path)
 {
@@ -836,7 +1023,10 @@ fm_list_model_sort_file_entries (FMListModel *model, GSequence *files, GtkTreePa
     }
 
     /* sort */
-    g_sequence_sort (files, fm_list_model_file_entry_compare_func, model);
+    if (!fm_list_model_sort_file_entries_by_key (model, files))
+    {
+        g_sequence_sort (files, fm_list_model_file_entry_compare_func, model);
+    }
 
     /* generate new order */
     new_order = g_new (int, length);
@@ -1150,6 +1340,171 @@ fm_list_model_add_file (FMListModel *model, CajaFile *file,
     return TRUE;
 }
 
+static int
+compare_file_entry_pointers (gconstpointer a,
+                             gconstpointer b,
+                             gpointer      user_data)
+{
+    return fm_list_model_file_entry_compare_func (*(FileEntry **)a,
+            *(FileEntry **)b,
+            user_data);
+}
+
+static void
+sort_new_file_entries (FMListModel *model, FileEntry **entries, guint n_entries)
+{
+    CajaFileSortType sort_type;
+    CajaFileSortItem *items;
+    gboolean directories_first, reversed;
+    guint i;
+
+    if (!fm_list_model_get_sort_type (model, &sort_type, &directories_first, &reversed))
+    {
+        g_qsort_with_data (entries, n_entries, sizeof (FileEntry *),
+                           compare_file_entry_pointers, model);
+        return;
+    }
+
+    items = g_new (CajaFileSortItem, n_entries);
+    for (i = 0; i < n_entries; i++)
+    {
+        items[i].file = entries[i]->file;
+        items[i].data = entries[i];
+    }
+
+    caja_file_sort_items (items, n_entries, sort_type, directories_first, reversed);
+
+    for (i = 0; i < n_entries; i++)
+    {
+        entries[i] = items[i].data;
+    }
+    g_free (items);
+}
+
+/**
+ * fm_list_model_add_files:
+ * @model: The model
+ * @files: List of CajaFiles
+ * @directory: The directory the files are in
+ *
+ * Adds the files like fm_list_model_add_file() does for each of them.
+ * Files of the top level directory are sorted once and merged into the
+ * existing rows in a single pass, with their paths known from the
+ * position they are inserted at instead of looked up for every row.
+ **/
+void
+fm_list_model_add_files (FMListModel *model, GList *files,
+                         CajaDirectory *directory)
+{
+    GtkTreeModel *tree_model;
+    GtkTreeIter iter;
+    GtkTreePath *path;
+    FileEntry **entries, *file_entry;
+    GSequenceIter *ptr;
+    GList *l;
+    guint n_entries, length, i;
+    gboolean merge;
+    int position;
+
+    if (g_hash_table_lookup (model->details->directory_reverse_map,
+                             directory) != NULL)
+    {
+        /* Expanded subdirectories load a handful of files at a time
+         * and have their loading row to replace */
+        for (l = files; l != NULL; l = l->next)
+        {
+            fm_list_model_add_file (model, l->data, directory);
+        }
+        return;
+    }
+
+    entries = g_new (FileEntry *, g_list_length (files));
+    n_entries = 0;
+    for (l = files; l != NULL; l = l->next)
+    {
+        CajaFile *file;
+
+        file = l->data;
+        if (g_hash_table_lookup (model->details->top_reverse_map, file) != NULL)
+        {
+            g_warning ("file already in tree!!!\n");
+            continue;
+        }
+
+        file_entry = g_new0 (FileEntry, 1);
+        file_entry->file = caja_file_ref (file);
+        entries[n_entries++] = file_entry;
+    }
+
+    sort_new_file_entries (model, entries, n_entries);
+
+    /* Walking the existing rows once beats a binary search for each
+     * new file unless only a few files are added to many rows */
+    length = g_sequence_get_length (model->details->files);
+    merge = n_entries * g_bit_storage (length) >= length;
+
+    tree_model = GTK_TREE_MODEL (model);
+    ptr = g_sequence_get_begin_iter (model->details->files);
+    position = 0;
+    for (i = 0; i < n_entries; i++)
+    {
+        file_entry = entries[i];
+
+        if (merge)
+        {
+            /* Both lists are sorted, so the next file goes somewhere
+             * after the previous one */
+            while (!g_sequence_iter_is_end (ptr) &&
+                    fm_list_model_file_entry_compare_func (g_sequence_get (ptr),
+                            file_entry, model) <= 0)
+            {
+                ptr = g_sequence_iter_next (ptr);
+                position++;
+            }
+        }
+        else
+        {
+            ptr = g_sequence_search (model->details->files, file_entry,
+                                     fm_list_model_file_entry_compare_func, model);
+            position = g_sequence_iter_get_position (ptr);
+        }
+
+        file_entry->ptr = g_sequence_insert_before (ptr, file_entry);
+        g_hash_table_insert (model->details->top_reverse_map,
+                             file_entry->file, file_entry->ptr);
+
+        iter.stamp = model->details->stamp;
+        iter.user_data = file_entry->ptr;
+
+        path = gtk_tree_path_new_from_indices (position, -1);
+        gtk_tree_model_row_inserted (tree_model, path, &iter);
+        position++;
+
+        if (caja_file_is_directory (file_entry->file))
+        {
+            file_entry->files = g_sequence_new ((GDestroyNotify)file_entry_free);
+
+            add_dummy_row (model, file_entry);
+
+            gtk_tree_model_row_has_child_toggled (tree_model, path, &iter);
+        }
+        gtk_tree_path_free (path);
+    }
+
+    g_free (entries);
+}
+
+/* For when the emblems of all rows may have changed, as they do with
+ * the folder shown */
+void
+fm_list_model_clear_icons (FMListModel *model)
+{
+    while (model->details->icon_cache.head != NULL)
+    {
+        file_entry_clear_icon (model->details->icon_cache.head->data);
+    }
+}
+
 void
 fm_list_model_file_changed (FMListModel *model, CajaFile *file,
                             CajaDirectory *directory)
@@ -1167,6 +1522,11 @@ fm_list_model_file_changed (FMListModel *model, CajaFile *file,
         return;
     }
 
+    /* The icon or its emblems may have changed, and so may the
+     * emblems of the files in it */
+    file_entry_clear_icon (g_sequence_get (ptr));
+    file_entry_clear_child_icons (g_sequence_get (ptr));
+
     pos_before = g_sequence_iter_get_position (ptr);
 
     g_sequence_sort_changed (ptr, fm_list_model_file_entry_compare_func, model);
@@ -1644,6 +2004,16 @@ fm_list_model_add_column (FMListModel *model,
     return FM_LIST_MODEL_NUM_COLUMNS + (model->details->columns->len - 1);
 }
 
+static void
+show_icons_changed_callback (gpointer callback_data)
+{
+    FMListModel *model;
+
+    model = FM_LIST_MODEL (callback_data);
+    model->details->show_icons =
+        g_settings_get_boolean (caja_preferences, CAJA_PREFERENCES_SHOW_ICONS_IN_LIST_VIEW);
+}
+
 static void
 fm_list_model_dispose (GObject *object)
 {
@@ -1680,6 +2050,10 @@ fm_list_model_dispose (GObject *object)
         model->details->directory_reverse_map = NULL;
     }
 
+    g_signal_handlers_disconnect_by_func (caja_preferences,
+                                          show_icons_changed_callback,
+                                          model);
+
     G_OBJECT_CLASS (fm_list_model_parent_class)->dispose (object);
 }
 
@@ -1687,6 +2061,7 @@ static void
 fm_list_model_finalize (GObject *object)
 {
     FMListModel *model;
+    int i;
 
     model = FM_LIST_MODEL (object);
 
@@ -1696,6 +2071,14 @@ fm_list_model_finalize (GObject *object)
         model->details->highlight_files = NULL;
     }
 
+    for (i = 0; i < CAJA_ZOOM_LEVEL_N_ENTRIES; i++)
+    {
+        if (model->details->blank_icons[i] != NULL)
+        {
+            cairo_surface_destroy (model->details->blank_icons[i]);
+        }
+    }
+
     g_free (model->details);
 
     G_OBJECT_CLASS (fm_list_model_parent_class)->finalize (object);
@@ -1711,6 +2094,13 @@ fm_list_model_init (FMListModel *model)
     model->details->stamp = g_random_int ();
     model->details->sort_attribute = 0;
     model->details->columns = g_ptr_array_new ();
+
+    /* Read for every row that is drawn, so keep it at hand */
+    g_signal_connect_swapped (caja_preferences,
+                              "changed::" CAJA_PREFERENCES_SHOW_ICONS_IN_LIST_VIEW,
+                              G_CALLBACK (show_icons_changed_callback),
+                              model);
+    show_icons_changed_callback (model);
 }
 
 static void
@@ -80,6 +80,9 @@ GType    fm_list_model_get_type                          (void);
 gboolean fm_list_model_add_file                          (FMListModel          *model,
         CajaFile         *file,
         CajaDirectory    *directory);
+void     fm_list_model_add_files                         (FMListModel          *model,
+        GList            *files,
+        CajaDirectory    *directory);
 void     fm_list_model_file_changed                      (FMListModel          *model,
         CajaFile         *file,
         CajaDirectory    *directory);
@@ -125,6 +128,10 @@ GtkTargetList *   fm_list_model_get_drag_target_list (void);
 int               fm_list_model_compare_func (FMListModel *model,
         CajaFile *file1,
         CajaFile *file2);
+gboolean          fm_list_model_get_sort_type (FMListModel *model,
+        CajaFileSortType *sort_type,
+        gboolean *directories_first,
+        gboolean *reversed);
 
 int               fm_list_model_add_column (FMListModel *model,
         CajaColumn *column);
@@ -135,4 +142,6 @@ void              fm_list_model_subdirectory_done_loading (FMListModel       *mo
 void              fm_list_model_set_highlight_for_files (FMListModel *model,
         GList *files);
 
+void              fm_list_model_clear_icons (FMListModel *model);
+
 #endif /* FM_LIST_MODEL_H */
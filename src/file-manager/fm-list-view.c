@@ -1929,6 +1929,15 @@ fm_list_view_add_file (FMDirectoryView *view, CajaFile *file, CajaDirectory *dir
     fm_list_model_add_file (model, file, directory);
 }
 
+static void
+fm_list_view_add_files (FMDirectoryView *view, GList *files, CajaDirectory *directory)
+{
+    FMListModel *model;
+
+    model = FM_LIST_VIEW (view)->details->model;
+    fm_list_model_add_files (model, files, directory);
+}
+
 static char **
 get_visible_columns (FMListView *list_view)
 {
@@ -3128,6 +3137,19 @@ fm_list_view_compare_files (FMDirectoryView *view, CajaFile *file1, CajaFile *fi
     return fm_list_model_compare_func (list_view->details->model, file1, file2);
 }
 
+static gboolean
+fm_list_view_get_sort_type (FMDirectoryView  *view,
+                            CajaFileSortType *sort_type,
+                            gboolean         *directories_first,
+                            gboolean         *reversed)
+{
+    FMListView *list_view;
+
+    list_view = FM_LIST_VIEW (view);
+    return fm_list_model_get_sort_type (list_view->details->model,
+                                        sort_type, directories_first, reversed);
+}
+
 static gboolean
 fm_list_view_using_manual_layout (FMDirectoryView *view)
 {
@@ -3229,11 +3251,15 @@ fm_list_view_finalize (GObject *object)
 static void
 fm_list_view_emblems_changed (FMDirectoryView *directory_view)
 {
+    FMListView *list_view;
+
     g_assert (FM_IS_LIST_VIEW (directory_view));
 
-    /* FIXME: This needs to update the emblems of the icons, since
-     * relative emblems may have changed.
-     */
+    /* Relative emblems, like the one for files that can't be
+     * written to, may have changed with the folder */
+    list_view = FM_LIST_VIEW (directory_view);
+    fm_list_model_clear_icons (list_view->details->model);
+    gtk_widget_queue_draw (GTK_WIDGET (list_view->details->tree_view));
 }
 
 static char *
@@ -3395,6 +3421,7 @@ fm_list_view_class_init (FMListViewClass *class)
     G_OBJECT_CLASS (class)->finalize = fm_list_view_finalize;
 
     fm_directory_view_class->add_file = fm_list_view_add_file;
+    fm_directory_view_class->add_files = fm_list_view_add_files;
     fm_directory_view_class->begin_loading = fm_list_view_begin_loading;
     fm_directory_view_class->end_loading = fm_list_view_end_loading;
     fm_directory_view_class->bump_zoom_level = fm_list_view_bump_zoom_level;
@@ -3419,6 +3446,7 @@ fm_list_view_class_init (FMListViewClass *class)
     fm_directory_view_class->set_selection = fm_list_view_set_selection;
     fm_directory_view_class->invert_selection = fm_list_view_invert_selection;
     fm_directory_view_class->compare_files = fm_list_view_compare_files;
+    fm_directory_view_class->get_sort_type = fm_list_view_get_sort_type;
     fm_directory_view_class->sort_directories_first_changed = fm_list_view_sort_directories_first_changed;
     fm_directory_view_class->start_renaming_file = fm_list_view_start_renaming_file;
     fm_directory_view_class->get_zoom_level = fm_list_view_get_zoom_level;
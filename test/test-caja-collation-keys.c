@@ -0,0 +1,148 @@
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <libcaja-private/caja-file.h>
+
+/* Sorts a large number of synthetic file names by display name and
+ * reports how long it takes to make the collation keys one by one, the
+ * way loading used to, and how long the sorts take once the keys are
+ * made in bulk. No files are read, the names only exist in memory.
+ */
+
+#define DEFAULT_N_NAMES 1000000
+
+static const char *words[] = {
+	"Document", "IMG_", "Screenshot from ", "report", "Résumé",
+	"notes", "backup-", "Übersicht", "photo", "track ", "_draft",
+	"Invoice ", "Zeitplan", "archive", "élève", "data"
+};
+
+static const char *extensions[] = {
+	"", ".txt", ".jpg", ".png", ".odt", ".tar.gz", ".mp3", ".pdf"
+};
+
+static char *
+make_name (GRand *rand)
+{
+	return g_strdup_printf ("%s%u%s",
+				words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))],
+				g_rand_int_range (rand, 0, 100000),
+				extensions[g_rand_int_range (rand, 0, G_N_ELEMENTS (extensions))]);
+}
+
+static void
+shuffle (CajaFileSortItem *items, guint n_items, GRand *rand)
+{
+	CajaFileSortItem swap;
+	guint i, j;
+
+	for (i = n_items - 1; i > 0; i--) {
+		j = g_rand_int_range (rand, 0, i + 1);
+		swap = items[i];
+		items[i] = items[j];
+		items[j] = swap;
+	}
+}
+
+static int
+compare_keys (gconstpointer a, gconstpointer b)
+{
+	return strcmp (*(char * const *) a, *(char * const *) b);
+}
+
+static void
+report (const char *what, gint64 start)
+{
+	g_print ("%-40s %8.3f s\n", what,
+		 (g_get_monotonic_time () - start) / (double) G_USEC_PER_SEC);
+}
+
+int
+main (int argc, char **argv)
+{
+	CajaFileSortItem *items;
+	GList *list;
+	GRand *rand;
+	char **names, **keys;
+	char *uri;
+	guint n_names, i;
+	gint64 start;
+
+	setlocale (LC_ALL, "");
+
+	n_names = DEFAULT_N_NAMES;
+	if (argc > 2) {
+		g_printerr ("usage: %s [NUMBER-OF-NAMES]\n", argv[0]);
+		return 1;
+	}
+	if (argc == 2) {
+		n_names = strtoul (argv[1], NULL, 10);
+	}
+	if (n_names < 2) {
+		n_names = 2;
+	}
+
+	rand = g_rand_new_with_seed (42);
+
+	names = g_new (char *, n_names);
+	for (i = 0; i < n_names; i++) {
+		names[i] = make_name (rand);
+	}
+
+	g_print ("%u names\n", n_names);
+
+	start = g_get_monotonic_time ();
+	keys = g_new (char *, n_names);
+	for (i = 0; i < n_names; i++) {
+		keys[i] = g_utf8_collate_key_for_filename (names[i], -1);
+	}
+	report ("keys made one by one:", start);
+
+	start = g_get_monotonic_time ();
+	qsort (keys, n_names, sizeof (char *), compare_keys);
+	report ("sort of the bare keys:", start);
+
+	/* Names can repeat, the files are told apart by their index */
+	items = g_new (CajaFileSortItem, n_names);
+	for (i = 0; i < n_names; i++) {
+		uri = g_strdup_printf ("file:///caja-collation-benchmark/%u-%s", i, names[i]);
+		items[i].file = caja_file_get_by_uri (uri);
+		items[i].data = NULL;
+		caja_file_set_display_name (items[i].file, names[i], NULL, TRUE);
+		g_free (uri);
+	}
+
+	start = g_get_monotonic_time ();
+	caja_file_sort_items (items, n_names, CAJA_FILE_SORT_BY_DISPLAY_NAME, FALSE, FALSE);
+	report ("first sort, keys made in bulk:", start);
+
+	shuffle (items, n_names, rand);
+	start = g_get_monotonic_time ();
+	caja_file_sort_items (items, n_names, CAJA_FILE_SORT_BY_DISPLAY_NAME, FALSE, FALSE);
+	report ("sort with the keys ready:", start);
+
+	shuffle (items, n_names, rand);
+	list = NULL;
+	for (i = 0; i < n_names; i++) {
+		list = g_list_prepend (list, items[i].file);
+	}
+	start = g_get_monotonic_time ();
+	list = caja_file_list_sort_by_display_name (list);
+	report ("list sort comparing key prefixes first:", start);
+	g_list_free (list);
+
+	for (i = 0; i < n_names; i++) {
+		caja_file_unref (items[i].file);
+		g_free (names[i]);
+		g_free (keys[i]);
+	}
+	g_free (items);
+	g_free (names);
+	g_free (keys);
+	g_rand_free (rand);
+
+	return 0;
+}
@@ -2,6 +2,7 @@
 #include <unistd.h>
 
 #include <libcaja-private/caja-directory.h>
+#include <libcaja-private/caja-directory-private.h>
 #include <libcaja-private/caja-search-directory.h>
 #include <libcaja-private/caja-file.h>
 
@@ -66,9 +67,14 @@ static void
 done_loading (CajaDirectory *directory)
 {
 	static int i = 0;
+	char *statistics;
 
 	g_print ("done loading\n");
 
+	statistics = caja_directory_get_async_statistics ();
+	g_print ("%s", statistics);
+	g_free (statistics);
+
 	if (i == 0) {
 		g_timeout_add (5000, (GSourceFunc)force_reload, directory);
 		i++;
@@ -0,0 +1,98 @@
+#include <gtk/gtk.h>
+
+#include <libcaja-private/caja-directory.h>
+#include <libcaja-private/caja-file-attributes.h>
+#include <libcaja-private/caja-file-private.h>
+#include <libcaja-private/caja-file.h>
+
+/* Loads a directory with the attributes the views ask for and reports
+ * how many bytes each CajaFile takes, next to what it took while the
+ * rarely used state was still stored inline in every file. Strings and
+ * other data pointed to by the files are not counted.
+ */
+
+static void
+report (CajaDirectory *directory,
+	GList *files,
+	gpointer callback_data)
+{
+	GList *l;
+	guint n_files, n_deep_counts, n_extension_info, n_extras;
+	gsize core_size, inline_size, side_size;
+
+	n_files = n_deep_counts = n_extension_info = n_extras = 0;
+	for (l = files; l != NULL; l = l->next) {
+		CajaFile *file = l->data;
+
+		n_files++;
+		if (file->details->deep_counts != NULL) {
+			n_deep_counts++;
+		}
+		if (file->details->extension_info != NULL) {
+			n_extension_info++;
+		}
+		if (file->details->extras != NULL) {
+			n_extras++;
+		}
+	}
+
+	core_size = sizeof (CajaFile) + sizeof (CajaFilePrivate);
+	inline_size = core_size - 3 * sizeof (gpointer) +
+		sizeof (CajaFileDeepCounts) +
+		sizeof (CajaFileExtensionInfo) +
+		sizeof (CajaFileExtras);
+	side_size = n_deep_counts * sizeof (CajaFileDeepCounts) +
+		n_extension_info * sizeof (CajaFileExtensionInfo) +
+		n_extras * sizeof (CajaFileExtras);
+
+	g_print ("%u files\n", n_files);
+	g_print ("  with deep counts:    %u (%" G_GSIZE_FORMAT " bytes each)\n",
+		 n_deep_counts, sizeof (CajaFileDeepCounts));
+	g_print ("  with extension info: %u (%" G_GSIZE_FORMAT " bytes each)\n",
+		 n_extension_info, sizeof (CajaFileExtensionInfo));
+	g_print ("  with extras:         %u (%" G_GSIZE_FORMAT " bytes each)\n",
+		 n_extras, sizeof (CajaFileExtras));
+	g_print ("inline storage: %" G_GSIZE_FORMAT " bytes per file\n",
+		 inline_size);
+	if (n_files > 0) {
+		g_print ("side structures: %.1f bytes per file (%" G_GSIZE_FORMAT " core + %.1f)\n",
+			 core_size + (double) side_size / n_files,
+			 core_size, (double) side_size / n_files);
+	}
+
+	gtk_main_quit ();
+}
+
+int
+main (int argc, char **argv)
+{
+	CajaDirectory *directory;
+	GFile *location;
+	char *uri;
+
+	gtk_init (&argc, &argv);
+
+	if (argc != 2) {
+		g_printerr ("usage: %s DIRECTORY\n", argv[0]);
+		return 1;
+	}
+
+	location = g_file_new_for_commandline_arg (argv[1]);
+	uri = g_file_get_uri (location);
+	directory = caja_directory_get_by_uri (uri);
+	g_free (uri);
+	g_object_unref (location);
+
+	caja_directory_call_when_ready (directory,
+					CAJA_FILE_ATTRIBUTE_INFO |
+					CAJA_FILE_ATTRIBUTE_LINK_INFO |
+					CAJA_FILE_ATTRIBUTE_DIRECTORY_ITEM_COUNT |
+					CAJA_FILE_ATTRIBUTE_EXTENSION_INFO,
+					TRUE,
+					report, NULL);
+
+	gtk_main ();
+
+	caja_directory_unref (directory);
+	return 0;
+}
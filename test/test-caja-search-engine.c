@@ -1,6 +1,11 @@
 #include <gtk/gtk.h>
 
+#include <fnmatch.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <libcaja-private/caja-search-engine.h>
+#include <libcaja-private/caja-search-matcher.h>
 
 static void
 hits_added_cb (CajaSearchEngine *engine, GSList *hits)
@@ -29,6 +34,133 @@ finished_cb (CajaSearchEngine *engine)
 //	gtk_main_quit ();
 }
 
+/* Name matching the way the simple search engine did it before queries
+ * were compiled, kept as the baseline for the benchmark */
+static gboolean
+legacy_match (char **words, gboolean use_globs, GList *mime_types,
+	      const char *display_name, const char *mime_type)
+{
+	char *normalized, *lower_name;
+	gboolean hit;
+	GList *l;
+	int i;
+
+	normalized = g_utf8_normalize (display_name, -1, G_NORMALIZE_NFD);
+	lower_name = g_utf8_strdown (normalized, -1);
+	g_free (normalized);
+
+	hit = TRUE;
+	for (i = 0; words[i] != NULL && hit; i++) {
+		if (use_globs) {
+			char *lower_pattern = g_utf8_strdown (words[i], -1);
+			hit = fnmatch (lower_pattern, lower_name, 0) == 0;
+			g_free (lower_pattern);
+		} else {
+			hit = strstr (lower_name, words[i]) != NULL;
+		}
+	}
+	g_free (lower_name);
+
+	if (hit && mime_types) {
+		hit = FALSE;
+		for (l = mime_types; l != NULL; l = l->next) {
+			if (g_content_type_equals (mime_type, l->data)) {
+				hit = TRUE;
+				break;
+			}
+		}
+	}
+
+	return hit;
+}
+
+static void
+benchmark_query (const char *text, char **names, int n_names)
+{
+	static const char *mime_types[] = { "text/plain", "image/png", "application/pdf" };
+	CajaSearchMatcher *matcher;
+	CajaQuery *query;
+	GList *query_mime_types;
+	char **words, *normalized, *lower;
+	gboolean use_globs;
+	gint64 start, legacy_time, matcher_time;
+	int i, legacy_hits, matcher_hits;
+
+	query = caja_query_new ();
+	caja_query_set_text (query, text);
+	caja_query_add_mime_type (query, "text/plain");
+	caja_query_add_mime_type (query, "text/x-csrc");
+	query_mime_types = caja_query_get_mime_types (query);
+
+	use_globs = strpbrk (text, "*?[]") != NULL;
+	if (use_globs) {
+		words = g_strsplit (text, " ", -1);
+	} else {
+		normalized = g_utf8_normalize (text, -1, G_NORMALIZE_NFD);
+		lower = g_utf8_strdown (normalized, -1);
+		words = g_strsplit (lower, " ", -1);
+		g_free (lower);
+		g_free (normalized);
+	}
+
+	legacy_hits = 0;
+	start = g_get_monotonic_time ();
+	for (i = 0; i < n_names; i++) {
+		legacy_hits += legacy_match (words, use_globs, query_mime_types,
+					     names[i], mime_types[i % G_N_ELEMENTS (mime_types)]);
+	}
+	legacy_time = g_get_monotonic_time () - start;
+
+	matcher_hits = 0;
+	start = g_get_monotonic_time ();
+	matcher = caja_search_matcher_new (query);
+	for (i = 0; i < n_names; i++) {
+		matcher_hits += caja_search_matcher_match_name (matcher, names[i]) &&
+			caja_search_matcher_match_mime_type (matcher, mime_types[i % G_N_ELEMENTS (mime_types)]);
+	}
+	caja_search_matcher_free (matcher);
+	matcher_time = g_get_monotonic_time () - start;
+
+	g_print ("%-16s legacy %7.1f ns/file (%d hits)   compiled %7.1f ns/file (%d hits)\n",
+		 text,
+		 legacy_time * 1000.0 / n_names, legacy_hits,
+		 matcher_time * 1000.0 / n_names, matcher_hits);
+
+	g_strfreev (words);
+	g_list_free_full (query_mime_types, g_free);
+	g_object_unref (query);
+}
+
+/* Measures the per file cost of matching a query against a name */
+static int
+benchmark_matcher (int n_names)
+{
+	static const char *stems[] = { "report", "Photo", "main", "README", "données", "Übersicht" };
+	static const char *extensions[] = { ".txt", ".PNG", ".c", "", ".pdf" };
+	char **names;
+	int i;
+
+	names = g_new (char *, n_names);
+	for (i = 0; i < n_names; i++) {
+		names[i] = g_strdup_printf ("%s-%d%s",
+					    stems[i % G_N_ELEMENTS (stems)], i,
+					    extensions[i % G_N_ELEMENTS (extensions)]);
+	}
+
+	g_print ("Matching %d names\n", n_names);
+	benchmark_query ("report", names, n_names);
+	benchmark_query ("photo 12", names, n_names);
+	benchmark_query ("*.txt", names, n_names);
+	benchmark_query ("données", names, n_names);
+
+	for (i = 0; i < n_names; i++) {
+		g_free (names[i]);
+	}
+	g_free (names);
+
+	return 0;
+}
+
 int
 main (int argc, char* argv[])
 {
@@ -37,6 +169,10 @@ main (int argc, char* argv[])
 
 	gtk_init (&argc, &argv);
 
+	if (argc > 1 && strcmp (argv[1], "--benchmark-matcher") == 0) {
+		return benchmark_matcher (argc > 2 ? atoi (argv[2]) : 1000000);
+	}
+
 	engine = caja_search_engine_new ();
 	g_signal_connect (engine, "hits-added",
 			  G_CALLBACK (hits_added_cb), NULL);